@@ -0,0 +1,679 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+// repsnapper-bench: timing of single stages on real input files.
+// Not built by default, use "make repsnapper-bench".
+
+#include "stdafx.h"
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <giomm/file.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+#ifdef HAVE_OSMESA
+#include <GL/osmesa.h>
+#endif
+
+#include "files.h"
+#include "model.h"
+#include "shape.h"
+#include "settings.h"
+#include "slicer/layer.h"
+#include "slicer/infill.h"
+#include "slicer/printlines.h"
+#include "gcode/gcode.h"
+#include "gcode/command.h"
+#include "gcode/commandstore.h"
+#include "gcode/gcodewriter.h"
+#include "printer/print_job.h"
+#include "ui/progress.h"
+
+using namespace std;
+
+
+static double seconds_since(const Glib::TimeVal &start)
+{
+  Glib::TimeVal now;
+  now.assign_current_time();
+  return (now - start).as_double();
+}
+
+static bool load_shapes(const char *path, vector<Shape*> &shapes)
+{
+  File file(Gio::File::create_for_path(path));
+  vector< vector<Triangle> > triangles;
+  vector<ustring> names;
+  Glib::TimeVal start;
+  start.assign_current_time();
+  file.loadTriangles(triangles, names);
+  for (uint i = 0; i < triangles.size(); i++) {
+    if (triangles[i].size() == 0) continue;
+    Shape *shape = new Shape();
+    shape->setTriangles(triangles[i]);
+    shapes.push_back(shape);
+  }
+  cout << "loaded " << path << " in " << seconds_since(start) << " s" << endl;
+  return shapes.size() > 0;
+}
+
+// load FILE a few times, report throughput
+static int bench_load(int argc, char **argv)
+{
+  const uint max_triangles = argc > 1 ? strtol(argv[1], NULL, 10) : 0;
+  ifstream in(argv[0], ifstream::in | ifstream::binary | ifstream::ate);
+  const double megabytes = in.tellg() / 1e6;
+  in.close();
+
+  double best = 0;
+  size_t num = 0;
+  for (uint run = 0; run < 3; run++) {
+    File file(Gio::File::create_for_path(argv[0]));
+    vector< vector<Triangle> > triangles;
+    vector<ustring> names;
+    Glib::TimeVal start;
+    start.assign_current_time();
+    file.loadTriangles(triangles, names, max_triangles);
+    const double t = seconds_since(start);
+    if (run == 0 || t < best) best = t;
+    num = 0;
+    for (uint i = 0; i < triangles.size(); i++)
+      num += triangles[i].size();
+  }
+  cout << argv[0] << ": " << megabytes << " MB, " << num << " triangles in "
+       << best << " s, " << (best > 0 ? megabytes/best : 0) << " MB/s" << endl;
+  return 0;
+}
+
+// slice all layers of shape, returns number of polygons
+static uint slice_shape(Shape &shape, double thickness, bool sweep,
+			double &seconds)
+{
+  Glib::TimeVal start;
+  start.assign_current_time();
+  if (sweep)
+    shape.beginSweep(Matrix4d::IDENTITY);
+  uint npolys = 0;
+  for (double z = shape.Min.z() + thickness/2; z < shape.Max.z(); z += thickness) {
+    vector<Poly> polys, supportpolys;
+    double max_gradient = 0;
+    shape.getPolygonsAtZ(Matrix4d::IDENTITY, z, polys, max_gradient,
+			 supportpolys, -1, thickness);
+    npolys += polys.size();
+  }
+  shape.endSweep();
+  seconds = seconds_since(start);
+  return npolys;
+}
+
+// compare the mesh cutter and sweep with the coordinate matching cutter
+static int bench_slice(int argc, char **argv)
+{
+  vector<Shape*> shapes;
+  if (!load_shapes(argv[0], shapes)) return 1;
+  const double thickness = argc > 1 ? strtod(argv[1], NULL) : 0.2;
+
+  for (uint i = 0; i < shapes.size(); i++) {
+    Shape *shape = shapes[i];
+    cout << shape->info() << endl;
+
+    double t_legacy, t_mesh, t_sweep;
+    shape->legacy_slicing = true;
+    const uint p_legacy = slice_shape(*shape, thickness, false, t_legacy);
+    shape->legacy_slicing = false;
+    const uint p_mesh = slice_shape(*shape, thickness, false, t_mesh); // includes build
+    const uint p_sweep = slice_shape(*shape, thickness, true, t_sweep);
+    const uint nlayers = (uint)ceil((shape->Max.z()-shape->Min.z())/thickness);
+
+    cout << "  layers:         " << nlayers << endl
+	 << "  legacy cutter:  " << t_legacy << " s, " << p_legacy << " polygons" << endl
+	 << "  mesh cutter:    " << t_mesh   << " s, " << p_mesh   << " polygons" << endl
+	 << "  mesh sweep:     " << t_sweep  << " s, " << p_sweep  << " polygons" << endl
+	 << "  speedup:        " << (t_mesh > 0 ? t_legacy/t_mesh : 0)
+	 << " / " << (t_sweep > 0 ? t_legacy/t_sweep : 0) << endl;
+    delete shape;
+  }
+  return 0;
+}
+
+// infill the layers of all shapes with 1, 2, 4 ... threads
+static int bench_infill(int argc, char **argv)
+{
+  vector<Shape*> shapes;
+  if (!load_shapes(argv[0], shapes)) return 1;
+  const double thickness = argc > 1 ? strtod(argv[1], NULL) : 0.2;
+  const double distance  = argc > 2 ? strtod(argv[2], NULL) : 1.0;
+
+  vector<Layer*> layers;
+  for (uint i = 0; i < shapes.size(); i++) {
+    const Shape *shape = shapes[i];
+    for (double z = shape->Min.z() + thickness/2; z < shape->Max.z(); z += thickness) {
+      Layer *layer = new Layer(NULL, layers.size(), thickness, 1);
+      layer->setZ(z);
+      double max_gradient = 0;
+      layer->addShape(Matrix4d::IDENTITY, *shape, z, max_gradient, -1);
+      layer->setMinMax(layer->GetPolygons());
+      layers.push_back(layer);
+    }
+    delete shape;
+  }
+  cout << layers.size() << " layers, infill distance " << distance << endl;
+
+#ifdef _OPENMP
+  const int maxthreads = omp_get_max_threads();
+#else
+  const int maxthreads = 1;
+#endif
+  double t_single = 0;
+  for (int threads = 1; threads <= maxthreads; threads *= 2) {
+    Infill::clearPatterns();
+    Glib::TimeVal start;
+    start.assign_current_time();
+    const int count = (int)layers.size();
+#ifdef _OPENMP
+    omp_set_num_threads(threads);
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = 0; i < count; i++) {
+      Infill infill(layers[i], 1.);
+      infill.addPolys(layers[i]->getZ(), layers[i]->GetPolygons(), ParallelInfill,
+		      distance, distance/2, (i%2)*M_PI/2);
+    }
+    const double t = seconds_since(start);
+    if (threads == 1) t_single = t;
+    cout << "  " << threads << " threads: " << t << " s, speedup "
+	 << (t > 0 ? t_single/t : 0) << endl;
+  }
+  for (uint i = 0; i < layers.size(); i++)
+    delete layers[i];
+  return 0;
+}
+
+// order a synthetic dense layer of short infill segments and small
+// squares, as hex, zigzag and support infill make them
+static double order_lines(const SliceParams &params, const vector<Poly> &segments,
+			  const vector<Poly> &squares, bool legacy, vector<PLine2> &lines)
+{
+  Printlines printlines(NULL, &params);
+  printlines.legacy_search = legacy;
+  printlines.addPolys(INFILL, segments, false);
+  printlines.addPolys(SUPPORT, squares, false);
+  Glib::TimeVal start;
+  start.assign_current_time();
+  Vector2d startPoint(0,0);
+  printlines.makeLines(startPoint, lines);
+  return seconds_since(start);
+}
+
+static int bench_lines(int argc, char **argv)
+{
+  Settings settings;
+  settings.load_settings(Gio::File::create_for_path(argv[0]));
+  const SliceParams params(settings);
+  const uint num = argc > 1 ? strtol(argv[1], NULL, 10) : 5000;
+
+  srand(1);
+  vector<Poly> segments, squares;
+  for (uint i = 0; i < num; i++) {
+    const Vector2d p(rand()%20000/100., rand()%20000/100.);
+    Poly poly(0.2);
+    poly.setClosed(i%4 != 0);
+    poly.addVertex(p);
+    poly.addVertex(p + Vector2d(0.5, 0.3));
+    if (poly.isClosed()) {
+      poly.addVertex(p + Vector2d(0.2, 0.8));
+      poly.addVertex(p + Vector2d(-0.3, 0.5));
+      squares.push_back(poly);
+    } else
+      segments.push_back(poly);
+  }
+  for (uint n = max(1u, num/8); n <= num; n *= 2) {
+    // the first n of the generated polygons
+    const vector<Poly> seg(segments.begin(), segments.begin() + (n+3)/4);
+    const vector<Poly> sq(squares.begin(), squares.begin() + n - (n+3)/4);
+    vector<PLine2> lines_legacy, lines_tree;
+    const double t_legacy = order_lines(params, seg, sq, true,  lines_legacy);
+    const double t_tree   = order_lines(params, seg, sq, false, lines_tree);
+    const bool same = lines_legacy.size() == lines_tree.size() &&
+      (lines_tree.empty() || lines_legacy.back().to == lines_tree.back().to);
+    cout << "  " << seg.size() + sq.size() << " polygons: linear "
+	 << t_legacy << " s, tree " << t_tree << " s, speedup "
+	 << (t_tree > 0 ? t_legacy/t_tree : 0)
+	 << (same ? "" : "  (different order!)") << endl;
+    if (n == num) break;
+    if (2*n > num) n = num/2;
+  }
+  return 0;
+}
+
+// parse all lines of a gcode FILE in place, report lines per second
+static int bench_parse(int argc, char **argv)
+{
+  shared_ptr<const PrintJob> job = PrintJob::FromFile(argv[0]);
+  if (!job) {
+    cerr << "cannot map " << argv[0] << endl;
+    return 1;
+  }
+  const unsigned long numlines = job->GetLineCount();
+  const vector<char> E_letters(1, 'E');
+
+  Glib::TimeVal start;
+  start.assign_current_time();
+  double sum = 0;
+  uint ncommands = 0;
+  for (unsigned long l = 1; l <= numlines; l++) {
+    Command command(job->GetData() + job->GetLineOffset(l), job->GetLineLength(l),
+		    Vector3d::ZERO, E_letters);
+    if (command.Code != COMMENT) ncommands++;
+    sum += command.where.x() + command.e;
+  }
+  const double t = seconds_since(start);
+
+  // the same with a string per line, as the text buffer gives them
+  start.assign_current_time();
+  double sum_string = 0;
+  for (unsigned long l = 1; l <= numlines; l++) {
+    Command command(job->GetLine(l), Vector3d::ZERO, E_letters);
+    sum_string += command.where.x() + command.e;
+  }
+  const double t_string = seconds_since(start);
+
+  cout << argv[0] << ": " << numlines << " lines, " << ncommands << " commands" << endl
+       << "  in place:        " << t << " s, " << (t > 0 ? numlines/t : 0) << " lines/s, "
+       << (t > 0 ? job->GetLength()/t/1e6 : 0) << " MB/s" << endl
+       << "  string per line: " << t_string << " s, "
+       << (t_string > 0 ? numlines/t_string : 0) << " lines/s"
+       << (sum == sum_string ? "" : "  (different results!)") << endl;
+  return 0;
+}
+
+// memory of the commands of a gcode FILE and one pass over them like
+// the time estimation, as Command objects and packed
+static int bench_store(int argc, char **argv)
+{
+  shared_ptr<const PrintJob> job = PrintJob::FromFile(argv[0]);
+  if (!job) {
+    cerr << "cannot map " << argv[0] << endl;
+    return 1;
+  }
+  const unsigned long numlines = job->GetLineCount();
+  const vector<char> E_letters(1, 'E');
+
+  vector<Command> objects;
+  CommandStore store;
+  Vector3d pos(0,0,0);
+  for (unsigned long l = 1; l <= numlines; l++) {
+    Command command(job->GetData() + job->GetLineOffset(l), job->GetLineLength(l),
+		    pos, E_letters);
+    if (command.Code == COMMENT) continue;
+    pos = command.where;
+    objects.push_back(command);
+    store.push_back(command);
+  }
+  size_t objects_bytes = objects.capacity() * sizeof(Command);
+  for (size_t i = 0; i < objects.size(); i++)
+    objects_bytes += objects[i].comment.capacity() + objects[i].explicit_arg.capacity();
+
+  Glib::TimeVal start;
+  start.assign_current_time();
+  double time_objects = 0, feedrate = 0;
+  Vector3d where(0,0,0);
+  for (size_t i = 0; i < objects.size(); i++) {
+    if (objects[i].f != 0) feedrate = objects[i].f;
+    if (feedrate != 0) time_objects += (objects[i].where - where).length()/feedrate;
+    where = objects[i].where;
+  }
+  const double t_objects = seconds_since(start);
+
+  start.assign_current_time();
+  double time_store = 0;
+  feedrate = 0;
+  where = Vector3d(0,0,0);
+  for (size_t i = 0; i < store.size(); i++) {
+    if (store.f(i) != 0) feedrate = store.f(i);
+    if (feedrate != 0) time_store += (store.where(i) - where).length()/feedrate;
+    where = store.where(i);
+  }
+  const double t_store = seconds_since(start);
+
+  cout << argv[0] << ": " << store.size() << " commands" << endl
+       << "  Command objects: " << objects_bytes/1e6 << " MB, pass " << t_objects << " s" << endl
+       << "  packed:          " << store.memory()/1e6 << " MB, pass " << t_store << " s"
+       << (time_objects == time_store ? "" : "  (different results!)") << endl;
+  return 0;
+}
+
+// regenerate the text of the commands of a gcode FILE into OUTFILE,
+// streamed and by adding up a string per command like before
+static int bench_write(int argc, char **argv)
+{
+  if (argc < 2) {
+    cerr << "need GCODEFILE and OUTFILE" << endl;
+    return 1;
+  }
+  shared_ptr<const PrintJob> job = PrintJob::FromFile(argv[0]);
+  if (!job) {
+    cerr << "cannot map " << argv[0] << endl;
+    return 1;
+  }
+  const unsigned long numlines = job->GetLineCount();
+  const vector<char> E_letters(1, 'E');
+
+  CommandStore store;
+  Vector3d pos(0,0,0);
+  for (unsigned long l = 1; l <= numlines; l++) {
+    Command command(job->GetData() + job->GetLineOffset(l), job->GetLineLength(l),
+		    pos, E_letters);
+    if (command.Code == COMMENT) continue;
+    pos = command.where;
+    store.push_back(command);
+  }
+
+  Glib::TimeVal start;
+  start.assign_current_time();
+  GCodeWriter out;
+  if (!out.open(argv[1])) {
+    cerr << "cannot write " << argv[1] << endl;
+    return 1;
+  }
+  Command command;
+  Vector3d LastPos(-10,-10,-10);
+  double lastE = 0, lastF = 0;
+  double t_first = 0;
+  for (size_t i = 0; i < store.size(); i++) {
+    store.get(i, command);
+    command.writeGCode(out, LastPos, lastE, lastF, false);
+    out << '\n';
+    if (t_first == 0 && out.size() >= 1<<16) t_first = seconds_since(start);
+  }
+  const size_t bytes = out.size();
+  out.close();
+  const double t = seconds_since(start);
+
+  start.assign_current_time();
+  string text;
+  LastPos = Vector3d(-10,-10,-10);
+  lastE = lastF = 0;
+  for (size_t i = 0; i < store.size(); i++) {
+    store.get(i, command);
+    text += command.GetGCodeText(LastPos, lastE, lastF, false) + "\n";
+  }
+  Glib::file_set_contents(argv[1], text);
+  const double t_string = seconds_since(start);
+
+  cout << argv[0] << ": " << store.size() << " commands, " << bytes/1e6 << " MB" << endl
+       << "  streamed:        " << t << " s, " << (t > 0 ? bytes/t/1e6 : 0) << " MB/s, "
+       << "first 64 kB after " << t_first << " s" << endl
+       << "  one string:      " << t_string << " s, "
+       << (t_string > 0 ? text.size()/t_string/1e6 : 0) << " MB/s"
+       << (text.size() == bytes ? "" : "  (different results!)") << endl;
+  return 0;
+}
+
+// runs after a change each from the layers of the last run and from
+// scratch, adds their times; false if the two made different gcode
+static bool reslice_runs(Model &model, bool move, const string &group,
+			 const string &key, const string values[2], uint runs,
+			 double &t_reuse, double &t_full)
+{
+  bool same = true;
+  for (uint r = 0; r < runs; r++) {
+    if (move) {
+      model.objtree.Objects[0]->move(Vector3d(r%2 ? -1 : 1, 0, 0));
+      model.ModelChanged();
+    } else
+      model.settings.set_value(group, key, values[(r+1)%2]);
+
+    Glib::TimeVal start;
+    start.assign_current_time();
+    model.ConvertToGCode();
+    t_reuse += seconds_since(start);
+    const string reused = model.gcode.get_text();
+
+    model.ClearLayers();
+    start.assign_current_time();
+    model.ConvertToGCode();
+    t_full += seconds_since(start);
+    if (model.gcode.get_text() != reused) same = false;
+  }
+  return same;
+}
+
+// the times and the comparison of reslice_runs()
+static void reslice_report(Model &model, bool move, const string &group,
+			   const string &key, const string values[2], uint runs)
+{
+  double t_reuse = 0, t_full = 0;
+  const bool same = reslice_runs(model, move, group, key, values, runs,
+				 t_reuse, t_full);
+  cout << "  reusing layers:  " << t_reuse/runs << " s" << endl
+       << "  all anew:        " << t_full/runs << " s" << endl
+       << "  speedup:         " << (t_reuse > 0 ? t_full/t_reuse : 0)
+       << (same ? "" : "  (different results!)") << endl;
+}
+
+// the time to make the gcode of FILE again after changing one setting
+// or moving the first object ("move"), from the layers of the last run
+// and from scratch; again with a raft, and moves also with the first
+// shape scaled
+static int bench_reslice(int argc, char **argv)
+{
+  if (argc < 3) {
+    cerr << "need CONFIG, FILE and GROUP.KEY VALUE or move" << endl;
+    return 1;
+  }
+  const string change = argv[2];
+  const bool move = (change == "move");
+  string group, key, values[2];
+  int nextarg = 3;
+  if (!move) {
+    const size_t dot = change.find('.');
+    if (dot == string::npos || argc < 4) {
+      cerr << "need GROUP.KEY VALUE" << endl;
+      return 1;
+    }
+    group = change.substr(0, dot);
+    key = change.substr(dot+1);
+    values[1] = argv[3];
+    nextarg = 4;
+  }
+  const uint runs = argc > nextarg ? strtol(argv[nextarg], NULL, 10) : 5;
+
+  Model model;
+  ViewProgress progress(NULL, NULL, NULL); // on the terminal
+  model.SetViewProgress(&progress);
+  model.statusbar = NULL;
+  model.LoadConfig(Gio::File::create_for_path(argv[0]));
+  model.Read(Gio::File::create_for_path(argv[1]));
+  if (model.objtree.empty()) {
+    cerr << "no shapes in " << argv[1] << endl;
+    return 1;
+  }
+  if (!move) {
+    try {
+      values[0] = model.settings.get_value(group, key);
+    } catch (const Glib::KeyFileError &err) {
+      cerr << "no setting " << change << endl;
+      return 1;
+    }
+  }
+
+  Glib::TimeVal start;
+  start.assign_current_time();
+  model.ConvertToGCode();
+  const double t_first = seconds_since(start);
+
+  cout << argv[1] << ": changing " << change << ", first run " << t_first << " s" << endl;
+  reslice_report(model, move, group, key, values, runs);
+
+  if (move && !model.objtree.Objects[0]->shapes.empty()) {
+    // the scale is kept apart from the translation (Transform3D)
+    model.ScaleObject(model.objtree.Objects[0]->shapes[0], NULL, 0.5);
+    model.ConvertToGCode();
+    cout << "  first shape scaled by 0.5:" << endl;
+    reslice_report(model, move, group, key, values, runs);
+  }
+
+  // the top raft layer of these is numbered 0 like the first layer
+  model.settings.set_value("Raft", "Enable", "true");
+  model.settings.set_value("Raft", "Base.LayerCount", "1");
+  model.settings.set_value("Raft", "Interface.LayerCount", "2");
+  model.ConvertToGCode();
+  cout << "  with a raft:" << endl;
+  reslice_report(model, move, group, key, values, runs);
+  return 0;
+}
+
+#ifdef HAVE_OSMESA
+// the time per frame of all layers of a gcode FILE, drawn from the
+// prepared lines and each command on its own, on an offscreen context
+static int bench_draw(int argc, char **argv)
+{
+  const int width = 800, height = 600;
+  const uint frames = argc > 1 ? strtol(argv[1], NULL, 10) : 20;
+  OSMesaContext context = OSMesaCreateContextExt(OSMESA_RGBA, 24, 0, 0, NULL);
+  vector<GLubyte> image(width * height * 4);
+  if (!context ||
+      !OSMesaMakeCurrent(context, &image[0], GL_UNSIGNED_BYTE, width, height)) {
+    cerr << "no offscreen GL context" << endl;
+    return 1;
+  }
+  cout << "GL: " << glGetString(GL_RENDERER) << ", " << glGetString(GL_VERSION) << endl;
+
+  ViewProgress progress(NULL, NULL, NULL); // on the terminal
+  GCode gcode;
+  gcode.Read(NULL, vector<char>(1, 'E'), &progress, argv[0]);
+  if (gcode.commands.size() == 0) {
+    cerr << "no commands in " << argv[0] << endl;
+    OSMesaDestroyContext(context);
+    return 1;
+  }
+  Settings settings;
+  settings.set_double("Display","GCodeDrawStart", 0);
+  settings.set_double("Display","GCodeDrawEnd", gcode.Max.z());
+
+  glViewport(0, 0, width, height);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glOrtho(gcode.Min.x(), gcode.Max.x(), gcode.Min.y(), gcode.Max.y(), -1000, 1000);
+  glMatrixMode(GL_MODELVIEW);
+  glLoadIdentity();
+
+  Glib::TimeVal start;
+  start.assign_current_time();
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  gcode.draw(settings);
+  glFinish();
+  const double t_first = seconds_since(start);
+  start.assign_current_time();
+  for (uint f = 0; f < frames; f++) {
+    glRotated(360./frames, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gcode.draw(settings);
+    glFinish();
+  }
+  const double t_retained = seconds_since(start) / frames;
+
+  start.assign_current_time();
+  for (uint f = 0; f < frames; f++) {
+    glRotated(360./frames, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    gcode.drawCommands(settings, 0, gcode.commands.size(), false, 3, false);
+    glFinish();
+  }
+  const double t_immediate = seconds_since(start) / frames;
+
+  cout << argv[0] << ": " << gcode.commands.size() << " commands, "
+       << gcode.layerchanges.size() << " layers" << endl
+       << "  prepared lines:  " << t_retained*1000 << " ms/frame, first frame "
+       << t_first*1000 << " ms" << endl
+       << "  per command:     " << t_immediate*1000 << " ms/frame" << endl;
+  OSMesaDestroyContext(context);
+  return 0;
+}
+#endif
+
+static void usage()
+{
+  cerr << "Usage: repsnapper-bench TEST [ARGS]" << endl
+       << "Tests:" << endl
+       << "  load FILE [MAX_TRIANGLES] load FILE and report MB/s" << endl
+       << "  slice FILE [THICKNESS]    slice all layers of FILE with all cutters" << endl
+       << "  infill FILE [THICKNESS [DISTANCE]]" << endl
+       << "                            infill all layers with increasing thread count" << endl
+       << "  lines CONFIG [POLYGONS]   order a synthetic dense layer into lines" << endl
+       << "  parse GCODEFILE           parse all lines of GCODEFILE" << endl
+       << "  store GCODEFILE           memory of the commands of GCODEFILE" << endl
+       << "  write GCODEFILE OUTFILE   regenerate the text of GCODEFILE" << endl
+       << "  reslice CONFIG FILE GROUP.KEY VALUE [RUNS]" << endl
+       << "  reslice CONFIG FILE move [RUNS]" << endl
+       << "                            make the gcode again after a change," << endl
+       << "                            also with a raft and a scaled shape" << endl
+#ifdef HAVE_OSMESA
+       << "  draw GCODEFILE [FRAMES]   frame time of the preview of GCODEFILE" << endl
+#endif
+    ;
+}
+
+// gtkmm's types without opening a display, gtk_init() would exit
+// without one and no test needs windows
+class HeadlessMain : public Gtk::Main
+{
+public:
+  static void init() { init_gtkmm_internals(); }
+};
+
+int main(int argc, char **argv)
+{
+  Glib::thread_init();
+  gtk_init_check(&argc, &argv);
+  HeadlessMain::init();
+
+  if (argc < 3) {
+    usage();
+    return 1;
+  }
+  const char *test = argv[1];
+  if (!strcmp(test, "load"))
+    return bench_load(argc-2, argv+2);
+  if (!strcmp(test, "slice"))
+    return bench_slice(argc-2, argv+2);
+  if (!strcmp(test, "infill"))
+    return bench_infill(argc-2, argv+2);
+  if (!strcmp(test, "lines"))
+    return bench_lines(argc-2, argv+2);
+  if (!strcmp(test, "parse"))
+    return bench_parse(argc-2, argv+2);
+  if (!strcmp(test, "store"))
+    return bench_store(argc-2, argv+2);
+  if (!strcmp(test, "write"))
+    return bench_write(argc-2, argv+2);
+  if (!strcmp(test, "reslice"))
+    return bench_reslice(argc-2, argv+2);
+#ifdef HAVE_OSMESA
+  if (!strcmp(test, "draw"))
+    return bench_draw(argc-2, argv+2);
+#endif
+
+  usage();
+  return 1;
+}
@@ -22,6 +22,11 @@
 
 #include <iostream>
 #include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 
 static string numlocale   = "";
@@ -44,28 +49,18 @@ void reset_locales() {
 }
 
 
-static float read_float(ifstream &file) {
-	// Read platform independent 32 bit ieee 754 little-endian float.
-	union ieee_union {
-		char buffer[4];
-		struct ieee_struct {
-			unsigned int mantissa:23;
-			unsigned int exponent:8;
-			unsigned int negative:1;
-		} ieee;
-	} ieee;
-	file.read (ieee.buffer, 4);
-
-	GFloatIEEE754 ret;
-	ret.mpn.mantissa = ieee.ieee.mantissa;
-	ret.mpn.biased_exponent = ieee.ieee.exponent;
-	ret.mpn.sign = ieee.ieee.negative;
-
-	return ret.v_float;
+// Platform independent 32 bit ieee 754 little-endian float at p
+static inline float decode_float(const char *p) {
+  guint32 bits;
+  memcpy(&bits, p, 4);
+  bits = GUINT32_FROM_LE(bits);
+  float f;
+  memcpy(&f, &bits, 4);
+  return f;
 }
 
-static double read_double(ifstream &file) {
-  return double(read_float(file));
+static inline Vector3d decode_vector(const char *p) {
+  return Vector3d(decode_float(p), decode_float(p+4), decode_float(p+8));
 }
 
 
@@ -177,80 +172,61 @@ filetype_t File::getFileType(ustring filename)
 bool File::load_binarySTL(vector<Triangle> &triangles,
 			  uint max_triangles, bool readnormals)
 {
-    ifstream file;
     ustring filename = _file->get_path();
-    file.open(filename.c_str(), ifstream::in | ifstream::binary);
-
-    if(file.fail()) {
-      cerr << _("Error: Unable to open stl file - ") << filename << endl;
+    // map the file instead of reading it float by float
+    GError *error = NULL;
+    GMappedFile *mapped = g_mapped_file_new(filename.c_str(), FALSE, &error);
+    if (mapped == NULL) {
+      cerr << _("Error: Unable to open stl file - ") << filename;
+      if (error) {
+	cerr << ": " << error->message;
+	g_error_free(error);
+      }
+      cerr << endl;
       return false;
     }
-    // cerr << "loading bin " << filename << endl;
+    const char *data = g_mapped_file_get_contents(mapped);
+    const size_t length = g_mapped_file_get_length(mapped);
 
     /* Binary STL files have a meaningless 80 byte header
-     * followed by the number of triangles */
-    file.seekg(80, ios_base::beg);
-    unsigned int num_triangles;
-    unsigned char buffer[4];
-    file.read(reinterpret_cast <char *> (buffer), 4);
+     * followed by the number of triangles and 50 byte records */
+    if (length < 84) {
+      cerr << _("Unexpected EOF reading STL file - ") << filename << endl;
+      g_mapped_file_unref(mapped);
+      return false;
+    }
+    const unsigned char *buffer = reinterpret_cast<const unsigned char *>(data + 80);
     // Read platform independent 32-bit little-endian int.
-    num_triangles = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
+    uint num_triangles = buffer[0] | buffer[1] << 8 | buffer[2] << 16 | buffer[3] << 24;
+    if (num_triangles > (length - 84) / 50) {
+      cerr << _("Unexpected EOF reading STL file - ") << filename << endl;
+      num_triangles = (length - 84) / 50;
+    }
 
     uint step = 1;
-    if (max_triangles > 0 && max_triangles < num_triangles) {
-      step = ceil(num_triangles/max_triangles);
-      triangles.reserve(max_triangles);
-    } else
-      triangles.reserve(num_triangles);
-
-    uint i = 0;
-    for(; i < num_triangles; i+=step)
-    {
-      if (step>1)
-	file.seekg(84 + 50*i, ios_base::beg);
-
-      double a,b,c;
-        a = read_double (file);
-        b = read_double (file);
-        c = read_double (file);
-        Vector3d N(a,b,c);
-        a = read_double (file);
-        b = read_double (file);
-        c = read_double (file);
-        Vector3d Ax(a,b,c);
-        a = read_double (file);
-        b = read_double (file);
-        c = read_double (file);
-        Vector3d Bx(a,b,c);
-        a = read_double (file);
-        b = read_double (file);
-        c = read_double (file);
-        Vector3d Cx(a,b,c);
-
-        if (file.eof()) {
-            cerr << _("Unexpected EOF reading STL file - ") << filename << endl;
-            break;
-        }
-
-        /* attribute byte count - sometimes contains face color
-            information but is useless for our purposes */
-        unsigned short byte_count;
-        file.read(reinterpret_cast <char *> (buffer), 2);
-	byte_count = buffer[0] | buffer[1] << 8;
-	// Repress unused variable warning.
-	(void)&byte_count;
-
-	Triangle T = Triangle(Ax,Bx,Cx);
-	if (readnormals)
-	  if (T.Normal.dot(N) < 0) T.invertNormal();
-
-	// cout << "bin triangle "<< N << ":\n\t" << Ax << "/\n\t"<<Bx << "/\n\t"<<Cx << endl;
-        triangles.push_back(T);
+    if (max_triangles > 0 && max_triangles < num_triangles)
+      step = (num_triangles + max_triangles - 1) / max_triangles;
+    const int count = (num_triangles + step - 1) / step;
+
+    // every record is decoded in place, no need to go through the file
+    triangles.resize(count);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int i = 0; i < count; i++) {
+      /* normal, 3 vertices, and a 2 byte attribute count that
+	 sometimes contains face color but is useless for our purposes */
+      const char *record = data + 84 + 50 * (size_t)i * step;
+      Triangle &T = triangles[i];
+      T = Triangle(decode_vector(record + 12),
+		   decode_vector(record + 24),
+		   decode_vector(record + 36));
+      if (readnormals)
+	if (T.Normal.dot(decode_vector(record)) < 0) T.invertNormal();
     }
-    file.close();
+    g_mapped_file_unref(mapped);
 
     return true;
-    // cerr << "Read " << i << " triangles of " << num_triangles << " from file" << endl;
 }
 
 
@@ -259,177 +235,305 @@ bool File::load_asciiSTL(vector< vector<Triangle> > &triangles,
 			 uint max_triangles, bool readnormals)
 {
   ustring filename = _file->get_path();
-  ifstream file;
-  file.open(filename.c_str(), ifstream::in);
-  if(file.fail()) {
-    cerr << _("Error: Unable to open stl file - ") << filename << endl;
+  GError *error = NULL;
+  GMappedFile *mapped = g_mapped_file_new(filename.c_str(), FALSE, &error);
+  if (mapped == NULL) {
+    cerr << _("Error: Unable to open stl file - ") << filename;
+    if (error) {
+      cerr << ": " << error->message;
+      g_error_free(error);
+    }
+    cerr << endl;
     return false;
   }
-  // fileis.imbue(std::locale::classic());
-
   // get as many shapes as found in file
-  while (true) {
-    vector<Triangle> tr;
-    ustring name;
-    if (!File::parseSTLtriangles_ascii(file, max_triangles, readnormals,
-				       tr, name))
-      break;
-
-    triangles.push_back(tr);
-    names.push_back(name);
-    // go back to get "solid " keyword again
-    streampos where = file.tellg();
-    where-=100;
-    if (where < 0) break;
-    file.seekg(where,ios::beg);
-  }
-
-  //     if (ret < 0) {// cannot parse, try binary
-  //       cerr << _("Could not read file in ASCII mode, trying Binary: ")<< filename << endl;
-  //       file.close();
-  //       return loadBinarySTL(filename, max_triangles, readnormals);
-  //     }
-
-  file.close();
-  return true;
+  const bool ok = parseSTLtriangles_ascii(g_mapped_file_get_contents(mapped),
+					  g_mapped_file_get_length(mapped),
+					  max_triangles, readnormals,
+					  triangles, names);
+  g_mapped_file_unref(mapped);
+  return ok;
 }
 
 
-bool File::parseSTLtriangles_ascii (istream &text,
-				    uint max_triangles, bool readnormals,
-				    vector<Triangle> &triangles,
-				    ustring &shapename)
+// Tokenizer for ASCII STL text, works on the text in place
+namespace {
+
+inline bool is_space(char c)
 {
-  //cerr << "loading ascii " << endl;
-  //cerr << " locale " << std::locale().name() << endl;
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t' || c == '\f' || c == '\v';
+}
 
-  shapename = _("Unnamed");
-    // uint step = 1;
-    // if (max_triangles > 0 && max_triangles < num_triangles) {
-    //   step = ceil(num_triangles/max_triangles);
-    streampos pos = text.tellg();
-    text.seekg(0, ios::end);
-    streampos fsize = text.tellg();
-    text.seekg(pos, ios::beg);
+struct STLCursor
+{
+  const char *p, *end;
+  const char *token;
+  size_t length;
+
+  STLCursor(const char *begin, const char *end_) : p(begin), end(end_),
+						   token(begin), length(0) {}
+
+  bool next() {
+    while (p < end && is_space(*p)) p++;
+    token = p;
+    while (p < end && !is_space(*p)) p++;
+    length = p - token;
+    return length > 0;
+  }
+  bool is(const char *keyword) const {
+    return strlen(keyword) == length && memcmp(token, keyword, length) == 0;
+  }
+  // rest of the line, without surrounding blanks
+  string line() {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    const char *begin = p;
+    while (p < end && *p != '\n') p++;
+    const char *last = p;
+    while (last > begin && is_space(last[-1])) last--;
+    return string(begin, last);
+  }
 
-    // a rough estimation
-    uint num_triangles = (fsize-pos)/30;
+  bool number(double &value) {
+    if (!next()) return false;
+    if (parse_number(token, token + length, value)) return true;
+    // unusual notation like inf or nan or many digits
+    string text(token, length);
+    char *numend;
+    value = g_ascii_strtod(text.c_str(), &numend);
+    return numend == text.c_str() + length;
+  }
 
-    uint step = 1;
-    if (max_triangles > 0 && max_triangles < num_triangles)
-      step = ceil(num_triangles/max_triangles);
-
-    //cerr << "step " << step << endl;
-
-    /* ASCII files start with "solid [Name_of_file]"
-     * so get rid of them to access the data */
-    string solid;
-    //getline (text, solid);
-
-    while(!text.eof()) { // Find next solid
-      text >> solid;
-      if (solid == "solid") {
-	string name;
-	getline(text,name);
-	shapename = (ustring)name;
-	break;
-      }
+  // decimal numbers with up to 19 significant digits and small
+  // exponents, exact to the last bit or one off
+  static bool parse_number(const char *s, const char *e, double &value) {
+    static const double pow10[] = {
+      1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+      1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    bool negative = false;
+    if (s < e && (*s == '-' || *s == '+')) negative = (*s++ == '-');
+    guint64 mantissa = 0;
+    int digits = 0, exponent = 0;
+    bool any = false;
+    for (; s < e && *s >= '0' && *s <= '9'; s++, any = true) {
+      if (mantissa == 0 && *s == '0') continue; // leading zeros
+      if (++digits > 19) return false;
+      mantissa = 10 * mantissa + (*s - '0');
     }
-    if (solid != "solid") {
-      return false;
+    if (s < e && *s == '.')
+      for (s++; s < e && *s >= '0' && *s <= '9'; s++, any = true) {
+	exponent--;
+	if (mantissa == 0 && *s == '0') continue;
+	if (++digits > 19) return false;
+	mantissa = 10 * mantissa + (*s - '0');
+      }
+    if (!any) return false;
+    if (s < e && (*s == 'e' || *s == 'E')) {
+      s++;
+      bool negexp = false;
+      if (s < e && (*s == '-' || *s == '+')) negexp = (*s++ == '-');
+      if (s == e) return false;
+      int exp = 0;
+      for (; s < e && *s >= '0' && *s <= '9'; s++)
+	if ((exp = 10 * exp + (*s - '0')) > 1000) return false;
+      exponent += negexp ? -exp : exp;
     }
+    if (s != e) return false;
+    if (exponent < -22 || exponent > 22) return false;
+    value = (double)mantissa;
+    if (exponent < 0) value /= pow10[-exponent];
+    else              value *= pow10[exponent];
+    if (negative) value = -value;
+    return true;
+  }
+};
 
-    // uint itr = 0;
-    while(!text.eof()) { // Loop around all triangles
-      string facet;
-        text >> facet;
-	//cerr << text.tellg() << " - " << fsize << " - " <<facet << endl;
-	if (step > 1) {
-	  for (uint s=0; s < step; s++) {
-	    if (text.eof()) break;
-	    facet = "";
-	    while (facet != "facet" && facet != "endsolid"){
-	      if (text.eof()) break;
-	      text >> facet;
-	    }
-	    if (facet == "endsolid") {
-	      break;
-	    }
-	  }
-	}
-        // Parse possible end of text - "endsolid"
-        if(text.eof() || facet == "endsolid" ) {
-	  break;
-        }
-
-        if(facet != "facet") {
-	  cerr << _("Error: Facet keyword not found in STL text!") << endl;
-	  return false;
-        }
-
-        // Parse Face Normal - "normal %f %f %f"
-        string normal;
-        Vector3d normal_vec;
-        text >> normal;
-        if(readnormals && normal != "normal") {
-	  cerr << _("Error: normal keyword not found in STL text!") << endl;
-	  return false;
-	}
+// start of the first line at or after p
+const char *line_start(const char *begin, const char *p, const char *end)
+{
+  if (p == begin) return p;
+  const char *nl = (const char*)memchr(p - 1, '\n', end - (p - 1));
+  return nl ? nl + 1 : end;
+}
 
-	if (readnormals){
-	  text >> normal_vec.x()
-	       >> normal_vec.y()
-	       >> normal_vec.z();
-	}
+// number of "facet" keywords in [begin, end)
+size_t count_facets(const char *begin, const char *end, const char *text_end)
+{
+  size_t count = 0;
+  for (const char *p = begin; p < end; p++) {
+    p = (const char*)memchr(p, 'f', end - p);
+    if (!p) break;
+    if ((p == begin || is_space(p[-1])) && text_end - p > 5
+	&& memcmp(p, "facet", 5) == 0 && is_space(p[5]))
+      count++;
+  }
+  return count;
+}
 
-        // Parse "outer loop" line
-        string outer, loop;
-	while (outer!="outer" && !text.eof()) {
-	  text >> outer;
-	}
-	text >> loop;
-	if(outer != "outer" || loop != "loop") {
-	  cerr << _("Error: Outer/Loop keywords not found!") << endl;
-	  return false;
+// Result of parsing one part of the text: the triangles of all facets
+// starting there and the solids starting before them
+struct STLChunk
+{
+  const char *begin, *end;
+  size_t first_facet;        // number of facets before begin
+  vector<Triangle> triangles;
+  vector< pair<size_t,string> > solids; // triangle index and name
+  string error;
+};
+
+void parse_chunk(STLChunk &chunk, const char *text_end, bool at_start,
+		 uint step, bool readnormals)
+{
+  STLCursor cursor(chunk.begin, text_end);
+  size_t facet = chunk.first_facet;
+  // the rest of a facet from the part before is skipped
+  bool in_sync = at_start;
+  while (cursor.p < chunk.end) {
+    if (!cursor.next() || cursor.token >= chunk.end) break;
+    if (!in_sync) {
+      if (!cursor.is("facet") && !cursor.is("solid") && !cursor.is("endsolid"))
+	continue;
+      in_sync = true;
+    }
+    if (cursor.is("solid")) {
+      chunk.solids.push_back(pair<size_t,string>(chunk.triangles.size(), cursor.line()));
+      continue;
+    }
+    if (cursor.is("endsolid")) {
+      cursor.line(); // name
+      continue;
+    }
+    if (!cursor.is("facet")) {
+      chunk.error = _("Error: Facet keyword not found in STL text!");
+      return;
+    }
+    if ((facet++) % step != 0) { // skip to endfacet
+      while (cursor.next() && !cursor.is("endfacet")) ;
+      continue;
+    }
+    // "normal %f %f %f" up to "outer loop"
+    Vector3d normal;
+    bool have_normal = false;
+    while (cursor.next() && !cursor.is("outer")) {
+      if (readnormals && cursor.is("normal")) {
+	if (!cursor.number(normal.x()) || !cursor.number(normal.y()) ||
+	    !cursor.number(normal.z())) {
+	  chunk.error = _("Error: normal keyword not found in STL text!");
+	  return;
 	}
+	have_normal = true;
+      }
+    }
+    if (!cursor.is("outer") || !cursor.next() || !cursor.is("loop")) {
+      chunk.error = _("Error: Outer/Loop keywords not found!");
+      return;
+    }
+    // the 3 vertices, each one of the form "vertex %f %f %f"
+    Vector3d vertices[3];
+    for (int i = 0; i < 3; i++) {
+      if (!cursor.next() || !cursor.is("vertex") ||
+	  !cursor.number(vertices[i].x()) || !cursor.number(vertices[i].y()) ||
+	  !cursor.number(vertices[i].z())) {
+	chunk.error = _("Error: Vertex keyword not found");
+	return;
+      }
+    }
+    if (!cursor.next() || !cursor.is("endloop") ||
+	!cursor.next() || !cursor.is("endfacet")) {
+      chunk.error = _("Error: Endloop or endfacet keyword not found");
+      return;
+    }
+    chunk.triangles.push_back(Triangle(vertices[0], vertices[1], vertices[2]));
+    if (have_normal && chunk.triangles.back().Normal.dot(normal) < 0)
+      chunk.triangles.back().invertNormal();
+  }
+}
 
-        // Grab the 3 vertices - each one of the form "vertex %f %f %f"
-        Vector3d vertices[3];
-        for(int i=0; i<3; i++) {
-	    string vertex;
-            text >> vertex
-		 >> vertices[i].x()
-		 >> vertices[i].y()
-		 >> vertices[i].z();
-
-            if(vertex != "vertex") {
-	      cerr << _("Error: Vertex keyword not found") << endl;
-	      return false;
-            }
-        }
+}
 
-        // Parse end of vertices loop - "endloop endfacet"
-        string endloop, endfacet;
-        text >> endloop >> endfacet;
 
-        if(endloop != "endloop" || endfacet != "endfacet") {
-	  cerr << _("Error: Endloop or endfacet keyword not found") << endl;
+// Parse all solids in text. Large texts are split at line starts and
+// the parts parsed in parallel, every part handles the facets whose
+// "facet" keyword lies in it.
+bool File::parseSTLtriangles_ascii (const char *text, size_t length,
+				    uint max_triangles, bool readnormals,
+				    vector< vector<Triangle> > &triangles,
+				    vector<ustring> &names)
+{
+  const char *text_end = text + length;
+  uint nchunks = 1;
+#ifdef _OPENMP
+  if (length > (1<<20))
+    nchunks = min((size_t)4 * omp_get_max_threads(), length >> 18);
+#endif
+  vector<STLChunk> chunks(nchunks);
+  for (uint c = 0; c < nchunks; c++) {
+    chunks[c].begin = line_start(text, text + length * c / nchunks, text_end);
+    if (c > 0) chunks[c-1].end = chunks[c].begin;
+  }
+  chunks[nchunks-1].end = text_end;
+
+  uint step = 1;
+  if (max_triangles > 0) {
+    vector<size_t> counts(nchunks);
+    const int ncount = (int)nchunks;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (int c = 0; c < ncount; c++)
+      counts[c] = count_facets(chunks[c].begin, chunks[c].end, text_end);
+    size_t num_triangles = 0;
+    for (uint c = 0; c < nchunks; c++) {
+      chunks[c].first_facet = num_triangles;
+      num_triangles += counts[c];
+    }
+    if (max_triangles < num_triangles)
+      step = (num_triangles + max_triangles - 1) / max_triangles;
+  } else
+    for (uint c = 0; c < nchunks; c++)
+      chunks[c].first_facet = 0;
+
+  const int ncount = (int)nchunks;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int c = 0; c < ncount; c++)
+    parse_chunk(chunks[c], text_end, c == 0, step, readnormals);
+
+  // join the parts, starting a shape at every solid
+  vector< vector<Triangle> > shapes;
+  vector<ustring> shapenames;
+  for (uint c = 0; c < nchunks; c++) {
+    const STLChunk &chunk = chunks[c];
+    if (!chunk.error.empty()) {
+      cerr << chunk.error << endl;
+      return false;
+    }
+    size_t t = 0;
+    for (uint s = 0; s <= chunk.solids.size(); s++) {
+      const size_t until = s < chunk.solids.size() ? chunk.solids[s].first
+	: chunk.triangles.size();
+      if (until > t) {
+	if (shapes.empty()) { // ASCII files start with "solid [Name]"
+	  cerr << _("Error: Facet keyword not found in STL text!") << endl;
 	  return false;
-        }
-
-        // Create triangle object and push onto the vector
-        Triangle triangle(vertices[0],
-			  vertices[1],
-			  vertices[2]);
-	if (readnormals){
-	  //cerr << "reading normals from file" << endl;
-	  if (triangle.Normal.dot(normal_vec) < 0) triangle.invertNormal();
 	}
-
-        triangles.push_back(triangle);
+	shapes.back().insert(shapes.back().end(),
+			     chunk.triangles.begin() + t,
+			     chunk.triangles.begin() + until);
+	t = until;
+      }
+      if (s < chunk.solids.size()) {
+	shapes.push_back(vector<Triangle>());
+	shapenames.push_back(chunk.solids[s].second.empty() ? _("Unnamed")
+			     : chunk.solids[s].second);
+      }
     }
-    //cerr << "loaded " << filename << endl;
-    return true;
+    vector<Triangle>().swap(chunks[c].triangles);
+  }
+  if (shapes.empty()) return false;
+  triangles.insert(triangles.end(), shapes.begin(), shapes.end());
+  names.insert(names.end(), shapenames.begin(), shapenames.end());
+  return true;
 }
 
 bool File::load_VRML(vector<Triangle> &triangles, uint max_triangles)
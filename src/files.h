@@ -79,10 +79,10 @@ public:
 			const vector<ustring> &names,
 			bool compressed = true);
 
-  static bool parseSTLtriangles_ascii(istream &text,
+  static bool parseSTLtriangles_ascii(const char *text, size_t length,
 				      uint max_triangles, bool readnormals,
-				      vector<Triangle> &triangles,
-				      ustring &name);
+				      vector< vector<Triangle> > &triangles,
+				      vector<ustring> &names);
 
 
   /* static bool loadVRMLtriangles(ustring filename, */
@@ -186,6 +186,13 @@ void FlatShape::clear()
   polygons.clear();
 }
 
+Shape *FlatShape::clone() const
+{
+  FlatShape *shape = new FlatShape(*this);
+  shape->endSweep();
+  return shape;
+}
+
 void FlatShape::draw_geometry(uint max_polygons) {
   const Matrix4d invT = transform3D.getInverse();
   const Vector3d minT = invT*Min;
@@ -50,6 +50,8 @@ class FlatShape : public Shape
 
   void clear();
 
+  Shape *clone() const;
+
   /* void displayInfillOld(const Settings &settings, CuttingPlane &plane,  */
   /* 		      guint LayerNr, vector<int>& altInfillLayers); */
   /* void draw (const Model *model, const Settings &settings, */
@@ -22,9 +22,13 @@
 #include "math.h"
 
 #include "gcode.h"
+#include "gcodewriter.h"
 
 #include <iostream>
 #include <sstream>
+#include <locale>
+#include <stdint.h>
+#include <float.h>
 
 #include "model.h"
 #include "ui/progress.h"
@@ -35,82 +39,133 @@
 
 using namespace std;
 
-// String feeder class
-class Feed {
+// Gcode line feeder, skips over spaces and comments.
+// Reads the caller's characters in place, nothing is copied.
+class GcodeFeed {
 public:
-  Feed(std::string s) : str(s), pos(0) { }
-  char get() {     return (pos < str.size()) ? str[pos++] : 0;  }
-  void unget() {   if (pos) --pos;  }
-protected:
-  std::string str;
-  size_t pos;
-};
-
-// Gcode string feeder, skips over spaces and comments
-class GcodeFeed : public Feed {
-public:
-  GcodeFeed( std::string s) : Feed(s) {}
+  GcodeFeed(const char *line, size_t length) : pos(line), end(line + length) { }
 
   char get() {
     while ( 1 ) {
-      char ch = Feed::get();
+      char ch = next();
 
-      if (isspace(ch)) continue ;
+      if (isspace((unsigned char)ch)) continue ;
 
       if (ch == ';') {// ; COMMENT #EOL
-	str="";
+	pos = end;
 	return 0;
       }
 
       if (ch == '(') // ( COMMENT )
       {
 	while (ch && ch != ')')
-	  ch = Feed::get();
+	  ch = next();
 	continue;
       }
       return ch;
     }
   }
+  void unget() {   --pos;  }
+protected:
+  char next() {    return (pos < end) ? *pos++ : 0;  }
+  const char *pos, *end;
 };
 
-inline std::string ParseNumber(GcodeFeed & f) {
-  std::string str;
-  for (char ch = f.get(); ch; ch = f.get()) {
-    if (ch == ',') ch = '.'; // some program's wrong output with decimal comma in some language(s)
-    if (!isdigit(ch) && ch != '.' && ch != '+' && ch != '-') { // Non-number part
-      f.unget(); // We read something that doesn't belong to us
-      break;
-    }
-    str += ch;
-  }
-  return str;
-}
+static const double POW10[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,
+				1e8,  1e9,  1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+				1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
 
-inline int ToInt(GcodeFeed &f)
+// The float istringstream gives for the number at the start of
+// str, or -1.  str is [+-]digits[.digits] and maybe more.
+static float ParseFloat(const char *str, size_t length)
 {
-	std::istringstream i(ParseNumber(f));
-	int x;
-	if (!(i >> x))
-		return -1;
-	return x;
+  const char *p = str, *end = str + length;
+  const bool negative = (p < end && *p == '-');
+  if (p < end && (*p == '+' || *p == '-')) p++;
+  uint64_t mantissa = 0;
+  int digits = 0, exponent = 0, numdigits = 0;
+  for (; p < end && isdigit((unsigned char)*p); p++, numdigits++)
+    if (mantissa != 0 || *p != '0') {
+      if (++digits <= 19) mantissa = 10*mantissa + (*p - '0');
+      else exponent++;
+    }
+  if (p < end && *p == '.')
+    for (p++; p < end && isdigit((unsigned char)*p); p++, numdigits++)
+      if (mantissa != 0 || *p != '0') {
+	if (++digits <= 19) { mantissa = 10*mantissa + (*p - '0'); exponent--; }
+      } else
+	exponent--;
+  if (numdigits == 0)
+    return -1;
+
+#if FLT_EVAL_METHOD == 0
+  // The double quotient is exact or correctly rounded and rounds to
+  // the same float as the decimal number, unless it lies exactly
+  // between two floats.
+  if (mantissa < (1ULL << 53) && exponent <= 0 && exponent >= -22) {
+    const double d = double(mantissa) / POW10[-exponent];
+    const float f = float(d);
+    const double fd = f;
+    bool halfway = false;
+    if (fd != d) {
+      const double other = nextafterf(f, d > fd ? HUGE_VALF : -HUGE_VALF);
+      halfway = (d - fd == other - d);
+    }
+    if (!halfway)
+      return negative ? -f : f;
+  }
+#endif
+
+  std::istringstream i(string(str, p - str));
+  i.imbue(std::locale::classic());
+  float x;
+  if (!(i >> x))
+    return -1;
+  return x;
 }
 
+// the number after a gcode letter, -1 if there is none
 inline float ToFloat(GcodeFeed &f)
 {
-	std::istringstream i(ParseNumber(f));
-	float x;
-	if (!(i >> x))
-		return -1;
-	return x;
+  char str[64];
+  size_t len = 0;
+  string longstr; // only used for more than 63 characters
+  for (char ch = f.get(); ch; ch = f.get()) {
+    if (ch == ',') ch = '.'; // some program's wrong output with decimal comma in some language(s)
+    if (!isdigit((unsigned char)ch) && ch != '.' && ch != '+' && ch != '-') { // Non-number part
+      f.unget(); // We read something that doesn't belong to us
+      break;
+    }
+    if (len < sizeof(str)) str[len++] = ch;
+    else {
+      if (longstr.empty()) longstr.assign(str, len);
+      longstr += ch;
+    }
+  }
+  if (!longstr.empty())
+    return ParseFloat(longstr.c_str(), longstr.length());
+  return ParseFloat(str, len);
 }
 
-inline double ToDouble(GcodeFeed &f)
+// what getCode() gives for the text letter << num, without the text
+static GCodes getCode(char letter, float num)
 {
-	std::istringstream i(ParseNumber(f));
-	double x;
-	if (!(i >> x))
-		return -1;
-	return x;
+  // only whole numbers print without point or exponent
+  if (num < 0 || num >= 1e6 || num != floorf(num) || std::signbit(num))
+    return COMMENT;
+  const unsigned long number = (unsigned long)num;
+  for (int i = 0; i < NUM_GCODES; i++) {
+    const string &code = MCODES[i];
+    if (code.length() < 2 || code[0] != letter)
+      continue;
+    unsigned long n = 0;
+    uint d;
+    for (d = 1; d < code.length() && isdigit((unsigned char)code[d]); d++)
+      n = 10*n + (code[d] - '0');
+    if (d == code.length() && n == number)
+      return (GCodes)i;
+  }
+  return COMMENT;
 }
 
 
@@ -183,6 +238,12 @@ Command::Command(const Command &rhs)
 {
 }
 
+Command::Command(string gcodeline, const Vector3d &defaultpos,
+		 const vector<char> &E_letters)
+  : Command(gcodeline.data(), gcodeline.length(), defaultpos, E_letters)
+{
+}
+
 /**
  * Parse GCodes from a delivered line.
  * Comments are from ; to end-of-line
@@ -190,12 +251,13 @@ Command::Command(const Command &rhs)
  * Spaces and case outside of comments are ignored completely, according to NIST standard
  * Multiple commands can appear on one line
  * Uninteresting commands are silently dropped.
+ * Nothing is allocated unless the line is a comment.
  *
- * @param gcodeline the string containing a line of gcode
+ * @param line the characters of a line of gcode
+ * @param length the number of characters
  * @param defaultpos
- * @param [OUT] gcodeline the unparsed portion of the string
  */
-Command::Command(string gcodeline, const Vector3d &defaultpos,
+Command::Command(const char *line, size_t length, const Vector3d &defaultpos,
 		 const vector<char> &E_letters)
   : where(defaultpos),  arcIJK(0,0,0), is_value(false),  f(0), e(0),
     extruder_no(0), abs_extr(0), travel_length(0)
@@ -206,28 +268,26 @@ Command::Command(string gcodeline, const Vector3d &defaultpos,
   //   "G02" is the same as "G2"
   //   Multiple Gxx codes on a line are accepted, but results are undefined.
 
-  GcodeFeed buffer(gcodeline) ;
+  GcodeFeed buffer(line, length) ;
   //default:
   Code = COMMENT;
-  comment = gcodeline;
+  bool coded = false; // else the line is the comment
 
   for (char ch = buffer.get(); ch; ch = buffer.get()) {
     // GCode is always <LETTER> <NUMBER>
     ch=toupper(ch);
     float num = ToFloat(buffer) ;
 
-    stringstream commss; commss << ch << num;
-
     switch (ch)
     {
     case 'G':
-      Code = getCode(commss.str());
-      comment = "";
+      Code = ::getCode(ch, num);
+      coded = true;
       break;
     case 'M':           // M commands
       is_value = true;
-      Code = getCode(commss.str());
-      comment = "";
+      Code = ::getCode(ch, num);
+      coded = true;
       break;
     case 'S':  value      = num; break;
     case 'F':  f          = num; break;
@@ -243,8 +303,8 @@ Command::Command(string gcodeline, const Vector3d &defaultpos,
       cerr << "cannot handle ARC R command (yet?)!" << endl;
       break;
     case 'T':
-      Code = getCode("T");
-      comment = "";
+      Code = SELECTEXTRUDER;
+      coded = true;
       extruder_no = num;
       break;
     default:
@@ -256,12 +316,16 @@ Command::Command(string gcodeline, const Vector3d &defaultpos,
 	    e = num;
 	    foundExtr = true;
 	}
-	if (!foundExtr)
-	  cerr << "cannot parse GCode line " << gcodeline << endl;
+	if (!foundExtr) {
+	  cerr << "cannot parse GCode line ";
+	  cerr.write(line, length) << endl;
+	}
 	break;
       }
     }
   }
+  if (!coded)
+    comment.assign(line, length);
 
   if (where.z() < 0) {
     where.z() = 0;
@@ -294,38 +358,37 @@ string Command::GetGCodeText(Vector3d &LastPos, double &lastE, double &lastF,
 			     bool relativeEcode, const char E_letter,
 			     bool speedAlways) const
 {
-  ostringstream ostr;
+  GCodeWriter out;
+  writeGCode(out, LastPos, lastE, lastF, relativeEcode, E_letter, speedAlways);
+  string text;
+  out.take_text(text);
+  return text;
+}
+
+void Command::writeGCode(GCodeWriter &out,
+			 Vector3d &LastPos, double &lastE, double &lastF,
+			 bool relativeEcode, const char E_letter,
+			 bool speedAlways) const
+{
   if (Code > NUM_GCODES || MCODES[Code]=="") {
     cerr << "Don't know GCode for Command type "<< Code <<endl;
-    ostr << "; Unknown GCode for " << info() <<endl;
-    return ostr.str();
+    out << "; Unknown GCode for " << info() << '\n';
+    return;
   }
 
   string comm = comment;
 
-  ostr << MCODES[Code];
-
   if (is_value && Code!=COMMENT){
-    ostr << " S"<<value;
+    out << MCODES[Code] << " S";
+    out.general(value, 6);
     if(comm.length() != 0)
-      ostr << " ; " << comm;
-    return ostr.str();
+      out << " ; " << comm;
+    return;
   }
 
-  bool moving = false; // is a move involved?
-  double thisE = lastE - e; // extraction of this command amount only
-  double length = where.distance(LastPos);
-
-  const uint PREC = 4;
-  ostr.precision(PREC);
-  ostr << fixed ;
-
   switch (Code) {
   case ARC_CW:
   case ARC_CCW:
-    if (arcIJK.x()!=0) ostr << " I" << arcIJK.x();
-    if (arcIJK.y()!=0) ostr << " J" << arcIJK.y();
-    if (arcIJK.z()!=0) ostr << " K" << arcIJK.z();
   case RAPIDMOTION:
   case COORDINATEDMOTION:
     { // going down? -> split xy and z movements
@@ -354,34 +417,56 @@ string Command::GetGCodeText(Vector3d &LastPos, double &lastE, double &lastF,
 	// cerr << info() << endl;
 	// cerr << xycommand.info() << endl;
 	// cerr << zcommand.info() << endl<< endl;
-	ostringstream splstr;
-	splstr << xycommand.GetGCodeText(LastPos, lastE, lastF, relativeEcode, E_letter) << endl;
-	splstr <<  zcommand.GetGCodeText(LastPos, lastE, lastF, relativeEcode, E_letter) ;
-	return splstr.str();
+	xycommand.writeGCode(out, LastPos, lastE, lastF, relativeEcode, E_letter);
+	out << '\n';
+	zcommand.writeGCode(out, LastPos, lastE, lastF, relativeEcode, E_letter);
+	return;
       }
     }
+  default:
+    break;
+  }
+
+  out << MCODES[Code];
+
+  bool moving = false; // is a move involved?
+  double thisE = lastE - e; // extraction of this command amount only
+  double length = where.distance(LastPos);
+
+  const uint PREC = 4;
+
+  switch (Code) {
+  case ARC_CW:
+  case ARC_CCW:
+    if (arcIJK.x()!=0) { out << " I"; out.fixed(arcIJK.x(), PREC); }
+    if (arcIJK.y()!=0) { out << " J"; out.fixed(arcIJK.y(), PREC); }
+    if (arcIJK.z()!=0) { out << " K"; out.fixed(arcIJK.z(), PREC); }
+  case RAPIDMOTION:
+  case COORDINATEDMOTION:
     if(where.x() != LastPos.x()) {
-      ostr << " X" << where.x();
+      out << " X";
+      out.fixed(where.x(), PREC);
       LastPos.x() = where.x();
       moving = true;
     }
     if(where.y() != LastPos.y()) {
-      ostr << " Y" << where.y();
+      out << " Y";
+      out.fixed(where.y(), PREC);
       LastPos.y() = where.y();
       moving = true;
     }
   case ZMOVE:
     if(where.z() != LastPos.z()) {
-      ostr << " Z" << where.z();
+      out << " Z";
+      out.fixed(where.z(), PREC);
       LastPos.z() = where.z();
       comm += _(" Z-Change");
       moving = true;
     }
     if((relativeEcode   && e != 0) ||
        (!relativeEcode  && e != lastE)) {
-      ostr.precision(5);
-      ostr << " " << E_letter << e;
-      ostr.precision(PREC);
+      out << ' ' << E_letter;
+      out.fixed(e, 5);
       lastE = e;
     } else {
       if (moving) {
@@ -391,21 +476,17 @@ string Command::GetGCodeText(Vector3d &LastPos, double &lastE, double &lastF,
     }
   case SETSPEED:
     if (speedAlways || (abs(f-lastF) > 0.1)) {
-      if (f>10)
-	ostr.precision(0);
-      ostr << " F" << f;
-      ostr.precision(PREC);
+      out << " F";
+      out.fixed(f, f>10 ? 0 : PREC);
     }
     lastF = f;
     break;
   case SELECTEXTRUDER:
-    ostr.precision(0);
-    ostr << value;
-    ostr.precision(PREC);
+    out.fixed(value, 0);
     comm += _(" Select Extruder");
     break;
   case RESET_E:
-    ostr << " " << E_letter << "0" ;
+    out << ' ' << E_letter << '0';
     comm += _(" Reset Extrusion");
     lastE = 0;
     break;
@@ -417,34 +498,36 @@ string Command::GetGCodeText(Vector3d &LastPos, double &lastE, double &lastF,
     break;
   }
   if(explicit_arg.length() != 0)
-    ostr << " " << explicit_arg;
+    out << ' ' << explicit_arg;
   if(comm.length() != 0) {
-    if (Code!=COMMENT) ostr << " ; " ;
-    ostr << comm;
+    if (Code!=COMMENT) out << " ; " ;
+    out << comm;
   }
   if(abs_extr != 0) {
-    ostr << " ; AbsE " << abs_extr;
+    out << " ; AbsE ";
+    out.fixed(abs_extr, PREC);
     if (travel_length != 0) {
       const double espeed = abs_extr / travel_length * f / 60;
-      ostr.precision(2);
-      ostr << " ("<< espeed;
+      out << " (";
+      out.fixed(espeed, 2);
       if (thisE != 0) {
 	const double espeed_tot = (thisE + abs_extr) / travel_length * f / 60;
-	ostr << "/" << espeed_tot ;
+	out << '/';
+	out.fixed(espeed_tot, 2);
       }
-      ostr << " mm/s) ";
-      ostr.precision(PREC);
+      out << " mm/s) ";
     } else {
       //  cerr << ostr.str() << endl;
     }
   }
 
-  // ostr << "; "<< info(); // show Command on line
-  return ostr.str();
+  // out << "; "<< info(); // show Command on line
 }
 
 
-void draw_arc(Vector3d &lastPos, Vector3d center, double angle, double dz, short ccw)
+// adds the ends of the line pieces of an arc to lines
+static void arc_lines(Vector3d &lastPos, Vector3d center, double angle, double dz,
+		      short ccw, vector<Vector3d> &lines)
 {
   Vector3d arcpoint;
   Vector3d radiusv = lastPos-center;
@@ -457,12 +540,39 @@ void draw_arc(Vector3d &lastPos, Vector3d center, double angle, double dz, short
   for (long double a = 0; abs(a) < abs(angle); a+=astep){
     arcpoint = center + radiusv.rotate(a, axis);
     if (dz!=0 && angle!=0) arcpoint.z() = startZ + dz*a/angle;
-    glVertex3dv(lastPos);
-    glVertex3dv(arcpoint);
+    lines.push_back(lastPos);
+    lines.push_back(arcpoint);
     lastPos = arcpoint;
   }
 }
 
+void draw_arc(Vector3d &lastPos, Vector3d center, double angle, double dz, short ccw)
+{
+  vector<Vector3d> lines;
+  arc_lines(lastPos, center, angle, dz, ccw, lines);
+  for (uint i = 0; i < lines.size(); i++)
+    glVertex3dv(lines[i]);
+}
+
+void Command::getLines(Vector3d &lastPos, const Vector3d &offset,
+		       vector<Vector3d> &lines) const
+{
+  Vector3d off_where = where + offset;
+  Vector3d off_lastPos = lastPos + offset;
+  if (Code == ARC_CW || Code == ARC_CCW) {
+    Vector3d center = off_lastPos + arcIJK;
+    bool ccw = (Code == ARC_CCW);
+    long double angle = calcAngle(-arcIJK, off_where - center, ccw);
+    double dz = off_where.z()-(off_lastPos).z(); // z move with arc
+    arc_lines(off_lastPos, center, angle, dz, ccw, lines);
+  }
+  if (off_lastPos != off_where) {
+    lines.push_back(off_lastPos);
+    lines.push_back(off_where);
+  }
+  lastPos = where;
+}
+
 void Command::draw(Vector3d &lastPos, const Vector3d &offset,
 		   double extrwidth,
 		   bool arrows,  bool debug_arcs) const
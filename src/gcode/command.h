@@ -139,6 +139,7 @@ const string MCODES[] = {"G92", "", "",
 
 class Model;
 class ViewProgress;
+class GCodeWriter;
 
 class Command
 {
@@ -151,6 +152,8 @@ public:
 	Command(GCodes code, double value); // S value gcodes and letter/number codes
 	Command(string gcodeline, const Vector3d &defaultpos,
 		const vector<char> &E_letters);
+	Command(const char *line, size_t length, const Vector3d &defaultpos,
+		const vector<char> &E_letters);
 	Command(string comment);
 	Command(const Command &rhs);
 	GCodes Code;
@@ -174,6 +177,10 @@ public:
 		  bool debug_arcs = false) const;
 	void draw(Vector3d &lastPos, const Vector3d &offset, double extrwidth,
 		  bool arrows=true, bool debug_arcs = false) const;
+	// the ends of the lines draw() draws without arrows, boundary
+	// and arc debugging
+	void getLines(Vector3d &lastPos, const Vector3d &offset,
+		      vector<Vector3d> &lines) const;
 
 	bool hasNoEffect(const Vector3d LastPos, const double lastE,
 			 const double lastF, const bool relativeEcode) const;
@@ -181,6 +188,10 @@ public:
 	string GetGCodeText(Vector3d &LastPos, double &lastE, double &lastF,
 			    bool relativeEcode, const char E_letter='E',
 			    bool speedAlways = false) const;
+	void writeGCode(GCodeWriter &out,
+			Vector3d &LastPos, double &lastE, double &lastF,
+			bool relativeEcode, const char E_letter='E',
+			bool speedAlways = false) const;
 	GCodes getCode(const string commstr) const;
 
 	void addToPosition(Vector3d &from, bool relative);
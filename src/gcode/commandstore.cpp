@@ -0,0 +1,167 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "commandstore.h"
+
+const unsigned int CommandStore::NONE;
+
+CommandStore::CommandStore()
+{
+  clear();
+}
+
+void CommandStore::clear()
+{
+  codes.clear();
+  flags.clear();
+  extruders.clear();
+  wheres.clear();
+  fs.clear();
+  es.clear();
+  extra_ids.clear();
+  comment_ids.clear();
+  explicit_ids.clear();
+  extras.clear();
+  strings.clear();
+  string_ids.clear();
+  intern("");
+}
+
+void CommandStore::reserve(size_t n)
+{
+  codes.reserve(n);
+  flags.reserve(n);
+  extruders.reserve(n);
+  wheres.reserve(n);
+  fs.reserve(n);
+  es.reserve(n);
+  extra_ids.reserve(n);
+  comment_ids.reserve(n);
+  explicit_ids.reserve(n);
+}
+
+void CommandStore::swap(CommandStore &other)
+{
+  codes.swap(other.codes);
+  flags.swap(other.flags);
+  extruders.swap(other.extruders);
+  wheres.swap(other.wheres);
+  fs.swap(other.fs);
+  es.swap(other.es);
+  extra_ids.swap(other.extra_ids);
+  comment_ids.swap(other.comment_ids);
+  explicit_ids.swap(other.explicit_ids);
+  extras.swap(other.extras);
+  strings.swap(other.strings);
+  string_ids.swap(other.string_ids);
+}
+
+unsigned int CommandStore::intern(const std::string &str)
+{
+  std::unordered_map<std::string, unsigned int>::const_iterator it =
+    string_ids.find(str);
+  if (it != string_ids.end())
+    return it->second;
+  const unsigned int id = strings.size();
+  strings.push_back(str);
+  string_ids[str] = id;
+  return id;
+}
+
+void CommandStore::push_back(const Command &command)
+{
+  codes.push_back((unsigned char)command.Code);
+  flags.push_back((command.is_value ? IS_VALUE : 0) |
+		  (command.not_layerchange ? NOT_LAYERCHANGE : 0));
+  extruders.push_back((unsigned short)command.extruder_no);
+  wheres.push_back(command.where);
+  fs.push_back(command.f);
+  es.push_back(command.e);
+
+  // only arcs have a center, and value is not set for every command
+  const bool arc = (command.Code == ARC_CW || command.Code == ARC_CCW);
+  const bool valued = (command.is_value || command.Code == SELECTEXTRUDER);
+  if (arc || valued || command.abs_extr != 0 || command.travel_length != 0) {
+    Extra extra;
+    extra.arcIJK = arc ? command.arcIJK : Vector3d::ZERO;
+    extra.value = valued ? command.value : 0;
+    extra.abs_extr = command.abs_extr;
+    extra.travel_length = command.travel_length;
+    extra_ids.push_back(extras.size());
+    extras.push_back(extra);
+  }
+  else
+    extra_ids.push_back(NONE);
+
+  comment_ids.push_back(command.comment.empty() ? 0 : intern(command.comment));
+  explicit_ids.push_back(command.explicit_arg.empty() ? 0
+			 : intern(command.explicit_arg));
+}
+
+void CommandStore::get(size_t i, Command &command) const
+{
+  command.Code = (GCodes)codes[i];
+  command.is_value = flags[i] & IS_VALUE;
+  command.not_layerchange = flags[i] & NOT_LAYERCHANGE;
+  command.extruder_no = extruders[i];
+  command.where = wheres[i];
+  command.f = fs[i];
+  command.e = es[i];
+  if (extra_ids[i] != NONE) {
+    const Extra &extra = extras[extra_ids[i]];
+    command.arcIJK = extra.arcIJK;
+    command.value = extra.value;
+    command.abs_extr = extra.abs_extr;
+    command.travel_length = extra.travel_length;
+  } else {
+    command.arcIJK = Vector3d::ZERO;
+    command.value = 0;
+    command.abs_extr = 0;
+    command.travel_length = 0;
+  }
+  command.comment = strings[comment_ids[i]];
+  command.explicit_arg = strings[explicit_ids[i]];
+}
+
+Command CommandStore::operator[](size_t i) const
+{
+  Command command;
+  get(i, command);
+  return command;
+}
+
+void CommandStore::translate(const Vector3d &trans)
+{
+  for (size_t i = 0; i < wheres.size(); i++)
+    wheres[i] += trans;
+}
+
+size_t CommandStore::memory() const
+{
+  size_t bytes = codes.capacity() + flags.capacity()
+    + extruders.capacity() * sizeof(unsigned short)
+    + wheres.capacity() * sizeof(Vector3d)
+    + (fs.capacity() + es.capacity()) * sizeof(double)
+    + (extra_ids.capacity() + comment_ids.capacity() + explicit_ids.capacity())
+      * sizeof(unsigned int)
+    + extras.capacity() * sizeof(Extra);
+  for (size_t s = 0; s < strings.size(); s++)
+    bytes += 2 * (sizeof(std::string) + strings[s].capacity()); // and the map
+  return bytes;
+}
@@ -0,0 +1,89 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+#include "command.h"
+
+// The commands of a GCode, packed in one column per property.  A move
+// takes 56 bytes instead of a whole Command, and loops over some
+// properties (drawing, time estimation) read only those.  Values most
+// commands don't have (arc centers, S values, the slicer's extrusion
+// notes) are kept in a side table, and comments and explicit arguments
+// in a pool where equal strings are stored once.
+class CommandStore
+{
+public:
+  CommandStore();
+
+  size_t size() const { return codes.size(); };
+  bool empty() const { return codes.empty(); };
+  void clear();
+  void reserve(size_t n);
+  void swap(CommandStore &other);
+
+  void push_back(const Command &command);
+
+  // unpacked copy of command i
+  Command operator[](size_t i) const;
+  // unpacks command i into command, reusing its memory
+  void get(size_t i, Command &command) const;
+
+  GCodes code(size_t i) const { return (GCodes)codes[i]; };
+  bool is_value(size_t i) const { return flags[i] & IS_VALUE; };
+  const Vector3d &where(size_t i) const { return wheres[i]; };
+  double f(size_t i) const { return fs[i]; };
+  double e(size_t i) const { return es[i]; };
+  uint extruder_no(size_t i) const { return extruders[i]; };
+  double abs_extr(size_t i) const
+  { return extra_ids[i] == NONE ? 0 : extras[extra_ids[i]].abs_extr; };
+
+  void translate(const Vector3d &trans);
+
+  size_t memory() const; // bytes used, about
+
+private:
+  enum { IS_VALUE = 1, NOT_LAYERCHANGE = 2 };
+  static const unsigned int NONE = ~0u;
+
+  struct Extra {
+    Vector3d arcIJK;
+    double value;
+    double abs_extr;
+    double travel_length;
+  };
+
+  std::vector<unsigned char>  codes;
+  std::vector<unsigned char>  flags;
+  std::vector<unsigned short> extruders;
+  std::vector<Vector3d>       wheres;
+  std::vector<double>         fs, es;
+  std::vector<unsigned int>   extra_ids;    // into extras or NONE
+  std::vector<unsigned int>   comment_ids;  // into strings
+  std::vector<unsigned int>   explicit_ids; // into strings
+
+  std::vector<Extra> extras;
+  std::vector<std::string> strings; // strings[0] is ""
+  std::unordered_map<std::string, unsigned int> string_ids;
+
+  unsigned int intern(const std::string &str);
+};
@@ -21,9 +21,15 @@
 #include "math.h"
 
 #include "gcode.h"
+#include "gcodewriter.h"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <sstream>
+#ifndef WIN32
+#include <unistd.h>
+#endif
 
 #include "model.h"
 #include "ui/progress.h"
@@ -40,14 +46,28 @@ GCode::GCode()
   Max.set(-99999999.0,-99999999.0,-99999999.0);
   Center.set(0,0,0);
   buffer = Gtk::TextBuffer::create();
+  buffer_first_line = 0;
+  buffer_windowed = false;
+  filling_buffer = false;
+  buffer_changed = buffer->signal_changed().connect
+    (sigc::mem_fun(*this, &GCode::on_buffer_changed));
+}
+
+GCode::~GCode()
+{
+  buffer_changed.disconnect();
 }
 
 
 void GCode::clear()
 {
   buffer->erase (buffer->begin(), buffer->end());
+  print_job.reset();
+  buffer_first_line = 0;
+  buffer_windowed = false;
   commands.clear();
   layerchanges.clear();
+  renderer.clear();
   buffer_zpos_lines.clear();
   Min   = Vector3d::ZERO;
   Max   = Vector3d::ZERO;
@@ -64,21 +84,20 @@ double GCode::GetTotalExtruded(bool relativeEcode) const
   if (relativeEcode) {
     double E=0;
     for (uint i=0; i<commands.size(); i++)
-      E += commands[i].e;
+      E += commands.e(i);
     return E;
   } else {
     for (uint i=commands.size()-1; i>0; i--)
-      if (commands[i].e>0)
-	return commands[i].e;
+      if (commands.e(i)>0)
+	return commands.e(i);
   }
   return 0;
 }
 
 void GCode::translate(Vector3d trans)
 {
-  for (uint i=0; i<commands.size(); i++) {
-    commands[i].where += trans;
-  }
+  commands.translate(trans);
+  renderer.clear();
   Min+=trans;
   Max+=trans;
   Center+=trans;
@@ -91,13 +110,13 @@ double GCode::GetTimeEstimation() const
   double time = 0, feedrate=0, distance=0;
   for (uint i=0; i<commands.size(); i++)
 	{
-	  if(commands[i].f!=0)
-		feedrate = commands[i].f;
+	  if(commands.f(i)!=0)
+		feedrate = commands.f(i);
 	  if (feedrate!=0) {
-	    distance = (commands[i].where - where).length();
+	    distance = (commands.where(i) - where).length();
 	    time += distance/feedrate*60.;
 	  }
-	  where = commands[i].where ;
+	  where = commands.where(i);
 	}
   return time;
 }
@@ -110,49 +129,47 @@ string getLineAt(const Glib::RefPtr<Gtk::TextBuffer> buffer, int lineno)
   return buffer->get_text (from, to);
 }
 
+// parse line lineno (from 0) in place
+Command GCode::getCommandAt(unsigned long lineno, const Vector3d &defaultpos,
+			    const vector<char> &E_letters) const
+{
+  if (print_job)
+    return Command(print_job->GetData() + print_job->GetLineOffset(lineno+1),
+		   print_job->GetLineLength(lineno+1), defaultpos, E_letters);
+  return Command(getLineAt(buffer, lineno), defaultpos, E_letters);
+}
+
+unsigned long GCode::getCursorLine() const
+{
+  return buffer_first_line + buffer->get_insert()->get_iter().get_line();
+}
+
 void GCode::updateWhereAtCursor(const vector<char> &E_letters)
 {
-  int line = buffer->get_insert()->get_iter().get_line();
-  // Glib::RefPtr<Gtk::TextBuffer> buf = iter.get_buffer();
+  const unsigned long line = getCursorLine();
   if (line == 0) return;
-  string text = getLineAt(buffer, line-1);
-  Command commandbefore(text, Vector3d::ZERO, E_letters);
+  Command commandbefore = getCommandAt(line-1, Vector3d::ZERO, E_letters);
   Vector3d where = commandbefore.where;
   // complete position of previous line
-  int l = line;
+  unsigned long l = line;
   while (l>0 && where.x()==0) {
     l--;
-    text = getLineAt(buffer, l);
-    where.x() = Command(text, Vector3d::ZERO, E_letters).where.x();
+    where.x() = getCommandAt(l, Vector3d::ZERO, E_letters).where.x();
   }
   l = line;
   while (l>0 && where.y()==0) {
     l--;
-    text = getLineAt(buffer, l);
-    where.y() = Command(text, Vector3d::ZERO, E_letters).where.y();
+    where.y() = getCommandAt(l, Vector3d::ZERO, E_letters).where.y();
   }
-  l = line;
-  // find last z pos fast
-  if (buffer_zpos_lines.size()>0)
-    for (uint i = buffer_zpos_lines.size()-1; i>0 ;i--)
-      {
-	if (int(buffer_zpos_lines[i]) <= l) {
-	  text = getLineAt(buffer, buffer_zpos_lines[i]);
-	  //cerr << text << endl;
-	  Command c(text, Vector3d::ZERO, E_letters);
-	  where.z() = c.where.z();
-	  if (where.z()!=0) break;
-	}
-      }
-  while (l>0 && where.z()==0) {
-    l--;
-    text = getLineAt(buffer, l);
-    Command c(text, Vector3d::ZERO, E_letters);
-    where.z() = c.where.z();
+  // last z pos from the index of all z changes
+  vector<uint>::const_iterator zline =
+    std::upper_bound(buffer_zpos_lines.begin(), buffer_zpos_lines.end(), line);
+  while (zline != buffer_zpos_lines.begin() && where.z()==0) {
+    --zline;
+    where.z() = getCommandAt(*zline, Vector3d::ZERO, E_letters).where.z();
   }
   // current move:
-  text = getLineAt(buffer, line);
-  Command command(text, where, E_letters);
+  Command command = getCommandAt(line, where, E_letters);
   Vector3d dwhere = command.where - where;
   where.z() -= 0.0000001;
   currentCursorWhere = where+dwhere;
@@ -160,72 +177,159 @@ void GCode::updateWhereAtCursor(const vector<char> &E_letters)
   currentCursorFrom = where;
 }
 
+void GCode::setBufferText()
+{
+  buffer_first_line = 0;
+  buffer_windowed = print_job->GetLineCount() > max_buffer_lines;
+  if (buffer_windowed)
+    setBufferWindow(0);
+  else {
+    filling_buffer = true;
+    buffer->set_text(Glib::ustring(print_job->GetData(),
+				   print_job->GetData() + print_job->GetLength()));
+    filling_buffer = false;
+  }
+}
 
-void GCode::Read(Model *model, const vector<char> E_letters,
-		 ViewProgress *progress, string filename)
+// show buffer_window_lines lines around lineno, put the cursor there
+void GCode::setBufferWindow(unsigned long lineno)
 {
-	clear();
+  const unsigned long numlines = print_job->GetLineCount();
+  unsigned long first = lineno > buffer_window_lines/2 ? lineno - buffer_window_lines/2 : 0;
+  if (first + buffer_window_lines > numlines)
+    first = numlines > buffer_window_lines ? numlines - buffer_window_lines : 0;
+  const char *data = print_job->GetData();
+  filling_buffer = true;
+  buffer->set_text(Glib::ustring(data + print_job->GetLineOffset(first+1),
+				 data + print_job->GetLineOffset(first+buffer_window_lines+1)));
+  filling_buffer = false;
+  buffer_first_line = first;
+  buffer->place_cursor(buffer->get_iter_at_line(lineno - first));
+}
 
-	ifstream file;
-	file.open(filename.c_str());		//open a file
-	file.seekg (0, ios::end);
-	double filesize = double(file.tellg());
-	file.seekg (0);
+bool GCode::moveBufferWindow()
+{
+  if (!buffer_windowed) return false;
+  const unsigned long line = getCursorLine();
+  const unsigned long margin = buffer_window_lines/10;
+  const unsigned long end = buffer_first_line + buffer_window_lines;
+  if ((buffer_first_line > 0 && line < buffer_first_line + margin) ||
+      (end < print_job->GetLineCount() && line + margin >= end)) {
+    setBufferWindow(line);
+    return true;
+  }
+  return false;
+}
 
-	progress->start(_("Loading GCode"), filesize);
-	int progress_steps=(int)(filesize/1000);
-	if (progress_steps==0) progress_steps=1;
 
-	buffer_zpos_lines.clear();
+// A part of a gcode file, parsed on its own
+struct GCodeChunk {
+  unsigned long first_line, end_line; // [first_line, end_line), counting from 1
+  vector<Command> commands;    // without comments
+  vector<unsigned long> lines; // the line number of each command
+  bool parsed;
+};
+
+// Parses the lines of a chunk.  Positions depend on the lines before,
+// so axes not given on a line are left NaN here and filled in by
+// GCode::Read in file order.
+static void parse_gcode_chunk(GCodeChunk &chunk, const PrintJob &document,
+			      const vector<char> &E_letters)
+{
+  const double unset = numeric_limits<double>::quiet_NaN();
+  const Vector3d unsetpos(unset, unset, unset);
+  chunk.commands.reserve(chunk.end_line - chunk.first_line);
+  chunk.lines.reserve(chunk.end_line - chunk.first_line);
+  for (unsigned long l = chunk.first_line; l < chunk.end_line; l++) {
+    Command command(document.GetData() + document.GetLineOffset(l),
+		    document.GetLineLength(l), unsetpos, E_letters);
+    if (command.Code == COMMENT)
+      continue;
+    chunk.commands.push_back(command);
+    chunk.lines.push_back(l);
+  }
+  chunk.parsed = true;
+}
+
+void GCode::Read(Model *model, const vector<char> E_letters,
+		 ViewProgress *progress, string filename)
+{
+	clear();
 
-	if(!file.good())
+	shared_ptr<const PrintJob> document = PrintJob::FromFile(filename);
+	if (!document)
 	{
 //		MessageBrowser->add(str(boost::format("Error opening file %s") % Filename).c_str());
 		return;
 	}
+	const unsigned long numlines = document->GetLineCount();
 
-	set_locales("C");
+	progress->start(_("Loading GCode"), document->GetLength());
 
-	uint LineNr = 0;
+	buffer_zpos_lines.clear();
 
-	string s;
+	set_locales("C");
 
+	// go through the commands in order to carry the state
 	bool relativePos = false;
 	Vector3d globalPos(0,0,0);
 	Min.set(99999999.0,99999999.0,99999999.0);
 	Max.set(-99999999.0,-99999999.0,-99999999.0);
 
-	std::vector<Command> loaded_commands;
+	CommandStore loaded_commands;
+	loaded_commands.reserve(numlines); // about, without comments and with layers
 
 	double lastZ=0.;
 	double lastE=0.;
 	double lastF=0.;
 	layerchanges.clear();
 
-	stringstream alltext;
-
 	int current_extruder = 0;
 
-	while(getline(file,s))
-	{
-	  alltext << s << endl;
-
-		LineNr++;
-		unsigned long fpos = file.tellg();
-		if (fpos%progress_steps==0) if (!progress->update(fpos)) break;
-
-		Command command;
+	// Parse the lines in parts on all cores.  Each part is packed into
+	// the store in file order as soon as the parts before it are, so only
+	// about one part per thread is held as whole Commands at a time.
+	const unsigned long chunk_lines = 20000;
+	const int nchunks = (int)((numlines + chunk_lines - 1) / chunk_lines);
+	bool cont = true;
+	bool complete = true; // if cancelled, up to the first part not parsed
+#ifdef _OPENMP
+#pragma omp parallel for ordered schedule(dynamic)
+#endif
+	for (int c = 0; c < nchunks; c++) {
+	  GCodeChunk chunk;
+	  chunk.first_line = c * chunk_lines + 1;
+	  chunk.end_line = min(numlines + 1, (c + 1) * chunk_lines + 1);
+	  chunk.parsed = false;
+#ifdef _OPENMP
+	  #pragma omp flush (cont)
+#endif
+	  if (cont) {
+	    parse_gcode_chunk(chunk, *document, E_letters);
+#ifdef _OPENMP
+	    #pragma omp critical(updateProgress)
+	    {
+	      cont = progress->update(document->GetLineOffset(chunk.end_line));
+	      #pragma omp flush (cont)
+	    }
+#else
+	    cont = progress->update(document->GetLineOffset(chunk.end_line));
+#endif
+	  }
 
-		if (relativePos)
-		  command = Command(s, Vector3d::ZERO, E_letters);
-		else
-		  command = Command(s, globalPos, E_letters);
+#ifdef _OPENMP
+#pragma omp ordered
+#endif
+	  {
+	    if (!chunk.parsed)
+	      complete = false;
+	    for (size_t i = 0; complete && i < chunk.commands.size(); i++)
+	      {
+		Command &command = chunk.commands[i];
+		const unsigned long LineNr = chunk.lines[i];
 
-		if (command.Code == COMMENT) {
-		  continue;
-		}
 		if (command.Code == UNKNOWN) {
-		  cerr << "Unknown GCode " << s << endl;
+		  cerr << "Unknown GCode " << document->GetLine(LineNr) << endl;
 		  continue;
 		}
 		if (command.Code == RELATIVEPOSITIONING) {
@@ -242,6 +346,13 @@ void GCode::Read(Model *model, const vector<char> E_letters,
 		}
 		command.extruder_no = current_extruder;
 
+		// axes not on the line
+		for (uint a = 0; a < 3; a++)
+		  if (std::isnan(command.where[a]))
+		    command.where[a] = relativePos ? 0. : globalPos[a];
+		if (command.where.z() < 0)
+		  command.where.z() = 0;
+
 		// not used yet
 		// if (command.Code == ABSOLUTE_ECODE) {
 		//   relativeE = false;
@@ -312,21 +423,26 @@ void GCode::Read(Model *model, const vector<char> E_letters,
 		    lastZ = globalPos.z();
 		    if (layerchanges.size()>0)
 		      layerchanges.erase(layerchanges.end()-1);
+		    buffer_zpos_lines.push_back(LineNr-1);
 		  }
 		}
 		loaded_commands.push_back(command);
+	      }
+	  }
 	}
 
-	file.close();
 	reset_locales();
 
-	commands = loaded_commands;
+	commands.swap(loaded_commands);
 
-	buffer->set_text(alltext.str());
+	// print the file itself
+	print_job = document;
+	setBufferText();
 
 	Center = (Max + Min)/2;
 
-	model->m_signal_gcode_changed.emit();
+	if (model)
+	  model->m_signal_gcode_changed.emit();
 
 	double time = GetTimeEstimation();
 	int h = (int)time/3600;
@@ -341,7 +457,7 @@ int GCode::getLayerNo(const double z) const
   if (layerchanges.size()>0) // have recorded layerchange indices -> draw whole layers
     for(uint i=0;i<layerchanges.size() ;i++) {
       if (commands.size() > layerchanges[i]) {
-	if (commands[layerchanges[i]].where.z() >= z) {
+	if (commands.where(layerchanges[i]).z() >= z) {
 	  //cerr  << " _ " <<  i << endl;
 	  return i;
 	}
@@ -383,10 +499,13 @@ void GCode::draw(const Settings &settings, int layer,
 	uint start = 0, end = 0;
         uint n_cmds = commands.size();
 	bool arrows = true;
+	uint fromlayer = 0, tolayer = 0; // the layers between start and end
 
 	if (layerchanges.size()>0) {
             // have recorded layerchange indices -> draw whole layers
 	    if (layer>-1) {
+	      fromlayer = layer;
+	      tolayer = layer+1;
 	      if (layer != 0)
 		start = layerchanges[layer];
 
@@ -418,6 +537,8 @@ void GCode::draw(const Settings &settings, int layer,
 	      end = layerchanges[eind];
 	      if (sind == n_changes-1) end = commands.size(); // get last layer
 	      if (eind == n_changes-1) end = commands.size(); // get last layer
+	      fromlayer = sind;
+	      tolayer = (end == commands.size()) ? n_changes : eind;
 	    }
 	}
 	else {
@@ -427,10 +548,15 @@ void GCode::draw(const Settings &settings, int layer,
           }
 	}
 
-	drawCommands(settings, start, end, liveprinting, linewidth,
-		     arrows && settings.get_boolean("Display","DisplayGCodeArrows"),
-		     !liveprinting && settings.get_boolean("Display","DisplayGCodeBorders"),
-                     settings.get_boolean("Display","DebugGCodeOnlyZChange"));
+	arrows = arrows && settings.get_boolean("Display","DisplayGCodeArrows");
+	const bool boundary = !liveprinting &&
+	  settings.get_boolean("Display","DisplayGCodeBorders");
+	const bool onlyZChange = settings.get_boolean("Display","DebugGCodeOnlyZChange");
+	// the prepared lines if there is nothing else to show
+	if (liveprinting || arrows || boundary || onlyZChange || fromlayer >= tolayer ||
+	    !renderer.draw(*this, settings, fromlayer, tolayer, linewidth))
+	  drawCommands(settings, start, end, liveprinting, linewidth,
+		       arrows, boundary, onlyZChange);
 
 	if (currentCursorWhere!=Vector3d::ZERO) {
 	  glDisable(GL_DEPTH_TEST);
@@ -492,9 +618,9 @@ void GCode::drawCommands(const Settings &settings, uint start, uint end,
 	// get starting point
 	if (start>0) {
 	  uint i = start;
-	  while ((commands[i].is_value || commands[i].where == defaultpos) && i < end)
+	  while ((commands.is_value(i) || commands.where(i) == defaultpos) && i < end)
 	    i++;
-	  pos = commands[i].where;
+	  pos = commands.where(i);
         }
 
 	// draw begin
@@ -515,29 +641,41 @@ void GCode::drawCommands(const Settings &settings, uint start, uint end,
 	Vector4f gcodemovecolour = settings.get_colour("Display","GCodeMoveColour");
 	Vector4f gcodeprintingcolour = settings.get_colour("Display","GCodePrintingColour");
 
+	// look up the extruders once, not for every command
+	const uint numext = max(1u, settings.getNumExtruders());
+	vector<Vector3d> ext_offset(numext);
+	vector<double>   ext_maxlinespeed(numext);
+	vector<Vector4f> ext_colour(numext);
+	for (uint e = 0; e < numext; e++) {
+	  const string extrudername = settings.numberedExtruder("Extruder", e);
+	  ext_offset[e]       = settings.get_extruder_offset(e);
+	  ext_maxlinespeed[e] = settings.get_double(extrudername,"MaxLineSpeed");
+	  ext_colour[e]       = settings.get_colour(extrudername,"DisplayColour");
+	}
+
+	Command command; // unpacked for drawing
 	for(uint i=start; i <= end; i++)
 	{
 	        Vector3d extruder_offset = Vector3d::ZERO;
 	        //Vector3d next_extruder_offset = Vector3d::ZERO;
-		string extrudername =
-		  settings.numberedExtruder("Extruder", commands[i].extruder_no);
+		const uint ext = min(commands.extruder_no(i), numext-1);
 
 		// TO BE FIXED:
 		if (!debuggcodeoffset) { // show all together
-		  extruder_offset = settings.get_extruder_offset(commands[i].extruder_no);
+		  extruder_offset = ext_offset[ext];
 		  pos -= extruder_offset - last_extruder_offset;
 		  last_extruder_offset = extruder_offset;
 		}
 		double extrwidth = extrusionwidth;
-	        if (commands[i].is_value) continue;
-                if (onlyZChange && commands[i].where.z() == pos.z()) {
-                  pos = commands[i].where;
-                  LastE=commands[i].e;
+	        if (commands.is_value(i)) continue;
+                if (onlyZChange && commands.where(i).z() == pos.z()) {
+                  pos = commands.where(i);
+                  LastE=commands.e(i);
                   continue;
                 }
 
 
-		switch(commands[i].Code)
+		switch(commands.code(i))
 		{
 		case SETSPEED:
 		case ZMOVE:
@@ -569,45 +707,47 @@ void GCode::drawCommands(const Settings &settings, uint start, uint end,
 		  }
 		case COORDINATEDMOTION:
 		  {
-		    double speed = commands[i].f;
+		    double speed = commands.f(i);
 		    double luma = 1.;
-		    if( (!relativeE && commands[i].e == LastE)
-			|| (relativeE && commands[i].e == 0) ) // move only
+		    if( (!relativeE && commands.e(i) == LastE)
+			|| (relativeE && commands.e(i) == 0) ) // move only
 		      {
 			if (displaygcodemoves) {
 			  luma = 0.3 + 0.7 * speed / maxmove_xy / 60;
 			  Color = gcodemovecolour;
 			  extrwidth = 0;
 			} else {
-			   pos = commands[i].where;
+			   pos = commands.where(i);
 			   break;
 			}
 		      }
 		    else
 		      {
-			luma = 0.3 + 0.7 * speed / settings.get_double(extrudername,"MaxLineSpeed") / 60;
+			luma = 0.3 + 0.7 * speed / ext_maxlinespeed[ext] / 60;
 			if (liveprinting) {
 			  Color = gcodeprintingcolour;
 			} else {
-			  Color = settings.get_colour(extrudername,"DisplayColour");
+			  Color = ext_colour[ext];
 			}
 			if (debuggcodeextruders) {
-			  ostringstream o; o << commands[i].extruder_no+1;
-			  Render::draw_string( (pos + commands[i].where) / 2. + extruder_offset,
+			  ostringstream o; o << commands.extruder_no(i)+1;
+			  Render::draw_string( (pos + commands.where(i)) / 2. + extruder_offset,
 					       o.str());
 			}
 		      }
 		    if (luminanceshowsspeed)
 		      Color *= luma;
-                    commands[i].draw(pos, extruder_offset, linewidth,
+                    commands.get(i, command);
+                    command.draw(pos, extruder_offset, linewidth,
                                      Color, extrwidth, arrows, debug_arcs);
-		    LastE=commands[i].e;
+		    LastE=commands.e(i);
 		    break;
 		  }
 		case RAPIDMOTION:
 		  {
 		    Color = gcodemovecolour;
-                    commands[i].draw(pos, extruder_offset, 1, Color,
+                    commands.get(i, command);
+                    command.draw(pos, extruder_offset, 1, Color,
                                      extrwidth, arrows, debug_arcs);
 		    break;
 		  }
@@ -637,8 +777,7 @@ void GCode::drawCommands(const Settings &settings, uint start, uint end,
 
 
 
-void GCode::MakeText(string &GcodeTxt,
-		     const Settings &settings,
+void GCode::MakeText(const Settings &settings,
 		     ViewProgress * progress)
 {
   string GcodeStart = settings.get_string("GCode","Start");
@@ -649,18 +788,30 @@ void GCode::MakeText(string &GcodeTxt,
 	double lastF = 0; // last Feedrate (can be omitted when same)
 	Vector3d pos(0,0,0);
 	Vector3d LastPos(-10,-10,-10);
-	std::stringstream oss;
+
+	// Write into a temporary file that becomes the print job, so the
+	// text needn't fit into memory.  This runs after all layers are
+	// made, and the job is only mapped when the text is complete.
+	// Mapped files cannot be removed on Windows, so there the text is
+	// collected in memory.
+	GCodeWriter out;
+	string tmppath;
+#ifndef WIN32
+	const bool tofile = out.open_temporary(tmppath);
+#else
+	const bool tofile = false;
+#endif
 
 	Glib::Date date;
 	date.set_time_current();
 	Glib::TimeVal time;
 	time.assign_current_time();
-	GcodeTxt += "; GCode by Repsnapper, "+
-	  date.format_string("%a, %x") +
+	out << "; GCode by Repsnapper, " <<
+	  date.format_string("%a, %x") <<
 	  //time.as_iso8601() +
 	  "\n";
 
-	GcodeTxt += "\n; Startcode\n"+GcodeStart + "; End Startcode\n\n";
+	out << "\n; Startcode\n" << GcodeStart << "; End Startcode\n\n";
 
 	layerchanges.clear();
 	if (progress) progress->restart(_("Collecting GCode"), commands.size());
@@ -677,47 +828,66 @@ void GCode::MakeText(string &GcodeTxt,
 	for (uint i = 0;i<numExt;i++)
 	  extLetters+=settings.get_string(settings.numberedExtruder("Extruder",i),
 					  "GCLetter")[0];
+	Command command; // unpacked for writing
 	for (uint i = 0; i < commands.size(); i++) {
 	  char E_letter;
 	  if (useTcommand) // use first extruder's code for all extuders
 	    E_letter = extLetters[0];
 	  else {
 	    // extruder change?
-	    if (i==0 || commands[i].extruder_no != commands[i-1].extruder_no)
-	      currextruder = commands[i].extruder_no;
+	    if (i==0 || commands.extruder_no(i) != commands.extruder_no(i-1))
+	      currextruder = commands.extruder_no(i);
 	    E_letter = extLetters[currextruder];
 	  }
 	  if (progress && i%progress_steps==0 && !progress->update(i)) break;
 
-	  if ( commands[i].Code == LAYERCHANGE ) {
+	  if ( commands.code(i) == LAYERCHANGE ) {
+	    out.flush(); // keeps the buffer small
 	    layerchanges.push_back(i);
 	    if (GcodeLayer.length()>0)
-	      GcodeTxt += "\n; Layerchange GCode\n" + GcodeLayer +
+	      out << "\n; Layerchange GCode\n" << GcodeLayer <<
 		"; End Layerchange GCode\n\n";
 	  }
 
-	  if ( commands[i].where.z() < 0 )  {
+	  if ( commands.where(i).z() < 0 )  {
 	    cerr << i << " Z < 0 "  << commands[i].info() << endl;
 	  }
 	  else {
-	    GcodeTxt += commands[i].GetGCodeText(LastPos, lastE, lastF,
-						 relativeecode,
-						 E_letter,
-						 speedalways) + "\n";
+	    commands.get(i, command);
+	    command.writeGCode(out, LastPos, lastE, lastF,
+			       relativeecode,
+			       E_letter,
+			       speedalways);
+	    out << '\n';
 	  }
 	}
 
-	GcodeTxt += "\n; End GCode\n" + GcodeEnd + "\n";
+	out << "\n; End GCode\n" << GcodeEnd << '\n';
 
-	buffer->set_text (GcodeTxt);
+	if (tofile) {
+	  if (!out.close())
+	    cerr << _("Error writing GCode to ") << tmppath << endl;
+	  print_job = PrintJob::FromFile(tmppath);
+#ifndef WIN32
+	  unlink(tmppath.c_str()); // the mapping stays
+#endif
+	}
+	if (!print_job) {
+	  string jobtext;
+	  out.take_text(jobtext);
+	  print_job = PrintJob::FromString(jobtext);
+	}
+	setBufferText();
 
 	// save zpos line numbers for faster finding
 	buffer_zpos_lines.clear();
-	uint blines = buffer->get_line_count();
-	for (uint i = 0; i < blines; i++) {
-	  const string line = getLineAt(buffer, i);
-	  if (line.find("Z") != string::npos ||
-	      line.find("z") != string::npos)
+	const char *data = print_job->GetData();
+	const unsigned long numlines = print_job->GetLineCount();
+	for (unsigned long i = 0; i < numlines; i++) {
+	  const char *line = data + print_job->GetLineOffset(i+1);
+	  const char *end = line + print_job->GetLineLength(i+1);
+	  if (std::find(line, end, 'Z') != end ||
+	      std::find(line, end, 'z') != end)
 	    buffer_zpos_lines.push_back(i);
 	}
 
@@ -753,9 +923,30 @@ void GCode::MakeText(string &GcodeTxt,
 
 std::string GCode::get_text () const
 {
+  if (print_job) // the buffer may only show a part
+    return string(print_job->GetData(), print_job->GetLength());
   return buffer->get_text();
 }
 
+shared_ptr<const PrintJob> GCode::GetPrintJob()
+{
+  if (!print_job) { // edited
+    string text = buffer->get_text();
+    print_job = PrintJob::FromString(text);
+  }
+  return print_job;
+}
+
+void GCode::unmapPrintJob(const string &path)
+{
+  if (!print_job || print_job->GetPath().empty() ||
+      !Gio::File::create_for_path(print_job->GetPath())->equal
+      (Gio::File::create_for_path(path)))
+    return;
+  string text(print_job->GetData(), print_job->GetLength());
+  print_job = PrintJob::FromString(text);
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////////
@@ -815,7 +1006,8 @@ Command GCodeIter::getCurrentCommand(Vector3d defaultwhere,
   // cerr <<"currline" << (int) m_cur_line << endl;
   from = m_buffer->get_iter_at_line (m_cur_line);
   to   = m_buffer->get_iter_at_line (m_cur_line+1);
-  Command command(m_buffer->get_text (from, to), defaultwhere, E_letters);
+  const Glib::ustring text = m_buffer->get_text (from, to);
+  Command command(text.data(), text.bytes(), defaultwhere, E_letters);
   return command;
 }
 
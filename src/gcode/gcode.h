@@ -27,6 +27,9 @@
 #include <sstream>
 
 #include "command.h"
+#include "commandstore.h"
+#include "gcoderenderer.h"
+#include "printer/print_job.h"
 
 class GCodeIter
 {
@@ -53,6 +56,7 @@ class GCode
 
 public:
   GCode();
+  ~GCode();
 
   void Read  (Model *model, const vector<char> E_letters,
 	      ViewProgress *progress, string filename);
@@ -63,14 +67,13 @@ public:
   void drawCommands(const Settings &settings, uint start, uint end,
 		    bool liveprinting, int linewidth, bool arrows, bool boundary=false,
                     bool onlyZChange = false);
-  void MakeText(string &GcodeTxt, const Settings &settings,
-		ViewProgress * progress);
+  void MakeText(const Settings &settings, ViewProgress * progress);
 
   //bool append_text (const std::string &line);
   std::string get_text() const;
   void clear();
 
-  std::vector<Command> commands;
+  CommandStore commands;
   uint size() { return commands.size(); };
 
   Vector3d Min, Max, Center;
@@ -80,6 +83,22 @@ public:
   Glib::RefPtr<Gtk::TextBuffer> buffer;
   GCodeIter *get_iter ();
 
+  // the text of buffer for printing, shared with the printer thread
+  shared_ptr<const PrintJob> GetPrintJob();
+  // the print job copied into memory if it is a mapping of path
+  void unmapPrintJob(const string &path);
+
+  // Big files are shown in the buffer only in parts of
+  // buffer_window_lines lines, read-only.  The rest is read from the
+  // mapped file on demand.
+  static const unsigned long max_buffer_lines = 100000;
+  static const unsigned long buffer_window_lines = 20000;
+  bool isBufferWindowed() const { return buffer_windowed; };
+  bool moveBufferWindow(); // around the cursor if it is near the edge
+  unsigned long getCursorLine() const;
+  Command getCommandAt(unsigned long lineno, const Vector3d &defaultpos,
+		       const vector<char> &E_letters) const;
+
   double GetTotalExtruded(bool relativeEcode) const;
   double GetTimeEstimation() const;
 
@@ -87,7 +106,7 @@ public:
   Vector3d currentCursorWhere;
   Vector3d currentCursorFrom;
   Command currentCursorCommand;
-  vector<uint> buffer_zpos_lines; // line numbers where a z position is set
+  vector<uint> buffer_zpos_lines; // line numbers where z changes, sorted
 
 
   vector<unsigned long> layerchanges;
@@ -98,4 +117,16 @@ public:
 
 private:
   unsigned long unconfirmed_blocks;
+
+  GCodeRenderer renderer; // the lines of draw()
+
+  shared_ptr<const PrintJob> print_job; // NULL after the buffer was edited
+  sigc::connection buffer_changed;
+  void on_buffer_changed() { if (!filling_buffer) print_job.reset(); };
+
+  unsigned long buffer_first_line; // line number of the buffer's first line
+  bool buffer_windowed;
+  bool filling_buffer;
+  void setBufferText();
+  void setBufferWindow(unsigned long lineno);
 };
@@ -0,0 +1,296 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "stdafx.h"
+#include "gcoderenderer.h"
+#include "gcode.h"
+#include "settings.h"
+
+#include <stddef.h>
+
+using namespace std;
+
+GCodeRenderer::Style::Style(const Settings &settings)
+{
+  relativeE           = settings.get_boolean("Slicing","RelativeEcode");
+  displaymoves        = settings.get_boolean("Display","DisplayGCodeMoves");
+  luminanceshowsspeed = settings.get_boolean("Display","LuminanceShowsSpeed");
+  debuggcodeoffset    = settings.get_boolean("Display","DebugGCodeOffset");
+  maxmove_xy          = settings.get_double("Hardware","MaxMoveSpeedXY");
+  movecolour          = settings.get_colour("Display","GCodeMoveColour");
+  const uint numext = max(1u, settings.getNumExtruders());
+  ext_offset.resize(numext);
+  ext_maxlinespeed.resize(numext);
+  ext_colour.resize(numext);
+  for (uint e = 0; e < numext; e++) {
+    const string extrudername = settings.numberedExtruder("Extruder", e);
+    ext_offset[e]       = settings.get_extruder_offset(e);
+    ext_maxlinespeed[e] = settings.get_double(extrudername,"MaxLineSpeed");
+    ext_colour[e]       = settings.get_colour(extrudername,"DisplayColour");
+  }
+}
+
+bool GCodeRenderer::Style::operator==(const Style &other) const
+{
+  return relativeE == other.relativeE
+    && displaymoves == other.displaymoves
+    && luminanceshowsspeed == other.luminanceshowsspeed
+    && debuggcodeoffset == other.debuggcodeoffset
+    && maxmove_xy == other.maxmove_xy
+    && movecolour == other.movecolour
+    && ext_offset == other.ext_offset
+    && ext_maxlinespeed == other.ext_maxlinespeed
+    && ext_colour == other.ext_colour;
+}
+
+GCodeRenderer::GCodeRenderer()
+  : made(false), num_commands(0), num_layers(0), use_buffers(-1)
+{
+  for (int b = 0; b < NUM_BATCHES; b++) {
+    batches[b].buffer = 0;
+    batches[b].size = 0;
+  }
+}
+
+// the buffers are deleted when the GL context is current again
+GCodeRenderer::~GCodeRenderer()
+{
+  clear();
+}
+
+void GCodeRenderer::clear()
+{
+  made = false;
+  for (int b = 0; b < NUM_BATCHES; b++) {
+    Platform::releaseGLBuffer(batches[b].buffer);
+    batches[b].buffer = 0;
+    vector<Vertex>().swap(batches[b].vertices);
+    batches[b].layer_start.clear();
+    batches[b].size = 0;
+  }
+}
+
+static GLubyte colour_byte(float c)
+{
+  return (GLubyte)(CLAMP(c, 0.f, 1.f) * 255 + 0.5f);
+}
+
+// the lines as GCode::drawCommands() draws them for all commands
+void GCodeRenderer::make(const GCode &gcode, const Style &current)
+{
+  clear();
+  const CommandStore &commands = gcode.commands;
+  const size_t n_cmds = commands.size();
+  const vector<unsigned long> &layerchanges = gcode.layerchanges;
+  const size_t nlayers = layerchanges.size();
+  const uint numext = current.ext_colour.size();
+
+  for (int b = 0; b < NUM_BATCHES; b++)
+    batches[b].layer_start.push_back(0);
+  size_t layer = 0;
+
+  Vector3d pos(0,0,0);
+  double LastE = 0;
+  Vector3d last_extruder_offset = Vector3d::ZERO;
+  Vector4f Color(0.f,0.f,0.f,1.f);
+  Command command; // unpacked for arcs
+  vector<Vector3d> lines;
+  for (size_t i = 0; i < n_cmds; i++) {
+    while (layer+1 < nlayers && i >= layerchanges[layer+1]) {
+      layer++;
+      for (int b = 0; b < NUM_BATCHES; b++)
+	batches[b].layer_start.push_back(batches[b].vertices.size());
+    }
+    Vector3d extruder_offset = Vector3d::ZERO;
+    const uint ext = min(commands.extruder_no(i), numext-1);
+    if (!current.debuggcodeoffset) { // show all together
+      extruder_offset = current.ext_offset[ext];
+      pos -= extruder_offset - last_extruder_offset;
+      last_extruder_offset = extruder_offset;
+    }
+    if (commands.is_value(i)) continue;
+
+    int batch;
+    switch(commands.code(i))
+      {
+      case ARC_CW:
+      case ARC_CCW:
+	if (i==0)
+	  continue; // wrong startpoint
+      case COORDINATEDMOTION:
+	{
+	  double speed = commands.f(i);
+	  double luma = 1.;
+	  if( (!current.relativeE && commands.e(i) == LastE)
+	      || (current.relativeE && commands.e(i) == 0) ) // move only
+	    {
+	      if (current.displaymoves) {
+		luma = 0.3 + 0.7 * speed / current.maxmove_xy / 60;
+		Color = current.movecolour;
+	      } else {
+		pos = commands.where(i);
+		continue;
+	      }
+	    }
+	  else
+	    {
+	      luma = 0.3 + 0.7 * speed / current.ext_maxlinespeed[ext] / 60;
+	      Color = current.ext_colour[ext];
+	    }
+	  if (current.luminanceshowsspeed)
+	    Color *= luma;
+	  batch = (commands.abs_extr(i) != 0) ? WIDE : NORMAL;
+	  LastE = commands.e(i);
+	  break;
+	}
+      case RAPIDMOTION:
+	Color = current.movecolour;
+	batch = (commands.abs_extr(i) != 0) ? RAPID_WIDE : RAPID;
+	break;
+      default:
+	continue; // ignored GCodes
+      }
+
+    lines.clear();
+    const GCodes code = commands.code(i);
+    if (code == ARC_CW || code == ARC_CCW) {
+      commands.get(i, command);
+      command.getLines(pos, extruder_offset, lines);
+    } else {
+      const Vector3d off_lastPos = pos + extruder_offset;
+      pos = commands.where(i);
+      const Vector3d off_where = pos + extruder_offset;
+      if (off_lastPos != off_where) {
+	lines.push_back(off_lastPos);
+	lines.push_back(off_where);
+      }
+    }
+    Vertex v;
+    v.r = colour_byte(Color[0]);
+    v.g = colour_byte(Color[1]);
+    v.b = colour_byte(Color[2]);
+    v.a = colour_byte(Color[3]);
+    vector<Vertex> &vertices = batches[batch].vertices;
+    for (uint l = 0; l < lines.size(); l++) {
+      v.x = lines[l].x();
+      v.y = lines[l].y();
+      v.z = lines[l].z();
+      vertices.push_back(v);
+    }
+  }
+  // empty last layers
+  for (; layer+1 < max((size_t)1, nlayers); layer++)
+    for (int b = 0; b < NUM_BATCHES; b++)
+      batches[b].layer_start.push_back(batches[b].vertices.size());
+  for (int b = 0; b < NUM_BATCHES; b++) {
+    batches[b].layer_start.push_back(batches[b].vertices.size());
+    batches[b].size = batches[b].vertices.size();
+  }
+
+  style = current;
+  num_commands = n_cmds;
+  num_layers = nlayers;
+  made = true;
+}
+
+// into the buffer objects, and out of memory
+void GCodeRenderer::upload()
+{
+#ifdef HAVE_GL_BUFFERS
+  for (int b = 0; b < NUM_BATCHES; b++) {
+    Batch &batch = batches[b];
+    if (batch.buffer == 0)
+      glGenBuffers(1, &batch.buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+    glBufferData(GL_ARRAY_BUFFER, batch.size * sizeof(Vertex),
+		 batch.size > 0 ? &batch.vertices[0] : NULL, GL_STATIC_DRAW);
+    vector<Vertex>().swap(batch.vertices);
+  }
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
+
+bool GCodeRenderer::draw(const GCode &gcode, const Settings &settings,
+			 uint fromlayer, uint tolayer, int linewidth)
+{
+  if (gcode.layerchanges.empty() ||
+      settings.get_boolean("Display","DisplayDebugArcs") ||
+      settings.get_boolean("Display","DebugGCodeExtruders"))
+    return false;
+
+  if (use_buffers < 0)
+    use_buffers = Platform::haveGLBuffers() ? 1 : 0;
+
+  const Style current(settings);
+  if (!made || num_commands != gcode.commands.size()
+      || num_layers != gcode.layerchanges.size() || !(style == current)) {
+    make(gcode, current);
+    if (use_buffers)
+      upload();
+  }
+
+  tolayer = min(tolayer, (uint)num_layers);
+  if (fromlayer >= tolayer) return true;
+
+  glEnable(GL_BLEND);
+  glDisable(GL_CULL_FACE);
+  glDisable(GL_LIGHTING);
+
+  // draw begin
+  const CommandStore &commands = gcode.commands;
+  uint start = gcode.getLayerStart(fromlayer);
+  while (start < commands.size()-1 &&
+	 (commands.is_value(start) || commands.where(start) == Vector3d::ZERO))
+    start++;
+  const Vector3d &pos = commands.where(start);
+  glPointSize(20);
+  glBegin(GL_POINTS);
+  glVertex3d(pos.x(), pos.y(), pos.z());
+  glEnd();
+
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glEnableClientState(GL_COLOR_ARRAY);
+  const int widths[NUM_BATCHES] = { linewidth, 2*linewidth, 1, 2 };
+  for (int b = 0; b < NUM_BATCHES; b++) {
+    const Batch &batch = batches[b];
+    const uint first = batch.layer_start[fromlayer];
+    const uint count = batch.layer_start[tolayer] - first;
+    if (count == 0) continue;
+    const char *base;
+#ifdef HAVE_GL_BUFFERS
+    if (use_buffers) {
+      glBindBuffer(GL_ARRAY_BUFFER, batch.buffer);
+      base = NULL;
+    } else
+#endif
+      base = (const char *)&batch.vertices[0];
+    glLineWidth(widths[b]);
+    glVertexPointer(3, GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, x));
+    glColorPointer(4, GL_UNSIGNED_BYTE, sizeof(Vertex), base + offsetof(Vertex, r));
+    glDrawArrays(GL_LINES, first, count);
+  }
+#ifdef HAVE_GL_BUFFERS
+  if (use_buffers)
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+  glDisableClientState(GL_COLOR_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+  glLineWidth(1);
+  return true;
+}
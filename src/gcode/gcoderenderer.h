@@ -0,0 +1,83 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#pragma once
+
+#include <vector>
+
+#include "stdafx.h"
+
+// The lines of a GCode's preview, made once into vertex arrays sorted
+// by layer, so a redraw of any range of layers is one glDrawArrays per
+// line width.  The arrays are made again only when the commands or the
+// display settings they depend on changed.  They go into GL buffer
+// objects where the GL has them (1.5), otherwise they are drawn from
+// memory.  Arrows, extrusion boundaries and the debugging displays are
+// left to GCode::drawCommands().
+class GCodeRenderer
+{
+public:
+  GCodeRenderer();
+  ~GCodeRenderer();
+
+  void clear(); // the commands changed
+
+  // draws the layers from..to-1 of gcode, false if it can't with these
+  // settings.  Needs the GL context.
+  bool draw(const GCode &gcode, const Settings &settings,
+	    uint fromlayer, uint tolayer, int linewidth);
+
+private:
+  // what the colours and positions of the lines depend on
+  struct Style {
+    bool relativeE, displaymoves, luminanceshowsspeed, debuggcodeoffset;
+    double maxmove_xy;
+    Vector4f movecolour;
+    std::vector<Vector3d> ext_offset;
+    std::vector<double>   ext_maxlinespeed;
+    std::vector<Vector4f> ext_colour;
+    Style() {};
+    Style(const Settings &settings);
+    bool operator==(const Style &other) const;
+  };
+
+  struct Vertex {
+    GLfloat x, y, z;
+    GLubyte r, g, b, a;
+  };
+
+  // lines of one width: the extrusions and the rapid moves, each also
+  // twice as wide where the extrusion changes, as in Command::draw()
+  enum { NORMAL, WIDE, RAPID, RAPID_WIDE, NUM_BATCHES };
+  struct Batch {
+    std::vector<Vertex> vertices;  // until in the buffer
+    std::vector<uint> layer_start; // first vertex of each layer, and the end
+    GLuint buffer;                 // 0 if none
+    uint size;
+  };
+  Batch batches[NUM_BATCHES];
+
+  bool made;
+  Style style;            // the lines were made with
+  size_t num_commands;    // the lines were made of
+  size_t num_layers;
+  int use_buffers;        // -1 until known
+
+  void make(const GCode &gcode, const Style &current);
+  void upload();
+};
@@ -0,0 +1,167 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "stdafx.h"
+#include "gcodewriter.h"
+
+#include <string.h>
+#include <math.h>
+#include <stdint.h>
+#ifdef WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+GCodeWriter::GCodeWriter()
+  : file(NULL), written(0), failed(false)
+{
+}
+
+GCodeWriter::~GCodeWriter()
+{
+  close();
+}
+
+bool GCodeWriter::open(const std::string &path)
+{
+  close();
+  file = fopen(path.c_str(), "wb");
+  if (!file) return false;
+  flush();
+  return true;
+}
+
+bool GCodeWriter::open_temporary(std::string &path)
+{
+  close();
+  int fd;
+  try {
+    fd = Glib::file_open_tmp(path, "repsnapper");
+  } catch (const Glib::FileError &err) {
+    return false;
+  }
+  file = fdopen(fd, "wb");
+  if (!file) {
+    ::close(fd);
+    return false;
+  }
+  flush();
+  return true;
+}
+
+bool GCodeWriter::close()
+{
+  if (file) {
+    flush();
+    if (fclose(file) != 0)
+      failed = true;
+    file = NULL;
+  }
+  return !failed;
+}
+
+void GCodeWriter::flush()
+{
+  if (!file) return;
+  if (!buffer.empty()) {
+    if (fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size())
+      failed = true;
+    written += buffer.size();
+    buffer.clear();
+  }
+  if (fflush(file) != 0)
+    failed = true;
+}
+
+void GCodeWriter::take_text(std::string &text)
+{
+  text.swap(buffer);
+  buffer.clear();
+  written = 0;
+}
+
+GCodeWriter &GCodeWriter::write(const char *str, size_t length)
+{
+  if (file && length >= BUFFER_SIZE) { // no need to copy it first
+    flush();
+    if (fwrite(str, 1, length, file) != length)
+      failed = true;
+    written += length;
+    return *this;
+  }
+  buffer.append(str, length);
+  checkFull();
+  return *this;
+}
+
+GCodeWriter &GCodeWriter::operator<<(const char *str)
+{
+  return write(str, strlen(str));
+}
+
+GCodeWriter &GCodeWriter::operator<<(char ch)
+{
+  buffer.push_back(ch);
+  checkFull();
+  return *this;
+}
+
+static const double POW10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+GCodeWriter &GCodeWriter::fixed(double value, int precision)
+{
+  // Round the scaled value to an integer.  The multiplication is off by
+  // at most half a unit in the last place, so that gives the digits
+  // printf gives unless the value is too close to halfway between two
+  // numbers of this precision, or too big.
+  if (precision >= 0 && precision <= 9 && fabs(value) < 1e9) {
+    const double scaled = fabs(value) * POW10[precision];
+    const double whole = floor(scaled);
+    const double fraction = scaled - whole;
+    if (fabs(fraction - 0.5) > scaled * 1e-15 + 1e-300) {
+      uint64_t digits = (uint64_t)whole + (fraction > 0.5 ? 1 : 0);
+      char str[32];
+      char *p = str + sizeof(str);
+      for (int i = 0; i < precision; i++) {
+	*--p = '0' + digits % 10;
+	digits /= 10;
+      }
+      if (precision > 0)
+	*--p = '.';
+      do {
+	*--p = '0' + digits % 10;
+	digits /= 10;
+      } while (digits > 0);
+      if (signbit(value))
+	*--p = '-';
+      return write(p, str + sizeof(str) - p);
+    }
+  }
+  char str[400];
+  const int length = snprintf(str, sizeof(str), "%.*f", precision, value);
+  return write(str, length > 0 ? std::min(length, (int)sizeof(str) - 1) : 0);
+}
+
+GCodeWriter &GCodeWriter::general(double value, int precision)
+{
+  char str[64];
+  const int length = snprintf(str, sizeof(str), "%.*g", precision, value);
+  return write(str, length > 0 ? std::min(length, (int)sizeof(str) - 1) : 0);
+}
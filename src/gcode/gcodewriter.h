@@ -0,0 +1,59 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#pragma once
+
+#include <stdio.h>
+#include <string>
+
+// Collects gcode text in memory, or writes it to a file through a
+// small buffer.  Numbers are formatted like printf("%.*f") without
+// going through a stream.
+class GCodeWriter
+{
+public:
+  GCodeWriter(); // in memory until open()
+  ~GCodeWriter();
+
+  bool open(const std::string &path);       // write to a new file
+  bool open_temporary(std::string &path);   // to a new file in the temp dir
+  bool close(); // false if something could not be written
+  void flush(); // everything written so far into the file
+
+  void take_text(std::string &text); // what was written in memory
+  size_t size() const { return written + buffer.size(); };
+
+  GCodeWriter &write(const char *str, size_t length);
+  GCodeWriter &operator<<(const std::string &str)
+    { return write(str.data(), str.length()); };
+  GCodeWriter &operator<<(const char *str);
+  GCodeWriter &operator<<(char ch);
+
+  GCodeWriter &fixed(double value, int precision);   // like "%.*f"
+  GCodeWriter &general(double value, int precision); // like "%.*g"
+
+private:
+  static const size_t BUFFER_SIZE = 1 << 16;
+
+  std::string buffer;
+  FILE *file;
+  size_t written; // to the file
+  bool failed;
+
+  void checkFull() { if (file && buffer.size() >= BUFFER_SIZE) flush(); };
+};
@@ -0,0 +1,486 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+    Copyright (C) 2011-12  martin.dieringer@gmx.de
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "mesh.h"
+
+#include <unordered_map>
+#include <stdint.h>
+#include <string.h>
+
+
+// vertices are welded if their coordinates are bitwise equal,
+// which is what STL files give us for shared corners
+struct VertexKey {
+  double c[3];
+  bool operator==(const VertexKey &other) const {
+    return memcmp(c, other.c, sizeof(c)) == 0;
+  }
+};
+
+struct VertexKeyHash {
+  size_t operator()(const VertexKey &k) const {
+    uint64_t h = 14695981039346656037ULL; // FNV-1a
+    const unsigned char *p = (const unsigned char *)k.c;
+    for (uint i = 0; i < sizeof(k.c); i++) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+    }
+    return (size_t)h;
+  }
+};
+
+static inline uint64_t edge_key(uint a, uint b)
+{
+  if (a > b) { uint tmp = a; a = b; b = tmp; }
+  return ((uint64_t)a << 32) | b;
+}
+
+
+const uint Mesh::NONE;
+
+Mesh::Mesh()
+  : closed(false)
+{
+}
+
+void Mesh::clear()
+{
+  closed = false;
+  vertices.clear();
+  tri_vertices.clear();
+  tri_edges.clear();
+  edge_vertices.clear();
+}
+
+void Mesh::build(const vector<Triangle> &triangles)
+{
+  clear();
+  const uint ntr = triangles.size();
+  tri_vertices.resize(3*ntr);
+  tri_edges.resize(3*ntr, NONE);
+
+  // weld vertices
+  std::unordered_map<VertexKey, uint, VertexKeyHash> vertexmap;
+  vertexmap.reserve(ntr);
+  for (uint t = 0; t < ntr; t++) {
+    for (uint j = 0; j < 3; j++) {
+      const Vector3d &v = triangles[t][j];
+      VertexKey key;
+      // adding 0 turns -0 into 0
+      key.c[0] = v.x() + 0.; key.c[1] = v.y() + 0.; key.c[2] = v.z() + 0.;
+      std::pair<std::unordered_map<VertexKey, uint, VertexKeyHash>::iterator, bool>
+	ins = vertexmap.insert(std::make_pair(key, (uint)vertices.size()));
+      if (ins.second)
+	vertices.push_back(v);
+      tri_vertices[3*t+j] = ins.first->second;
+    }
+  }
+
+  // edges and adjacency
+  closed = true;
+  std::unordered_map<uint64_t, uint> edgemap;
+  edgemap.reserve(3*ntr/2);
+  vector<uint> edge_start; // vertex the first triangle traverses the edge from
+  vector<uint> edge_triangles; // 2 triangle indices per edge
+  for (uint t = 0; t < ntr; t++) {
+    const uint *tv = &tri_vertices[3*t];
+    if (tv[0] == tv[1] || tv[1] == tv[2] || tv[2] == tv[0])
+      continue; // degenerate, no area and no proper edges
+    for (uint j = 0; j < 3; j++) {
+      const uint a = tv[j], b = tv[(j+1)%3];
+      std::pair<std::unordered_map<uint64_t, uint>::iterator, bool>
+	ins = edgemap.insert(std::make_pair(edge_key(a,b), numEdges()));
+      const uint e = ins.first->second;
+      if (ins.second) {
+	edge_vertices.push_back(min(a,b));
+	edge_vertices.push_back(max(a,b));
+	edge_triangles.push_back(t);
+	edge_triangles.push_back(NONE);
+	edge_start.push_back(a);
+      } else if (edge_triangles[2*e+1] == NONE && edge_start[e] == b) {
+	edge_triangles[2*e+1] = t;
+      } else {
+	closed = false; // more than 2 triangles or wrong orientation
+      }
+      tri_edges[3*t+j] = e;
+    }
+  }
+  for (uint e = 0; e < numEdges() && closed; e++)
+    if (edge_triangles[2*e+1] == NONE)
+      closed = false;
+  // kept for the lifetime of the shape, without the spare capacity
+  vertices.shrink_to_fit();
+  edge_vertices.shrink_to_fit();
+}
+
+Triangle Mesh::triangle(uint t) const
+{
+  return Triangle(vertices[tri_vertices[3*t]],
+		  vertices[tri_vertices[3*t+1]],
+		  vertices[tri_vertices[3*t+2]]);
+}
+
+vector<Triangle> Mesh::getTriangles() const
+{
+  vector<Triangle> triangles(numTriangles());
+  for (uint t = 0; t < triangles.size(); t++)
+    triangles[t] = triangle(t);
+  return triangles;
+}
+
+// ABC becomes CBA, with the edges BC, AB, CA
+void Mesh::invert()
+{
+  for (uint t = 0; t < numTriangles(); t++) {
+    std::swap(tri_vertices[3*t], tri_vertices[3*t+2]);
+    std::swap(tri_edges[3*t], tri_edges[3*t+1]);
+  }
+}
+
+void Mesh::mirrorX(const Vector3d &center)
+{
+  for (uint i = 0; i < vertices.size(); i++)
+    vertices[i].x() = center.x() - vertices[i].x();
+  invert();
+}
+
+void Mesh::transformVertices(const Matrix4d &T, VertexArray &result) const
+{
+  const int nv = (int)vertices.size();
+  result.resize(nv);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) if (nv > 100000)
+#endif
+  for (int i = 0; i < nv; i++)
+    result.set(i, T * vertices[i]);
+}
+
+// the point is calculated from the edge's own vertex order,
+// so both triangles sharing the edge get exactly the same result
+Vector2d Mesh::edgeCutPoint(const VertexArray &tvertices,
+			    uint edge, double z) const
+{
+  const uint a = edge_vertices[2*edge], b = edge_vertices[2*edge+1];
+  const double Az = tvertices.z[a], Bz = tvertices.z[b];
+  const double Ax = tvertices.x[a], Ay = tvertices.y[a];
+  const double t = (z - Az)/(Bz - Az);
+  return Vector2d(Ax + (tvertices.x[b] - Ax) * t,
+		  Ay + (tvertices.y[b] - Ay) * t);
+}
+
+bool Mesh::cutAtZ(const VertexArray &tvertices,
+		  const vector<uint> &candidates, double z,
+		  vector< vector<Vector2d> > &loops,
+		  vector<uint> &cut_triangles,
+		  vector< vector<uint> > *loop_edges) const
+{
+  // next[rising edge] = falling edge of the same triangle
+  std::unordered_map<uint, uint> next;
+  next.reserve(candidates.size());
+  for (uint c = 0; c < candidates.size(); c++) {
+    const uint t = candidates[c];
+    if (tri_edges[3*t] == NONE) continue;
+    bool above[3];
+    for (uint j = 0; j < 3; j++)
+      above[j] = (z <= tvertices.z[tri_vertices[3*t+j]]);
+    if (above[0] == above[1] && above[1] == above[2]) continue;
+    uint rising = NONE, falling = NONE;
+    for (uint j = 0; j < 3; j++) {
+      const bool a = above[j], b = above[(j+1)%3];
+      if (!a && b) rising  = tri_edges[3*t+j];
+      else if (a && !b) falling = tri_edges[3*t+j];
+    }
+    next[rising] = falling;
+    cut_triangles.push_back(t);
+  }
+
+  bool allclosed = true;
+  vector<uint> edges;
+  while (!next.empty()) {
+    edges.clear();
+    std::unordered_map<uint, uint>::iterator it = next.begin();
+    const uint start = it->first;
+    uint edge = start;
+    while (it != next.end()) {
+      edges.push_back(edge);
+      edge = it->second;
+      next.erase(it);
+      if (edge == start) break;
+      it = next.find(edge);
+    }
+    if (edge != start) {
+      allclosed = false;
+      edges.push_back(edge);
+    }
+    if (edges.size() > 2) {
+      vector<Vector2d> loop(edges.size());
+      for (uint i = 0; i < edges.size(); i++)
+	loop[i] = edgeCutPoint(tvertices, edges[i], z);
+      loops.push_back(loop);
+      if (loop_edges)
+	loop_edges->push_back(edges);
+    }
+  }
+  return allclosed;
+}
+
+void Mesh::loopPoints(const VertexArray &tvertices,
+		      const vector< vector<uint> > &loop_edges, double z,
+		      vector< vector<Vector2d> > &loops) const
+{
+  for (uint l = 0; l < loop_edges.size(); l++) {
+    const vector<uint> &edges = loop_edges[l];
+    vector<Vector2d> loop(edges.size());
+    for (uint i = 0; i < edges.size(); i++)
+      loop[i] = edgeCutPoint(tvertices, edges[i], z);
+    loops.push_back(loop);
+  }
+}
+
+string Mesh::info() const
+{
+  ostringstream ostr;
+  ostr << "Mesh with " << numVertices() << " vertices, "
+       << numEdges() << " edges, " << numTriangles() << " triangles"
+       << (closed ? "" : " (not closed)");
+  return ostr.str();
+}
+
+
+void ZIntervals::clear()
+{
+  nodes.clear();
+  by_min.clear();
+  by_max.clear();
+  minz.clear();
+  maxz.clear();
+}
+
+void ZIntervals::build(const vector<float> &minz_, const vector<float> &maxz_)
+{
+  clear();
+  minz = minz_;
+  maxz = maxz_;
+  const uint n = minz.size();
+  by_min.reserve(n);
+  by_max.reserve(n);
+  vector<uint> items(n);
+  for (uint i = 0; i < n; i++) items[i] = i;
+  buildNode(items);
+}
+
+struct ZIntervalsMinLess {
+  const vector<float> &z;
+  ZIntervalsMinLess(const vector<float> &z_) : z(z_) {};
+  bool operator()(uint a, uint b) const { return z[a] < z[b]; }
+};
+struct ZIntervalsMaxGreater {
+  const vector<float> &z;
+  ZIntervalsMaxGreater(const vector<float> &z_) : z(z_) {};
+  bool operator()(uint a, uint b) const { return z[a] > z[b]; }
+};
+
+// returns node index; the root is always node 0
+uint ZIntervals::buildNode(vector<uint> &items)
+{
+  if (items.empty()) return Mesh::NONE;
+  // center at median of interval centers:
+  // at most half of the items can end up on either side
+  vector<double> centers(items.size());
+  for (uint i = 0; i < items.size(); i++)
+    centers[i] = (minz[items[i]] + maxz[items[i]]) / 2;
+  std::nth_element(centers.begin(), centers.begin() + centers.size()/2, centers.end());
+  const double center = centers[centers.size()/2];
+
+  vector<uint> left, right, here;
+  for (uint i = 0; i < items.size(); i++) {
+    const uint k = items[i];
+    if (maxz[k] < center)      left.push_back(k);
+    else if (minz[k] > center) right.push_back(k);
+    else                       here.push_back(k);
+  }
+  items.clear();
+
+  const uint n = nodes.size();
+  nodes.push_back(Node());
+  nodes[n].center = center;
+  nodes[n].begin  = by_min.size();
+  std::sort(here.begin(), here.end(), ZIntervalsMinLess(minz));
+  by_min.insert(by_min.end(), here.begin(), here.end());
+  std::sort(here.begin(), here.end(), ZIntervalsMaxGreater(maxz));
+  by_max.insert(by_max.end(), here.begin(), here.end());
+  nodes[n].end = by_min.size();
+  const uint l = buildNode(left);
+  nodes[n].left = l;
+  const uint r = buildNode(right);
+  nodes[n].right = r;
+  return n;
+}
+
+void ZIntervals::query(double zmin, double zmax, vector<uint> &result) const
+{
+  if (nodes.empty()) return;
+  vector<uint> stack;
+  stack.push_back(0);
+  while (!stack.empty()) {
+    const Node &node = nodes[stack.back()];
+    stack.pop_back();
+    if (zmax < node.center) {
+      for (uint i = node.begin; i < node.end && minz[by_min[i]] <= zmax; i++)
+	result.push_back(by_min[i]);
+      if (node.left != Mesh::NONE) stack.push_back(node.left);
+    } else if (zmin > node.center) {
+      for (uint i = node.begin; i < node.end && maxz[by_max[i]] >= zmin; i++)
+	result.push_back(by_max[i]);
+      if (node.right != Mesh::NONE) stack.push_back(node.right);
+    } else {
+      result.insert(result.end(), by_min.begin() + node.begin, by_min.begin() + node.end);
+      if (node.left  != Mesh::NONE) stack.push_back(node.left);
+      if (node.right != Mesh::NONE) stack.push_back(node.right);
+    }
+  }
+}
+
+
+void TransformedMesh::build(const Mesh &mesh, const Matrix4d &T)
+{
+  transform = T;
+  mesh.transformVertices(T, vertices);
+  const uint ntr = mesh.numTriangles();
+  vector<float> minz(ntr), maxz(ntr);
+  for (uint t = 0; t < ntr; t++) {
+    const float z0 = vertices.z[mesh.triangleVertex(t,0)];
+    const float z1 = vertices.z[mesh.triangleVertex(t,1)];
+    const float z2 = vertices.z[mesh.triangleVertex(t,2)];
+    minz[t] = min(z0, min(z1, z2));
+    maxz[t] = max(z0, max(z1, z2));
+  }
+  zranges.build(minz, maxz);
+}
+
+Triangle TransformedMesh::triangle(const Mesh &mesh, uint t) const
+{
+  return Triangle(vertices[mesh.triangleVertex(t,0)],
+		  vertices[mesh.triangleVertex(t,1)],
+		  vertices[mesh.triangleVertex(t,2)]);
+}
+
+
+Matrix4d Overhangs::linearPart(const Matrix4d &T)
+{
+  Matrix4d linear = T;
+  linear.set_translation(0, 0, 0);
+  // Transform3D keeps the scale in the homogeneous coordinate
+  const double w = linear.at(3,3);
+  if (w != 0 && w != 1)
+    linear /= w;
+  return linear;
+}
+
+void Overhangs::build(const Mesh &mesh, const Matrix4d &T, double angle_)
+{
+  static unsigned long num_builds = 0;
+  serial = ++num_builds; // built one at a time (critical section)
+  linear = linearPart(T);
+  angle = angle_;
+  const int ntr = (int)mesh.numTriangles();
+  // not vector<bool>, that is not safe to set in parallel
+  vector<unsigned char> is_steep(ntr);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+  for (int t = 0; t < ntr; t++) {
+    // the normal of the transformed corners, as the slicer sees it
+    const double slope = -mesh.triangle(t).transformed(linear).slopeAngle(Matrix4d::IDENTITY);
+    is_steep[t] = (slope >= angle);
+  }
+  steep.assign(is_steep.begin(), is_steep.end());
+  triangles.clear();
+  for (int t = 0; t < ntr; t++)
+    if (is_steep[t])
+      triangles.push_back(t);
+}
+
+
+struct MeshSweepMinLess {
+  const vector<float> &z;
+  MeshSweepMinLess(const vector<float> &z_) : z(z_) {};
+  bool operator()(uint a, uint b) const { return z[a] < z[b]; }
+};
+
+MeshSweep::MeshSweep(const Mesh &mesh_, std::shared_ptr<const TransformedMesh> tmesh_)
+  : mesh(mesh_), tmesh(tmesh_),
+    z(-INFTY), next_triangle(0), have_loops(false), loops_closed(false)
+{
+  const VertexArray &tv = tmesh->vertices;
+  const uint ntr = mesh.numTriangles();
+  vector<float> tri_minz(ntr);
+  tri_maxz.resize(ntr);
+  by_minz.resize(ntr);
+  for (uint t = 0; t < ntr; t++) {
+    const float z0 = tv.z[mesh.triangleVertex(t,0)];
+    const float z1 = tv.z[mesh.triangleVertex(t,1)];
+    const float z2 = tv.z[mesh.triangleVertex(t,2)];
+    tri_minz[t] = min(z0, min(z1, z2));
+    tri_maxz[t] = max(z0, max(z1, z2));
+    by_minz[t] = t;
+  }
+  std::sort(by_minz.begin(), by_minz.end(), MeshSweepMinLess(tri_minz));
+  by_minz_z.resize(ntr);
+  for (uint i = 0; i < ntr; i++)
+    by_minz_z[i] = tri_minz[by_minz[i]];
+  vertex_z = tv.z;
+  std::sort(vertex_z.begin(), vertex_z.end());
+}
+
+bool MeshSweep::cutAtZ(double newz, vector< vector<Vector2d> > &loops,
+		       vector<uint> &cut_triangles)
+{
+  // a vertex is above the plane if z <= vertex z, so the crossing
+  // topology can only change if a vertex is in [z, newz)
+  const bool events = !have_loops ||
+    std::lower_bound(vertex_z.begin(), vertex_z.end(), z) !=
+    std::lower_bound(vertex_z.begin(), vertex_z.end(), newz);
+  z = newz;
+  if (!events) {
+    mesh.loopPoints(tmesh->vertices, loop_edges, z, loops);
+    cut_triangles.insert(cut_triangles.end(),
+			 loop_triangles.begin(), loop_triangles.end());
+    return loops_closed;
+  }
+
+  // crossing triangles have min z < z <= max z
+  while (next_triangle < by_minz.size() && by_minz_z[next_triangle] < z)
+    active.push_back(by_minz[next_triangle++]);
+  uint nactive = 0;
+  for (uint i = 0; i < active.size(); i++)
+    if (tri_maxz[active[i]] >= z)
+      active[nactive++] = active[i];
+  active.resize(nactive);
+
+  loop_edges.clear();
+  loop_triangles.clear();
+  loops_closed = mesh.cutAtZ(tmesh->vertices, active, z, loops,
+			     loop_triangles, &loop_edges);
+  have_loops = true;
+  cut_triangles.insert(cut_triangles.end(),
+		       loop_triangles.begin(), loop_triangles.end());
+  return loops_closed;
+}
@@ -0,0 +1,212 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+    Copyright (C) 2011-12  martin.dieringer@gmx.de
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+
+#include "stdafx.h"
+#include "triangle.h"
+
+//
+// Vertex coordinates in separate float arrays, for the world space
+// copies of a Mesh's vertices: half the size of Vector3d
+//
+struct VertexArray
+{
+  vector<float> x, y, z;
+
+  uint size() const { return x.size(); };
+  bool empty() const { return x.empty(); };
+  void clear() { x.clear(); y.clear(); z.clear(); };
+  void resize(uint n) { x.resize(n); y.resize(n); z.resize(n); };
+  void set(uint i, const Vector3d &v) { x[i] = v.x(); y[i] = v.y(); z[i] = v.z(); };
+  Vector3d operator[](uint i) const { return Vector3d(x[i], y[i], z[i]); };
+};
+
+//
+// Indexed representation of a triangle soup: coincident vertices are
+// welded and every triangle knows its three edges. Used for slicing,
+// where cut points are identified by the edge they lie on instead of by
+// searching for equal coordinates. Vertices keep their exact
+// coordinates, so this is the storage of a Shape's triangles: they are
+// given back as built (normals come from the corner order).
+//
+class Mesh
+{
+public:
+  Mesh();
+
+  static const uint NONE = (uint)-1;
+
+  void build(const vector<Triangle> &triangles);
+  void clear();
+
+  bool empty() const { return tri_vertices.empty(); };
+  // every edge is shared by exactly two triangles running in opposite
+  // directions, so all plane cuts are closed loops
+  bool isClosed() const { return closed; };
+
+  uint numVertices()  const { return vertices.size(); };
+  uint numTriangles() const { return tri_vertices.size()/3; };
+  uint numEdges()     const { return edge_vertices.size()/2; };
+
+  const vector<Vector3d> &getVertices() const { return vertices; };
+  uint triangleVertex(uint t, uint j) const { return tri_vertices[3*t+j]; };
+  uint triangleEdge  (uint t, uint j) const { return tri_edges[3*t+j]; };
+  uint edgeVertex    (uint e, uint j) const { return edge_vertices[2*e+j]; };
+
+  Triangle triangle(uint t) const;
+  vector<Triangle> getTriangles() const;
+  // turn all triangles over, as Triangle::invertNormal()
+  void invert();
+  // as Triangle::mirrorX()
+  void mirrorX(const Vector3d &center);
+
+  // all vertices multiplied by T
+  void transformVertices(const Matrix4d &T, VertexArray &result) const;
+
+  // Cut the (transformed) mesh with the plane at z. Each crossing
+  // triangle gives a segment from its rising to its falling edge,
+  // segments are chained into loops by following the shared edges.
+  // Only the given candidate triangles are tested, cut_triangles gets
+  // the indices of the crossing ones.
+  // Returns false if a loop does not close.
+  // If loop_edges is given it gets the edge sequence of every loop.
+  bool cutAtZ(const VertexArray &tvertices,
+	      const vector<uint> &candidates, double z,
+	      vector< vector<Vector2d> > &loops,
+	      vector<uint> &cut_triangles,
+	      vector< vector<uint> > *loop_edges = NULL) const;
+  // cut points of known edge loops at z
+  void loopPoints(const VertexArray &tvertices,
+		  const vector< vector<uint> > &loop_edges, double z,
+		  vector< vector<Vector2d> > &loops) const;
+
+  string info() const;
+
+private:
+  bool closed;
+
+  vector<Vector3d> vertices;   // welded vertices
+  vector<uint> tri_vertices;   // 3 vertex indices per triangle
+  vector<uint> tri_edges;      // 3 edge indices per triangle (AB, BC, CA),
+                               // NONE for degenerate triangles
+  vector<uint> edge_vertices;  // 2 vertex indices per edge
+
+  Vector2d edgeCutPoint(const VertexArray &tvertices,
+			uint edge, double z) const;
+};
+
+
+//
+// Static interval tree over z ranges, finds all intervals overlapping
+// a query range in O(log n + k)
+//
+class ZIntervals
+{
+public:
+  void build(const vector<float> &minz, const vector<float> &maxz);
+  void clear();
+  // indices of all intervals overlapping [zmin, zmax]
+  void query(double zmin, double zmax, vector<uint> &result) const;
+
+private:
+  struct Node {
+    double center;
+    uint left, right;  // child nodes
+    uint begin, end;   // range in by_min and by_max
+  };
+  vector<Node> nodes;
+  vector<uint> by_min; // intervals containing node center, ascending min
+  vector<uint> by_max; // same intervals, descending max
+  vector<float> minz, maxz;
+
+  uint buildNode(vector<uint> &items);
+};
+
+//
+// A Mesh under one transformation, with the z ranges of all triangles
+// indexed so each slice only visits the triangles crossing it.
+//
+struct TransformedMesh
+{
+  Matrix4d transform;
+  VertexArray vertices;
+  ZIntervals zranges;
+
+  void build(const Mesh &mesh, const Matrix4d &T);
+  // triangle t of mesh in world space
+  Triangle triangle(const Mesh &mesh, uint t) const;
+};
+
+//
+// The triangles that need support: steeper downwards than an angle
+// under the rotation and scale of a transform.  The translation does
+// not change slopes, so moving a shape keeps its Overhangs.
+//
+struct Overhangs
+{
+  Matrix4d linear; // the transform without translation, w = 1
+  double angle;    // radians, as Triangle::slopeAngle()
+  vector<bool> steep;     // per triangle
+  vector<uint> triangles; // the steep ones
+  unsigned long serial;   // different for every build
+
+  static Matrix4d linearPart(const Matrix4d &T);
+  void build(const Mesh &mesh, const Matrix4d &T, double angle);
+};
+
+//
+// A plane sweeping upwards through a TransformedMesh. The set of crossing
+// triangles is updated at the triangles' z events, and as long as no
+// vertex lies between two cuts the loops of the last cut are reused and
+// only their points are recalculated.
+//
+class MeshSweep
+{
+public:
+  MeshSweep(const Mesh &mesh, std::shared_ptr<const TransformedMesh> tmesh);
+
+  const Matrix4d &getTransform() const { return tmesh->transform; };
+  double getZ() const { return z; };
+
+  // move the plane up to newz >= getZ() and cut like Mesh::cutAtZ
+  bool cutAtZ(double newz, vector< vector<Vector2d> > &loops,
+	      vector<uint> &cut_triangles);
+
+private:
+  const Mesh &mesh;
+  std::shared_ptr<const TransformedMesh> tmesh;
+
+  double z;
+  vector<uint> by_minz;       // triangles sorted by lowest z
+  vector<float> by_minz_z;    // their lowest z
+  vector<float> tri_maxz;
+  uint next_triangle;         // next to activate in by_minz
+  vector<uint> active;        // triangles crossing the plane
+  vector<float> vertex_z;     // sorted, the topology changes only here
+
+  bool have_loops;            // result of the last cut:
+  bool loops_closed;
+  vector< vector<uint> > loop_edges;
+  vector<uint> loop_triangles;
+};
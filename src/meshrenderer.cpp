@@ -0,0 +1,232 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "stdafx.h"
+#include "meshrenderer.h"
+
+#include <stddef.h>
+
+MeshRenderer::MeshRenderer()
+  : made(false), num_corners(0), num_normal_ends(0), normals_length(0),
+    num_edge_indices(0), num_subset_indices(0), subset_serial(0),
+    vertex_buffer(0), index_buffer(0), subset_buffer(0)
+{
+}
+
+MeshRenderer::MeshRenderer(const MeshRenderer &rhs)
+  : made(false), num_corners(0), num_normal_ends(0),
+    normals_length(rhs.normals_length),
+    num_edge_indices(0), num_subset_indices(0), subset_serial(0),
+    vertex_buffer(0), index_buffer(0), subset_buffer(0)
+{
+}
+
+MeshRenderer &MeshRenderer::operator=(const MeshRenderer &rhs)
+{
+  clear();
+  normals_length = rhs.normals_length;
+  return *this;
+}
+
+// the buffers are deleted when the GL context is current again
+MeshRenderer::~MeshRenderer()
+{
+  clear();
+}
+
+void MeshRenderer::clear()
+{
+  Platform::releaseGLBuffer(vertex_buffer);
+  Platform::releaseGLBuffer(index_buffer);
+  Platform::releaseGLBuffer(subset_buffer);
+  vertex_buffer = index_buffer = subset_buffer = 0;
+  made = false;
+  num_corners = num_normal_ends = num_edge_indices = num_subset_indices = 0;
+  subset_serial = 0;
+  vector<Vertex>().swap(vertices);
+  vector<GLuint>().swap(edge_indices);
+  vector<GLuint>().swap(subset_indices);
+}
+
+void MeshRenderer::setVertex(Vertex &v, const Vector3d &pos, const Vector3d &normal)
+{
+  v.x  = pos.x();    v.y  = pos.y();    v.z  = pos.z();
+  v.nx = normal.x(); v.ny = normal.y(); v.nz = normal.z();
+}
+
+// the corners, and the normals if length > 0
+void MeshRenderer::make(const Mesh &mesh, double length)
+{
+  const uint ntr = mesh.numTriangles();
+  num_corners = 3*ntr;
+  num_normal_ends = length > 0 ? 2*ntr : 0;
+  normals_length = length;
+  vertices.resize(num_corners + num_normal_ends);
+  for (uint i = 0; i < ntr; i++) {
+    const Triangle t = mesh.triangle(i);
+    setVertex(vertices[3*i],   t.A, t.Normal);
+    setVertex(vertices[3*i+1], t.B, t.Normal);
+    setVertex(vertices[3*i+2], t.C, t.Normal);
+    if (num_normal_ends > 0) {
+      const Vector3d center = (t.A+t.B+t.C)/3.0;
+      setVertex(vertices[num_corners + 2*i],   center, t.Normal);
+      setVertex(vertices[num_corners + 2*i+1], center + t.Normal*length, t.Normal);
+    }
+  }
+#ifdef HAVE_GL_BUFFERS
+  if (Platform::haveGLBuffers()) {
+    if (vertex_buffer == 0)
+      glGenBuffers(1, &vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex),
+		 vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    vector<Vertex>().swap(vertices);
+  }
+#endif
+  made = true;
+}
+
+// the edges AB, BC, CA of every triangle
+void MeshRenderer::makeEdges()
+{
+  num_edge_indices = 2*num_corners;
+  edge_indices.resize(num_edge_indices);
+  for (uint c = 0; c < num_corners; c += 3) {
+    GLuint *e = &edge_indices[2*c];
+    e[0] = c;   e[1] = c+1;
+    e[2] = c+1; e[3] = c+2;
+    e[4] = c+2; e[5] = c;
+  }
+  makeIndexBuffer(index_buffer, edge_indices);
+}
+
+// into buffer, and out of memory
+void MeshRenderer::makeIndexBuffer(GLuint &buffer, vector<GLuint> &indices)
+{
+#ifdef HAVE_GL_BUFFERS
+  if (Platform::haveGLBuffers()) {
+    if (buffer == 0)
+      glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+		 indices.empty() ? NULL : &indices[0], GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+    vector<GLuint>().swap(indices);
+  }
+#endif
+}
+
+void MeshRenderer::drawIndexed(GLenum mode, GLuint buffer,
+			       const vector<GLuint> &indices, uint count)
+{
+#ifdef HAVE_GL_BUFFERS
+  if (Platform::haveGLBuffers()) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer);
+    glDrawElements(mode, count, GL_UNSIGNED_INT, NULL);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+  } else
+#endif
+    glDrawElements(mode, count, GL_UNSIGNED_INT, &indices[0]);
+}
+
+void MeshRenderer::begin(bool normals)
+{
+  const char *base = NULL;
+#ifdef HAVE_GL_BUFFERS
+  if (Platform::haveGLBuffers())
+    glBindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+  else
+#endif
+    base = (const char *)&vertices[0];
+  glEnableClientState(GL_VERTEX_ARRAY);
+  glVertexPointer(3, GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, x));
+  if (normals) {
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glNormalPointer(GL_FLOAT, sizeof(Vertex), base + offsetof(Vertex, nx));
+  }
+}
+
+void MeshRenderer::end()
+{
+  glDisableClientState(GL_NORMAL_ARRAY);
+  glDisableClientState(GL_VERTEX_ARRAY);
+#ifdef HAVE_GL_BUFFERS
+  if (Platform::haveGLBuffers())
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
+
+void MeshRenderer::drawTriangles(const Mesh &mesh)
+{
+  if (!made) make(mesh, normals_length);
+  if (num_corners == 0) return;
+  begin(true);
+  glDrawArrays(GL_TRIANGLES, 0, num_corners);
+  end();
+}
+
+void MeshRenderer::drawWireframe(const Mesh &mesh)
+{
+  if (!made) make(mesh, normals_length);
+  if (num_corners == 0) return;
+  if (num_edge_indices == 0) makeEdges();
+  glLineWidth(1);
+  begin(true);
+  drawIndexed(GL_LINES, index_buffer, edge_indices, num_edge_indices);
+  end();
+}
+
+void MeshRenderer::drawNormals(const Mesh &mesh, double length)
+{
+  if (!made || num_normal_ends == 0 || length != normals_length)
+    make(mesh, length); // the edges stay the same
+  if (num_normal_ends == 0) return;
+  begin(false);
+  glDrawArrays(GL_LINES, num_corners, num_normal_ends);
+  end();
+}
+
+void MeshRenderer::drawEndpoints(const Mesh &mesh)
+{
+  if (!made) make(mesh, normals_length);
+  if (num_corners == 0) return;
+  begin(false);
+  glDrawArrays(GL_POINTS, 0, num_corners);
+  end();
+}
+
+void MeshRenderer::drawSubset(const Mesh &mesh,
+			      const vector<uint> &subset, unsigned long serial)
+{
+  if (!made) make(mesh, normals_length);
+  if (serial != subset_serial) {
+    num_subset_indices = 3*subset.size();
+    subset_indices.resize(num_subset_indices);
+    for (uint i = 0; i < subset.size(); i++)
+      for (uint j = 0; j < 3; j++)
+	subset_indices[3*i+j] = 3*subset[i]+j;
+    makeIndexBuffer(subset_buffer, subset_indices);
+    subset_serial = serial;
+  }
+  if (num_subset_indices == 0) return;
+  begin(false);
+  drawIndexed(GL_TRIANGLES, subset_buffer, subset_indices, num_subset_indices);
+  end();
+}
@@ -0,0 +1,82 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#pragma once
+
+#include <vector>
+
+#include "stdafx.h"
+#include "mesh.h"
+
+//
+// The triangles of a shape in one vertex array, corners with their
+// triangle's normal, drawn in the shape's untransformed coordinates so
+// the transform is only the model matrix.  Wireframe and endpoints use
+// the same corners, the wireframe through an index array of the edges;
+// the normals are line ends after the corners, and a subset of the
+// triangles (the overhangs) is another index array.  With GL 1.5 the arrays
+// are buffer objects, otherwise they are drawn from memory.
+//
+class MeshRenderer
+{
+public:
+  MeshRenderer();
+  // copies make their own arrays
+  MeshRenderer(const MeshRenderer &rhs);
+  MeshRenderer &operator=(const MeshRenderer &rhs);
+  ~MeshRenderer();
+
+  void clear(); // the triangles changed
+
+  // the GL context must be current for these
+  void drawTriangles(const Mesh &mesh);
+  void drawWireframe(const Mesh &mesh);
+  void drawNormals  (const Mesh &mesh, double length);
+  void drawEndpoints(const Mesh &mesh);
+  // only the triangles with the given indices, without normals; the
+  // index array is made again when serial changes
+  void drawSubset(const Mesh &mesh,
+		  const vector<uint> &subset, unsigned long serial);
+
+private:
+  struct Vertex {
+    GLfloat x, y, z;
+    GLfloat nx, ny, nz;
+  };
+
+  bool made;
+  uint num_corners;      // 3 per triangle
+  uint num_normal_ends;  // 2 per triangle after the corners, if made
+  double normals_length; // they were made with
+  uint num_edge_indices; // 6 per triangle, if made
+  uint num_subset_indices;
+  unsigned long subset_serial; // 0 if none
+
+  std::vector<Vertex> vertices; // until in the buffer
+  std::vector<GLuint> edge_indices, subset_indices;
+  GLuint vertex_buffer, index_buffer, subset_buffer; // 0 if none
+
+  static void setVertex(Vertex &v, const Vector3d &pos, const Vector3d &normal);
+  void make(const Mesh &mesh, double normals_length);
+  void makeEdges();
+  void makeIndexBuffer(GLuint &buffer, std::vector<GLuint> &indices);
+  void drawIndexed(GLenum mode, GLuint buffer, const std::vector<GLuint> &indices,
+		   uint count);
+  void begin(bool normals); // set the vertex array
+  void end();
+};
@@ -36,7 +36,6 @@
 #include "render.h"
 
 Model::Model() :
-  m_previewLayer(NULL),
   //m_previewGCodeLayer(NULL),
   currentprintingline(0),
   settings(),
@@ -45,18 +44,19 @@ Model::Model() :
   errlog (Gtk::TextBuffer::create()),
   echolog (Gtk::TextBuffer::create()),
   is_calculating(false),
-  is_printing(false)
+  is_printing(false),
+  preview_revision(1)
 {
   // Variable defaults
   Center.set(100.,100.,0.);
   preview_shapes.clear();
+  num_raft_layers = 0;
 }
 
 Model::~Model()
 {
   ClearLayers();
   ClearGCode();
-  delete m_previewLayer;
   preview_shapes.clear();
 }
 
@@ -105,14 +105,33 @@ void Model::ClearLayers()
     delete *i;
   }
   layers.clear();
+  num_raft_layers = 0;
+  for (uint i = 0; i < kept_layers.size(); i++)
+    delete kept_layers[i];
+  kept_layers.clear();
+  layers_stages = SliceStages();
   Infill::clearPatterns();
   ClearPreview();
 }
 
+// the layers are out of date, but the next ConvertToGCode() may reuse
+// what of them did not change
+void Model::KeepLayers()
+{
+  if (!layers.empty()) {
+    for (uint i = 0; i < kept_layers.size(); i++)
+      delete kept_layers[i];
+    kept_layers.clear();
+    kept_layers.swap(layers);
+  }
+  ClearPreview();
+}
+
+// m_previewLayer is shown until a new one is finished
 void Model::ClearPreview()
 {
-  if (m_previewLayer) delete m_previewLayer;
-  m_previewLayer = NULL;
+  preview_revision++;
+  preview_layers.setInput(std::shared_ptr<const PreviewInput>());
   m_previewGCode.clear();
   m_previewGCode_z = -100000;
 }
@@ -159,8 +178,18 @@ void Model::init() {}
 
 void Model::WriteGCode(Glib::RefPtr<Gio::File> file)
 {
-  Glib::ustring contents = gcode.get_text();
-  Glib::file_set_contents (file->get_path(), contents);
+#ifdef WIN32
+  // a mapped file cannot be replaced
+  gcode.unmapPrintJob(file->get_path());
+#endif
+  // written to a new file that replaces the old one, the print job may
+  // be a mapping of the old one
+  shared_ptr<const PrintJob> job = gcode.GetPrintJob();
+  try {
+    Glib::file_set_contents (file->get_path(), job->GetData(), job->GetLength());
+  } catch (const Glib::FileError &err) {
+    error (_("Failed to write GCode"), err.what().c_str());
+  }
   settings.GCodePath = file->get_parent()->get_path();
 }
 
@@ -327,8 +356,7 @@ void Model::translateGCode(Vector3d trans)
   is_calculating=true;
   gcode.translate(trans);
 
-  string GcodeTxt;
-  gcode.MakeText (GcodeTxt, settings, m_progress);
+  gcode.MakeText (settings, m_progress);
   Max = gcode.Max;
   Min = gcode.Min;
   Center = (Max + Min) / 2.0;
@@ -345,10 +373,11 @@ void Model::ModelChanged()
   if (!is_printing) {
     CalcBoundingBoxAndCenter();
     Infill::clearPatterns();
-    if ( layers.size()>0 || m_previewGCode.size()>0 || m_previewLayer ) {
+    if ( layers.size()>0 || m_previewGCode.size()>0 ) {
       ClearGCode();
-      ClearLayers();
-    }
+      KeepLayers();
+    } else
+      ClearPreview();
     setCurrentPrintingLine(0);
     m_model_changed.emit();
   }
@@ -893,10 +922,9 @@ int Model::draw (vector<Gtk::TreeModel::Path> &iter)
       // draw support triangles
       if (support) {
 	glColor4f(0.8f,0.f,0.f,0.5f);
-	vector<Triangle> suppTr =
-	  shape->trianglesSteeperThan(supportangle*M_PI/180.);
-	for (uint i=0; i < suppTr.size(); i++)
-	  suppTr[i].draw(GL_TRIANGLES);
+	shape->drawOverhangs(objtree.transform3D.transform *
+			     object->transform3D.transform,
+			     supportangle*M_PI/180.);
       }
       glPopMatrix();
       if(displaybbox)
@@ -975,7 +1003,7 @@ int Model::draw (vector<Gtk::TreeModel::Path> &iter)
 	  m_previewGCode.clear();
 	  vector<Command> commands;
 	  GCodeState state(m_previewGCode);
-	  previewGCodeLayer->MakeGCode(start, state, 0, settings);
+	  previewGCodeLayer->MakeGCode(start, state, 0, SliceParams(settings));
 	  // state.AppendCommands(commands, settings.Slicing.RelativeEcode);
 	  m_previewGCode_z = z;
 	}
@@ -1056,17 +1084,15 @@ int Model::drawLayers(double height, const Vector3d &offset, bool calconly)
 	}
       else
 	{
-	  if (!m_previewLayer || m_previewLayer->getZ() != z) {
-	    m_previewLayer = calcSingleLayer(z, LayerNr, lthickness,
-					     displayinfill, false);
-	    layer = m_previewLayer;
-	    Layer * previous = NULL;
-	    if (LayerNr>0 && z >= lthickness)
-	      previous = calcSingleLayer(z-lthickness, LayerNr-1, lthickness,
-					 false, false);
-	    layer->setPrevious(previous);
-	  }
-	  layer = m_previewLayer;
+	  if (preview_layers.getRevision() != preview_revision)
+	    preview_layers.setInput(makePreviewInput(true));
+	  // made in the background, show the last one until it's ready
+	  std::shared_ptr<Layer> ready =
+	    preview_layers.request(z, LayerNr, lthickness, displayinfill);
+	  if (ready)
+	    m_previewLayer = ready;
+	  layer = m_previewLayer.get();
+	  if (!layer) break;
 	}
       if (!calconly) {
 	layer->Draw(settings);
@@ -1093,28 +1119,8 @@ Layer * Model::calcSingleLayer(double z, uint LayerNr, double thickness,
 			       bool calcinfill, bool for_gcode) const
 {
   if (is_calculating) return NULL; // infill calculation (saved patterns) would be disturbed
-  if (!for_gcode) {
-    if (m_previewLayer && m_previewLayer->getZ() == z
-	&& m_previewLayer->thickness == thickness) return m_previewLayer;
-  }
-  vector<Shape*> shapes;
-  vector<Matrix4d> transforms;
-
-  if (settings.get_boolean("Slicing","SelectedOnly"))
-    objtree.get_selected_shapes(m_current_selectionpath, shapes, transforms);
-  else
-    objtree.get_all_shapes(shapes, transforms);
-
-  double max_grad = 0;
-  double supportangle = settings.get_double("Slicing","SupportAngle")*M_PI/180.;
-  if (!settings.get_boolean("Slicing","Support")) supportangle = -1;
-
-  Layer * layer = new Layer(NULL, LayerNr, thickness,
-			    settings.get_integer("Slicing","Skins"));
-  layer->setZ(z);
-  for(size_t f = 0; f < shapes.size(); f++) {
-    layer->addShape(transforms[f], *shapes[f], z, max_grad, supportangle);
-  }
+  Layer * layer = makePreviewInput(false)->makeLayer(z, LayerNr, thickness,
+						      calcinfill);
 
   // vector<Poly> polys = layer->GetPolygons();
   // for (guint i=0; i<polys.size();i++){
@@ -1125,18 +1131,6 @@ Layer * Model::calcSingleLayer(double z, uint LayerNr, double thickness,
   //   }
   // }
 
-  layer->MakeShells(settings);
-
-  if (settings.get_boolean("Slicing","Skirt")) {
-    if (layer->getZ() - layer->thickness <= settings.get_double("Slicing","SkirtHeight"))
-      layer->MakeSkirt(settings.get_double("Slicing","SkirtDistance"),
-		       settings.get_boolean("Slicing","SingleSkirt") &&
-		       !settings.get_boolean("Slicing","Support"));
-  }
-
-  if (calcinfill)
-    layer->CalcInfill(settings);
-
 #define DEBUGPOLYS 0
 #if DEBUGPOLYS
   // write out polygons for gnuplot
@@ -1158,6 +1152,23 @@ Layer * Model::calcSingleLayer(double z, uint LayerNr, double thickness,
 }
 
 
+// the shapes to slice and the settings for a preview layer
+std::shared_ptr<const PreviewInput> Model::makePreviewInput(bool copy) const
+{
+  vector<Shape*> shapes;
+  vector<Matrix4d> transforms;
+
+  if (settings.get_boolean("Slicing","SelectedOnly"))
+    objtree.get_selected_shapes(m_current_selectionpath, shapes, transforms);
+  else
+    objtree.get_all_shapes(shapes, transforms);
+
+  PreviewInput *input = new PreviewInput(settings);
+  input->addShapes(shapes, transforms, copy);
+  input->revision = preview_revision;
+  return std::shared_ptr<const PreviewInput>(input);
+}
+
 double Model::get_preview_Z()
 {
   if (m_previewLayer) return m_previewLayer->getZ();
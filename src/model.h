@@ -32,6 +32,9 @@
 #include "gcode/gcode.h"
 /* #include "gcodestate.h" */
 #include "settings.h"
+#include "profile.h"
+#include "previewlayers.h"
+#include "slicestages.h"
 /* #include "progress.h" */
 /* #include "slicer/poly.h" */
 
@@ -94,9 +97,12 @@ public:
 	void Mirror(Shape *shape, TreeObject *object);
 
 	vector<Layer*> layers;
+	uint num_raft_layers; // at the start of layers
 
-	Layer * m_previewLayer;
+	std::shared_ptr<Layer> m_previewLayer; // the last finished one
 	double get_preview_Z();
+	// a preview layer was finished, draw again
+	Glib::Dispatcher &signal_preview_ready() { return preview_layers.signal_ready; }
 	//Layer * m_previewGCodeLayer;
 	GCode m_previewGCode;
 	double m_previewGCode_z;
@@ -114,6 +120,7 @@ public:
 	void ConvertToGCode();
 
 	void MakeRaft(GCodeState &state, double &z);
+	void MakeRaftLayers(vector<Layer*> &raft_layers, double &z);
 	void WriteGCode(Glib::RefPtr<Gio::File> file);
 	void ClearGCode();
 	void ClearLayers();
@@ -165,6 +172,7 @@ public:
 	void ClearLogs();
 
 	GCode gcode;
+	SliceProfile profile; // of the last ConvertToGCode()
 
 	void SetIsPrinting(bool printing) { is_printing = printing; };
 
@@ -178,20 +186,48 @@ public:
 	//GCodeIter *m_iter;
 	Layer * lastlayer;
 
+	// made in other threads from a copy of the shapes and settings,
+	// taken again when preview_revision was increased
+	PreviewLayers preview_layers;
+	unsigned long preview_revision;
+	std::shared_ptr<const PreviewInput> makePreviewInput(bool copy) const;
+
+	// the inputs of the layers made by the last ConvertToGCode(), and
+	// those layers after the model changed, for the next run to reuse
+	SliceStages layers_stages;
+	vector<Layer*> kept_layers;
+	void KeepLayers();
+	SliceStages::Stage ReuseLayers(const SliceStages &stages);
+
         // Slicing/GCode conversion functions
-	void Slice();
+	void GetSliceShapes(vector<Shape*> &shapes,
+			    vector<Matrix4d> &transforms) const;
+	int Slice(bool all_layers = true);
+	bool SliceLayers(int from, int to, ViewProgress *progress = NULL);
+	void EndSlicing();
+	// what SliceLayers() slices
+	struct {
+	  vector<Shape*> shapes;
+	  vector<Matrix4d> transforms;
+	  double minZ, thickness, supportangle;
+	  uint skins;
+	} slicing;
+	bool MakeLayersPipelined(const SliceParams &params, int sliced,
+				 double &printOffsetZ, Vector3d start,
+				 vector<PLine3> &plines);
 
 	void CleanupLayers();
-	void CalcInfill();
-	void MakeShells();
+	void CalcInfill(const SliceParams &params);
+	void MakeShells(const SliceParams &params);
 	void MakeUncoveredPolygons(bool make_decor, bool make_bridges=true);
+	void MakeUncoveredFromAbove(int i, bool make_decor);
+	void MakeUncoveredFromBelow(int i, bool make_decor, bool make_bridges);
 	vector<Poly> GetUncoveredPolygons(const Layer *subjlayer,
 					  const Layer *cliplayer);
 	void MakeFullSkins();
+	int UncoveredShells(int &numdecor) const;
 	void MultiplyUncoveredPolygons();
-	void MakeSupportPolygons(Layer * subjlayer, const Layer * cliplayer,
-				 double widen=0);
-	void MakeSupportPolygons(double widen=0);
+	void MakeSupportPolygons(double widen=0, bool show_progress=true);
 	void MakeSkirt();
 
 };
@@ -45,6 +45,15 @@
 
 
 void Model::MakeRaft(GCodeState &state, double &z)
+{
+  vector<Layer*> raft_layers;
+  MakeRaftLayers(raft_layers, z);
+  layers.insert(layers.begin(),raft_layers.begin(),raft_layers.end());
+  num_raft_layers = raft_layers.size();
+}
+
+// the raft layers below layers[0], which only needs its shells
+void Model::MakeRaftLayers(vector<Layer*> &raft_layers, double &z)
 {
   if (layers.size() == 0) return;
   vector<Poly> raftpolys =
@@ -55,7 +64,6 @@ void Model::MakeRaft(GCodeState &state, double &z)
   for (uint i = 0; i< raftpolys.size(); i++)
     raftpolys[i].cleanup(layerthickness/4);
 
-  vector<Layer*> raft_layers;
 
   double rotation = settings.get_double("Raft","Base.Rotation");
   double basethickness =
@@ -100,7 +108,6 @@ void Model::MakeRaft(GCodeState &state, double &z)
     rotation += settings.get_double("Raft","Interface.RotationPrLayer")*M_PI/180;
     raft_z += interthickness;
   }
-  layers.insert(layers.begin(),raft_layers.begin(),raft_layers.end());
   z += totalthickness;
 }
 
@@ -277,26 +284,33 @@ bool layersort(const Layer * l1, const Layer * l2){
   return (l1->Z < l2->Z);
 }
 
-void Model::Slice()
+// the shapes to slice and their transforms onto the print bed
+void Model::GetSliceShapes(vector<Shape*> &shapes,
+			   vector<Matrix4d> &transforms) const
 {
-  vector<Shape*> shapes;
-  vector<Matrix4d> transforms;
-
   if (settings.get_boolean("Slicing","SelectedOnly"))
     objtree.get_selected_shapes(m_current_selectionpath, shapes, transforms);
   else
     objtree.get_all_shapes(shapes,transforms);
 
-  if (shapes.size() == 0) return;
-
   assert(shapes.size() == transforms.size());
 
-  CalcBoundingBoxAndCenter(settings.get_boolean("Slicing","SelectedOnly"));
-
   for (uint i = 0; i<transforms.size(); i++)
     transforms[i] = settings.getBasicTransformation(transforms[i]);
+}
 
-  assert(shapes.size() == transforms.size());
+// Slices all layers, or with all_layers false in the simple case only
+// prepares the layers for SliceLayers().  Returns the number of sliced
+// layers.
+int Model::Slice(bool all_layers)
+{
+  vector<Shape*> shapes;
+  vector<Matrix4d> transforms;
+  GetSliceShapes(shapes, transforms);
+
+  if (shapes.size() == 0) return (int)layers.size();
+
+  CalcBoundingBoxAndCenter(settings.get_boolean("Slicing","SelectedOnly"));
 
   int LayerNr = 0;
   bool varSlicing = settings.get_boolean("Slicing","Varslicing");
@@ -315,6 +329,9 @@ void Model::Slice()
   double max_gradient = 0;
   double supportangle = settings.get_double("Slicing","SupportAngle")*M_PI/180.;
   if (!settings.get_boolean("Slicing","Support")) supportangle = -1;
+  else // classify the overhangs once, not in each layer's thread
+    for (uint i = 0; i < shapes.size(); i++)
+      shapes[i]->getOverhangs(transforms[i], supportangle);
 
   m_progress->set_terminal_output(settings.get_boolean("Display","TerminalProgress"));
   m_progress->start (_("Slicing"), maxZ);
@@ -332,7 +349,7 @@ void Model::Slice()
     for (uint nshape= 0; nshape < shapes.size(); nshape++) {
       layers[0]->addShape(transforms[nshape], *shapes[nshape],  0, max_gradient, -1);
     }
-    return;
+    return 1;
   }
 
   int progress_steps=max(1,(int)(maxZ/thickness/100.));
@@ -340,7 +357,10 @@ void Model::Slice()
   if ((varSlicing && skins > 1) ||
       (settings.get_boolean("Slicing","BuildSerial") && shapes.size() > 1))
   {
-    // have skins and/or serial build, so can't parallelise
+    // have skins and/or serial build, so can't parallelise,
+    // but z rises for each shape and can be swept
+    for (uint i = 0; i < shapes.size(); i++)
+      shapes[i]->beginSweep(transforms[i]);
     uint currentshape   = 0;
     double serialheight = maxZ; // settings.Slicing.SerialBuildHeight;
     double z            = minZ;
@@ -405,30 +425,61 @@ void Model::Slice()
         //cerr << "    Z="<<z << "Max.z="<<Max.z<<endl;
       }
     delete layer; // have made one more than needed
-    return;
+    for (uint i = 0; i < shapes.size(); i++)
+      shapes[i]->endSweep();
+    return (int)layers.size();
   }
 
   // simple case, can do multihreading
 
   int num_layers = (int)ceil((maxZ - minZ) / thickness);
   layers.resize(num_layers);
+  slicing.shapes       = shapes;
+  slicing.transforms   = transforms;
+  slicing.minZ         = minZ;
+  slicing.thickness    = thickness;
+  slicing.supportangle = supportangle;
+  slicing.skins        = skins;
+#ifndef _OPENMP
+  // layers come in order, sweep through the shapes
+  for (uint i = 0; i < shapes.size(); i++)
+    shapes[i]->beginSweep(transforms[i]);
+#endif
+  if (!all_layers) return 0;
+
+  profile.set_layers(num_layers);
+  if (!SliceLayers(0, num_layers, m_progress))
+    ClearLayers();
+  EndSlicing();
+
+  // shapes.clear();
+  //m_progress->stop (_("Done"));
+  return (int)layers.size();
+}
+
+// slice the layers from..to-1 that Slice(false) left out, in parallel
+bool Model::SliceLayers(int from, int to, ViewProgress *progress)
+{
+  const double thickness = slicing.thickness;
+  double max_gradient = 0;
+  int progress_steps=max(1,(int)(layers.size()/100));
   int nlayer;
   bool cont = true;
 
 #ifdef _OPENMP
   #pragma omp parallel for schedule(dynamic)
 #endif
-  for (nlayer = 0; nlayer < num_layers; nlayer++) {
-    double z = minZ + thickness * nlayer;
-    if (nlayer%progress_steps==0) {
+  for (nlayer = from; nlayer < to; nlayer++) {
+    double z = slicing.minZ + thickness * nlayer;
+    if (progress && nlayer%progress_steps==0) {
 #ifdef _OPENMP
 	#pragma omp critical(updateProgress)
 	{
-	    cont = (m_progress->update(z));
+	    cont = (progress->update(z));
 	    #pragma omp flush (cont)
 	}
 #else
-        cont = (m_progress->update(z));
+        cont = (progress->update(z));
 #endif
     }
 #ifdef _OPENMP
@@ -437,30 +488,39 @@ void Model::Slice()
 #else
     if (!cont) break;
 #endif
-    Layer * layer = new Layer(NULL, nlayer, thickness, nlayer>0?skins:1);
+    LayerTimer timer(profile, nlayer);
+    Layer * layer = new Layer(NULL, nlayer, thickness, nlayer>0?slicing.skins:1);
     layer->setZ(z); // set to real z
-    for (uint nshape= 0; nshape < shapes.size(); nshape++) {
-      layer->addShape(transforms[nshape], *shapes[nshape],
-		      z, max_gradient, supportangle);
+    for (uint nshape= 0; nshape < slicing.shapes.size(); nshape++) {
+      layer->addShape(slicing.transforms[nshape], *slicing.shapes[nshape],
+		      z, max_gradient, slicing.supportangle);
     }
     layers[nlayer] = layer;
   }
-  if (!cont)
-    ClearLayers();
+  if (!cont) return false;
 
 #ifdef _OPENMP
     //std::sort(layers.begin(), layers.end(), layersort);
 #endif
 
-  for (uint nlayer = 1; nlayer < layers.size(); nlayer++) {
+  for (int nlayer = max(from, 1); nlayer < to; nlayer++) {
     layers[nlayer]->setPrevious(layers[nlayer-1]);
     assert(layers[nlayer]->Z > layers[nlayer-1]->Z);
   }
-  if (layers.size()>0)
-	lastlayer = layers.back();
+  if (to > 0)
+	lastlayer = layers[to-1];
+  return true;
+}
 
-  // shapes.clear();
-  //m_progress->stop (_("Done"));
+// done with the shapes given to SliceLayers()
+void Model::EndSlicing()
+{
+#ifndef _OPENMP
+  for (uint i = 0; i < slicing.shapes.size(); i++)
+    slicing.shapes[i]->endSweep();
+#endif
+  slicing.shapes.clear();
+  slicing.transforms.clear();
 }
 
 void Model::MakeFullSkins()
@@ -496,39 +556,70 @@ void Model::MakeUncoveredPolygons(bool make_decor, bool make_bridges)
 {
   int count = (int)layers.size();
   if (count == 0 ) return;
-  if (!m_progress->restart (_("Find Uncovered"), 2*count+2)) return;
-  int progress_steps=max(1,(int)((2*count+2)/100));
-  // bottom to top: uncovered from above -> top polys
-  for (int i = 0; i < count-1; i++)
-    {
-      if (i%progress_steps==0) if(!m_progress->update(i)) return ;
-      layers[i]->addFullPolygons(GetUncoveredPolygons(layers[i],layers[i+1]), make_decor);
-    }
-  // top to bottom: uncovered from below -> bridge polys
-  for (uint i = count-1; i > 0; i--)
+  if (!m_progress->restart (_("Find Uncovered"), count+2)) return;
+  profile.set_layers(count);
+  int progress_steps=max(1,(int)((count+2)/100));
+  bool cont = true;
+  // a layer only changes itself and reads the shells of its neighbours
+#ifdef _OPENMP
+  omp_lock_t progress_lock;
+  omp_init_lock(&progress_lock);
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < count; i++)
     {
-      //cerr << "layer " << i << endl;
-      if (i%progress_steps==0) if(!m_progress->update(count + count - i)) return;
-      //make_bridges = false;
-      // no bridge on marked layers (serial build)
-      bool mbridge = make_bridges && (layers[i]->LayerNo != 0);
-      if (mbridge) {
-	vector<Poly> uncovered = GetUncoveredPolygons(layers[i],layers[i-1]);
-	layers[i]->addBridgePolygons(Clipping::getExPolys(uncovered));
-	layers[i]->calcBridgeAngles(layers[i-1]);
-      }
-      else {
-	const vector<Poly> &uncovered = GetUncoveredPolygons(layers[i],layers[i-1]);
-	layers[i]->addFullPolygons(uncovered,make_decor);
+      if (i%progress_steps==0) {
+#ifdef _OPENMP
+	omp_set_lock(&progress_lock);
+#endif
+	cont = (m_progress->update(i));
+#ifdef _OPENMP
+	omp_unset_lock(&progress_lock);
+#endif
       }
+      if (!cont) continue;
+      LayerTimer timer(profile, i);
+      // uncovered from above -> top polys
+      if (i < count-1)
+	MakeUncoveredFromAbove(i, make_decor);
+      // uncovered from below -> bridge polys
+      if (i > 0)
+	MakeUncoveredFromBelow(i, make_decor, make_bridges);
     }
-  m_progress->update(2*count+1);
+#ifdef _OPENMP
+  omp_destroy_lock(&progress_lock);
+#endif
+  if (!cont) return;
+  m_progress->update(count+1);
   layers.front()->addFullPolygons(layers.front()->GetFillPolygons(), make_decor);
-  m_progress->update(2*count+2);
+  m_progress->update(count+2);
   layers.back()->addFullPolygons(layers.back()->GetFillPolygons(), make_decor);
   //m_progress->stop (_("Done"));
 }
 
+// needs the shells of layers i and i+1
+void Model::MakeUncoveredFromAbove(int i, bool make_decor)
+{
+  layers[i]->addFullPolygons(GetUncoveredPolygons(layers[i],layers[i+1]), make_decor);
+}
+
+// needs the shells of layers i and i-1
+void Model::MakeUncoveredFromBelow(int i, bool make_decor, bool make_bridges)
+{
+  //make_bridges = false;
+  // no bridge on marked layers (serial build)
+  bool mbridge = make_bridges && (layers[i]->LayerNo != 0);
+  if (mbridge) {
+    vector<Poly> uncovered = GetUncoveredPolygons(layers[i],layers[i-1]);
+    layers[i]->addBridgePolygons(Clipping::getExPolys(uncovered));
+    layers[i]->calcBridgeAngles(layers[i-1]);
+  }
+  else {
+    const vector<Poly> &uncovered = GetUncoveredPolygons(layers[i],layers[i-1]);
+    layers[i]->addFullPolygons(uncovered,make_decor);
+  }
+}
+
 // find polys in subjlayer that are not covered by shell of cliplayer
 vector<Poly> Model::GetUncoveredPolygons(const Layer * subjlayer,
 					 const Layer * cliplayer)
@@ -545,63 +636,129 @@ vector<Poly> Model::GetUncoveredPolygons(const Layer * subjlayer,
   return uncovered;
 }
 
-void Model::MultiplyUncoveredPolygons()
+// the full polygons of a layer as other layers see them while
+// multiplying
+struct FullPolygons {
+  vector<Poly>   full, skinfull, decor;
+  vector<ExPoly> bridge;
+};
+
+static void saveFullPolygons(const Layer *layer, FullPolygons &saved)
+{
+  saved.full     = layer->GetFullFillPolygons();
+  saved.bridge   = layer->GetBridgePolygons();
+  saved.skinfull = layer->GetSkinFullPolygons();
+  saved.decor    = layer->GetDecorPolygons();
+}
+
+// (brigdepolys are not multiplied downwards)
+static void addFullFromAbove(Layer *layer, const FullPolygons &above, bool decor)
+{
+  layer->addFullPolygons (above.full,     false);
+  layer->addFullPolygons (above.skinfull, false);
+  layer->addFullPolygons (above.decor,    decor);
+}
+
+static void addFullFromBelow(Layer *layer, const FullPolygons &below, bool decor)
+{
+  layer->addFullPolygons (below.full,     false);
+  layer->addFullPolygons (below.bridge,   false);
+  layer->addFullPolygons (below.skinfull, false);
+  layer->addFullPolygons (below.decor,    decor);
+}
+
+// number of layers full polygons are multiplied into, counting the
+// layer itself, 0 if not at all
+int Model::UncoveredShells(int &numdecor) const
 {
+  numdecor = 0;
   if (!settings.get_boolean("Slicing","DoInfill") &&
-      settings.get_double("Slicing","SolidThickness") == 0.0) return;
-  if (settings.get_boolean("Slicing","NoTopAndBottom")) return;
+      settings.get_double("Slicing","SolidThickness") == 0.0) return 0;
+  if (settings.get_boolean("Slicing","NoTopAndBottom")) return 0;
   int shells = (int)ceil(settings.get_double("Slicing","SolidThickness")/settings.get_double("Slicing","LayerThickness"));
   shells = max(shells, (int)settings.get_integer("Slicing","ShellCount"));
-  if (shells<1) return;
-  int count = (int)layers.size();
+  if (shells<1) return 0;
 
-  int numdecor = 0;
   // add another full layer if making decor
   if (settings.get_boolean("Slicing","MakeDecor"))
     numdecor = settings.get_integer("Slicing","DecorLayers");
-  shells += numdecor;
+  return shells + numdecor;
+}
+
+// Every layer gets the full polygons of the layers above as they were
+// before, then those of the layers below as they were after that.  The
+// layers read saved copies, so they can all be done at once.
+void Model::MultiplyUncoveredPolygons()
+{
+  int numdecor;
+  const int shells = UncoveredShells(numdecor);
+  if (shells<1) return;
+  int count = (int)layers.size();
 
   if (!m_progress->restart (_("Uncovered Shells"), count*3)) return;
   int progress_steps=max(1,(int)(count*3/100));
-  // bottom-up: mulitply downwards
-  int i,s;
+  bool cont = true;
+  vector<FullPolygons> saved(count);
+  int i;
+#ifdef _OPENMP
+  omp_lock_t progress_lock;
+  omp_init_lock(&progress_lock);
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (i=0; i < count; i++)
+    saveFullPolygons(layers[i], saved[i]);
+
+  // mulitply downwards
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
   for (i=0; i < count; i++)
     {
-      if (i%progress_steps==0) if(!m_progress->update(i)) return;
-      // (brigdepolys are not multiplied downwards)
-      const vector<Poly> &fullpolys     = layers[i]->GetFullFillPolygons();
-      const vector<Poly> &skinfullpolys = layers[i]->GetSkinFullPolygons();
-      const vector<Poly> &decorpolys    = layers[i]->GetDecorPolygons();
-      for (s=1; s < shells; s++)
-	if (i-s > 1) {
-	  layers[i-s]->addFullPolygons (fullpolys,     false);
-	  layers[i-s]->addFullPolygons (skinfullpolys, false);
-	  layers[i-s]->addFullPolygons (decorpolys,    s < numdecor);
-	}
+      if (i%progress_steps==0) {
+#ifdef _OPENMP
+	omp_set_lock(&progress_lock);
+#endif
+	cont = (m_progress->update(i));
+#ifdef _OPENMP
+	omp_unset_lock(&progress_lock);
+#endif
+      }
+      if (!cont) continue;
+      if (i > 1)
+	for (int s=1; s < shells && i+s < count; s++)
+	  addFullFromAbove(layers[i], saved[i+s], s < numdecor);
     }
-  // top-down: mulitply upwards
-  for (int i=count-1; i>=0; i--)
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (i=0; i < count; i++)
+    if (cont) saveFullPolygons(layers[i], saved[i]);
+
+  // mulitply upwards
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (i=0; i < count; i++)
     {
-      if (i%progress_steps==0) if (!m_progress->update(count + count -i)) return;
-      const vector<Poly>   &fullpolys     = layers[i]->GetFullFillPolygons();
-      const vector<ExPoly> &bridgepolys   = layers[i]->GetBridgePolygons();
-      const vector<Poly>   &skinfullpolys = layers[i]->GetSkinFullPolygons();
-      const vector<Poly>   &decorpolys    = layers[i]->GetDecorPolygons();
-      for (int s=1; s < shells; s++)
-	if (i+s < count){
-	  layers[i+s]->addFullPolygons (fullpolys,     false);
-	  layers[i+s]->addFullPolygons (bridgepolys,   false);
-	  layers[i+s]->addFullPolygons (skinfullpolys, false);
-	  layers[i+s]->addFullPolygons (decorpolys,    s < numdecor);
-	}
+      if (i%progress_steps==0) {
+#ifdef _OPENMP
+	omp_set_lock(&progress_lock);
+#endif
+	cont = (m_progress->update(count + i));
+#ifdef _OPENMP
+	omp_unset_lock(&progress_lock);
+#endif
+      }
+      if (!cont) continue;
+      for (int s=1; s < shells && i-s >= 0; s++)
+	addFullFromBelow(layers[i], saved[i-s], s < numdecor);
     }
+  vector<FullPolygons>().swap(saved);
 
   m_progress->set_label(_("Merging Full Polygons"));
   // merge results
-  bool cont = true;
 #ifdef _OPENMP
-  omp_lock_t progress_lock;
-  omp_init_lock(&progress_lock);
 #pragma omp parallel for schedule(dynamic)
 #endif
   for (i=0; i < count; i++)
@@ -624,60 +781,68 @@ void Model::MultiplyUncoveredPolygons()
 }
 
 
-void Model::MakeSupportPolygons(Layer * layer, // lower -> will change
-				const Layer * layerabove,  // upper
-				double widen)
-{
-  const double distance =
-    settings.GetExtrudedMaterialWidth(layer->thickness);
-  // vector<Poly> tosupport = Clipping::getOffset(layerabove->GetToSupportPolygons(),
-  //  					       distance/2.);
-  //vector<Poly> tosupport = Clipping::getMerged(layerabove->GetToSupportPolygons(),
-  // 					       distance);
-  vector<Poly> tosupport = layerabove->GetToSupportPolygons();
-
-  Clipping clipp;
-  clipp.addPolys(layerabove->GetSupportPolygons(),  subject);
-  clipp.addPolys(tosupport,                         subject);
-  clipp.addPolys(layer->GetPolygons(),              clip);
-  clipp.setZ(layer->getZ());
-
-  vector<Poly> spolys = clipp.subtract(CL::pftNonZero,CL::pftEvenOdd);
-
-  if (widen != 0) // widen from layer to layer
-    spolys = clipp.getOffset(spolys, widen * layer->thickness);
-
-  spolys = clipp.getMerged(spolys,distance);
-
-  layer->setSupportPolygons(spolys);
-}
-
-void Model::MakeSupportPolygons(double widen)
+// The support of a layer is what the layers above need supported, cut
+// off where the layer itself is, and widened from layer to layer.  Only
+// carrying it down is serial; merging each layer's support, the most of
+// the work, is done in parallel afterwards.
+void Model::MakeSupportPolygons(double widen, bool show_progress)
 {
   int count = layers.size();
-  if (!m_progress->restart (_("Support"), count*2)) return;
+  if (show_progress && !m_progress->restart (_("Support"), count*2)) return;
+  if (count < 2) return;
   int progress_steps=max(1,(int)(count*2/100));
+  bool cont = true;
 
+  vector< vector<Poly> > carried(count);
+  vector<bool> made(count, false);
+  carried[count-1] = layers[count-1]->GetSupportPolygons();
   for (int i=count-1; i>0; i--)
     {
-      if (i%progress_steps==0) if(! m_progress->update(count-i)) return;
-      if (layers[i]->LayerNo == 0) continue;
-      MakeSupportPolygons(layers[i-1], layers[i], widen);
+      if (show_progress && i%progress_steps==0)
+	if (!m_progress->update(count-i)) return;
+      if (layers[i]->LayerNo == 0) { // keeps the support it has
+	carried[i-1] = layers[i-1]->GetSupportPolygons();
+	continue;
+      }
+      Clipping clipp;
+      clipp.addPolys(carried[i],                        subject);
+      clipp.addPolys(layers[i]->GetToSupportPolygons(), subject);
+      clipp.addPolys(layers[i-1]->GetPolygons(),        clip);
+      clipp.setZ(layers[i-1]->getZ());
+      carried[i-1] = clipp.subtract(CL::pftNonZero,CL::pftEvenOdd);
+      if (widen != 0) // widen from layer to layer
+	carried[i-1] = clipp.getOffset(carried[i-1], widen * layers[i-1]->thickness);
+      made[i-1] = true;
     }
 
-  // // shrink a bit
-  // Clipping clipp;
-  // for (int i=0; i<count; i++)
-  //   {
-  //     const double distance =
-  // 	settings.Hardware.GetExtrudedMaterialWidth(layers[i]->thickness);
-  //     if (i%progress_steps==0) if(!m_progress->update(i+count)) return;
-  //     vector<Poly> offset =
-  // 	Clipping::getOffset(layers[i]->GetSupportPolygons(), -distance);
-  //     layers[i]->setSupportPolygons(offset);
-  //   }
-
-  //  m_progress->stop (_("Done"));
+  // the settings are not read in parallel
+  vector<double> distance(count);
+  for (int i=0; i < count; i++)
+    distance[i] = settings.GetExtrudedMaterialWidth(layers[i]->thickness);
+
+#ifdef _OPENMP
+  omp_lock_t progress_lock;
+  omp_init_lock(&progress_lock);
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i=0; i < count-1; i++)
+    {
+      if (show_progress && i%progress_steps==0) {
+#ifdef _OPENMP
+	omp_set_lock(&progress_lock);
+#endif
+	cont = (m_progress->update(count + i));
+#ifdef _OPENMP
+	omp_unset_lock(&progress_lock);
+#endif
+      }
+      if (!cont || !made[i]) continue;
+      layers[i]->setSupportPolygons(Clipping::getMerged(carried[i], distance[i]));
+      vector<Poly>().swap(carried[i]);
+    }
+#ifdef _OPENMP
+  omp_destroy_lock(&progress_lock);
+#endif
 }
 
 void Model::MakeSkirt()
@@ -711,11 +876,12 @@ void Model::MakeSkirt()
   }
 }
 
-void Model::MakeShells()
+void Model::MakeShells(const SliceParams &params)
 {
   int count = (int)layers.size();
   if (count == 0) return;
   if (!m_progress->restart (_("Shells"), count)) return;
+  profile.set_layers(count);
   int progress_steps=max(1,(int)(count/100));
   bool cont = true;
 #ifdef _OPENMP
@@ -735,7 +901,8 @@ void Model::MakeShells()
 #endif
       }
       if (!cont) continue;
-      layers[i]->MakeShells(settings);
+      LayerTimer timer(profile, i);
+      layers[i]->MakeShells(params);
     }
 #ifdef _OPENMP
   omp_destroy_lock(&progress_lock);
@@ -745,13 +912,14 @@ void Model::MakeShells()
 }
 
 
-void Model::CalcInfill()
+void Model::CalcInfill(const SliceParams &params)
 {
-  if (!settings.get_boolean("Slicing","DoInfill") &&
+  if (!params.Slicing.DoInfill &&
       settings.get_double("Slicing","SolidThickness") == 0.0) return;
 
   int count = (int)layers.size();
   m_progress->start (_("Infill"), count);
+  profile.set_layers(count);
   int progress_steps=max(1,(count/100));
   bool cont = true;
   //cerr << "make infill"<< endl;
@@ -773,7 +941,8 @@ void Model::CalcInfill()
 #endif
       }
       if (!cont) continue;
-      layers[i]->CalcInfill(settings);
+      LayerTimer timer(profile, i);
+      layers[i]->CalcInfill(params);
     }
 #ifdef _OPENMP
   omp_destroy_lock(&progress_lock);
@@ -782,6 +951,267 @@ void Model::CalcInfill()
 }
 
 
+// Makes the layers and their print lines like the separate steps in
+// ConvertToGCode(), but bottom-up in blocks of layers: every step runs
+// on the layers whose neighbours are far enough, which are at most the
+// multiplied shells above and below.  So the lowest layers get their
+// print lines while the upper ones are still sliced.  Support is spread
+// down from the top and waits for all layers.
+bool Model::MakeLayersPipelined(const SliceParams &params, int sliced,
+				double &printOffsetZ, Vector3d start,
+				vector<PLine3> &plines)
+{
+  const int count = (int)layers.size();
+  if (count == 0) return true;
+
+  const bool make_uncovered = settings.get_boolean("Slicing","DoInfill") &&
+    !settings.get_boolean("Slicing","NoTopAndBottom") &&
+    (settings.get_double("Slicing","SolidThickness") > 0 ||
+     settings.get_integer("Slicing","ShellCount") > 0);
+  const bool make_decor   = settings.get_boolean("Slicing","MakeDecor");
+  // not bridging when support
+  const bool make_bridges = !settings.get_boolean("Slicing","NoBridges") &&
+    !settings.get_boolean("Slicing","Support");
+  const bool make_support = settings.get_boolean("Slicing","Support");
+  const double widen      = settings.get_double("Slicing","SupportWiden");
+  int numdecor;
+  const int shells        = UncoveredShells(numdecor);
+  const int reach         = max(0, shells-1); // layers up and down
+  const bool make_skirt   = settings.get_boolean("Slicing","Skirt");
+  const double skirtheight = settings.get_double("Slicing","SkirtHeight");
+  const bool make_infill  = params.Slicing.DoInfill ||
+    settings.get_double("Slicing","SolidThickness") != 0.0;
+  const bool make_raft    = settings.get_boolean("Raft","Enable");
+  const bool farthestStart = params.Slicing.FarthestLayerStart;
+
+#ifdef _OPENMP
+  const int block = 4 * omp_get_max_threads();
+#else
+  const int block = 4;
+#endif
+
+  // number of layers from the bottom each step is done with
+  int shelled = 0, covered = 0, supported = 0, skinned = 0,
+    multiplied = 0, merged = 0, filled = 0;
+  bool skirted = !make_skirt;
+  // copies of the full polygons within reach of the layers multiplied
+  vector<FullPolygons> unchanged(count), multiplied_down(count);
+  int unsaved = 0, unsaved_down = 0;
+
+  vector<Layer*> raft_layers;
+  bool rafted = !make_raft;
+  int planned = 0; // raft layers first
+  Vector2d entry(start.x(), start.y()); // of the next layer, estimated
+
+  m_progress->start (_("Making Layers"), count);
+  // the time of all steps of a layer
+  profile.set_layers(count);
+  bool cont = true;
+  while (cont && planned < (int)raft_layers.size() + count) {
+    if (sliced < count) {
+      const int to = min(count, sliced + block);
+      SliceLayers(sliced, to);
+      sliced = to;
+    }
+
+    const int newshelled = sliced;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = shelled; i < newshelled; i++) {
+      LayerTimer timer(profile, i);
+      layers[i]->MakeShells(params);
+    }
+    shelled = newshelled;
+
+    // needs the shells one layer up
+    const int newcovered = (shelled == count) ? count : max(0, shelled-1);
+    if (make_uncovered) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int i = covered; i < newcovered; i++) {
+	LayerTimer timer(profile, i);
+	if (i < count-1)
+	  MakeUncoveredFromAbove(i, make_decor);
+	if (i > 0)
+	  MakeUncoveredFromBelow(i, make_decor, make_bridges);
+	if (i == 0)
+	  layers[i]->addFullPolygons(layers[i]->GetFillPolygons(), make_decor);
+	if (i == count-1)
+	  layers[i]->addFullPolygons(layers[i]->GetFillPolygons(), make_decor);
+      }
+    }
+    covered = newcovered;
+
+    if (!make_support)
+      supported = covered;
+    else if (covered == count && supported < count) {
+      MakeSupportPolygons(widen, false);
+      supported = count;
+    }
+
+    const int newskinned = supported;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int i = skinned; i < newskinned; i++) {
+      if (i > 0)
+	layers[i]->makeSkinPolygons();
+      if (shells > 0)
+	saveFullPolygons(layers[i], unchanged[i]);
+    }
+    skinned = newskinned;
+
+    if (shells < 1)
+      merged = multiplied = skinned;
+    else {
+      // downwards, from the unchanged layers above
+      const int newmultiplied = (skinned == count) ? count : max(0, skinned-reach);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int i = multiplied; i < newmultiplied; i++) {
+	if (i > 1)
+	  for (int s = 1; s <= reach && i+s < count; s++)
+	    addFullFromAbove(layers[i], unchanged[i+s], s < numdecor);
+	saveFullPolygons(layers[i], multiplied_down[i]);
+      }
+      multiplied = newmultiplied;
+
+      // upwards, from the layers below as they were after that
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int i = merged; i < multiplied; i++) {
+	for (int s = 1; s <= reach && i-s >= 0; s++)
+	  addFullFromBelow(layers[i], multiplied_down[i-s], s < numdecor);
+	layers[i]->mergeFullPolygons(false);
+      }
+      merged = multiplied;
+
+      // not needed any more
+      for (; unsaved < multiplied; unsaved++)
+	unchanged[unsaved] = FullPolygons();
+      for (; unsaved_down < merged-reach; unsaved_down++)
+	multiplied_down[unsaved_down] = FullPolygons();
+    }
+
+    // all skirted layers need their shells
+    if (!skirted && shelled > 0 &&
+	(shelled == count || layers[shelled-1]->getZ() > skirtheight)) {
+      MakeSkirt();
+      skirted = true;
+    }
+
+    const int newfilled = skirted ? merged : filled;
+    if (make_infill) {
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+      for (int i = filled; i < newfilled; i++) {
+	LayerTimer timer(profile, i);
+	layers[i]->CalcInfill(params);
+      }
+    }
+    filled = newfilled;
+
+    if (!rafted && filled > 0) {
+      MakeRaftLayers(raft_layers, printOffsetZ); // printOffsetZ will have height of raft added
+      rafted = true;
+    }
+    if (rafted) {
+      // print lines of the raft layers and then of layers[]
+      const int nraft = (int)raft_layers.size();
+      const int newplanned = nraft + filled;
+      if (params.Slicing.PlanLayersParallel) {
+	// as in ConvertToGCode()
+	vector<Vector3d> starts(newplanned - planned);
+	for (int p = planned; p < newplanned; p++) {
+	  Layer *layer = p < nraft ? raft_layers[p] : layers[p-nraft];
+	  if (farthestStart)
+	    entry = layer->getFarthestPolygonPoint(entry);
+	  starts[p-planned] = Vector3d(entry.x(), entry.y(), start.z());
+	  entry = layer->getFarthestPolygonPoint(entry);
+	}
+	vector< vector<PLine3> > layerlines(newplanned - planned);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+	for (int p = planned; p < newplanned; p++) {
+	  Layer *layer = p < nraft ? raft_layers[p] : layers[p-nraft];
+	  Vector3d layerstart = starts[p-planned];
+	  layer->MakePrintlines(layerstart, layerlines[p-planned],
+				printOffsetZ, params);
+	}
+	for (uint l = 0; l < layerlines.size(); l++)
+	  plines.insert(plines.end(), layerlines[l].begin(), layerlines[l].end());
+      } else {
+	for (int p = planned; p < newplanned; p++) {
+	  Layer *layer = p < nraft ? raft_layers[p] : layers[p-nraft];
+	  if (farthestStart) {
+	    const Vector2d fartheststart = layer->getFarthestPolygonPoint(start);
+	    start.set(fartheststart.x(), fartheststart.y());
+	  }
+	  layer->MakePrintlines(start, plines, printOffsetZ, params);
+	}
+      }
+      planned = newplanned;
+    }
+
+    cont = m_progress->update(filled);
+  }
+
+  EndSlicing();
+  layers.insert(layers.begin(), raft_layers.begin(), raft_layers.end());
+  num_raft_layers = raft_layers.size();
+  return cont;
+}
+
+// Takes the layers of the last run (also if the model changed since) to
+// go on from the first stage whose inputs changed, clearing what that
+// stage and the later ones make.  Returns that stage.
+SliceStages::Stage Model::ReuseLayers(const SliceStages &stages)
+{
+  if (layers.empty())
+    layers.swap(kept_layers);
+  Vector2d offset;
+  const SliceStages::Stage from = layers.empty() ? SliceStages::SLICE
+    : stages.firstChanged(layers_stages, offset);
+  if (from == SliceStages::SLICE) {
+    ClearLayers();
+    return from;
+  }
+  for (uint i = 0; i < kept_layers.size(); i++)
+    delete kept_layers[i];
+  kept_layers.clear();
+  layers_stages = SliceStages();
+
+  // the raft is made again, its layer numbers may reach 0
+  const uint nraft = min(num_raft_layers, (uint)layers.size());
+  for (uint i = 0; i < nraft; i++)
+    delete layers[i];
+  layers.erase(layers.begin(), layers.begin() + nraft);
+  num_raft_layers = 0;
+
+  const int count = (int)layers.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+  for (int i = 0; i < count; i++) {
+    if (from <= SliceStages::POLYGONS)
+      layers[i]->ClearShells();
+    else if (from <= SliceStages::INFILL)
+      layers[i]->ClearInfill();
+    if (offset != Vector2d::ZERO)
+      layers[i]->move(offset);
+    if (from == SliceStages::SKIRT)
+      layers[i]->setSkirtPolygons(vector<Poly>());
+  }
+  lastlayer = count > 0 ? layers.back() : NULL;
+  return from;
+}
+
 void Model::ConvertToGCode()
 {
   if (is_calculating) {
@@ -791,6 +1221,8 @@ void Model::ConvertToGCode()
 
   // default:
   settings.SelectExtruder(0);
+  // settings for the whole run, the GUI may change them meanwhile
+  const SliceParams params(settings);
 
   Glib::TimeVal start_time;
   start_time.assign_current_time();
@@ -804,15 +1236,46 @@ void Model::ConvertToGCode()
   Vector3d printOffset  = settings.getPrintMargin();
   double   printOffsetZ = printOffset.z();
 
+  state.ResetLastWhere(Vector3d(0,0,0));
+
+  state.AppendCommand(MILLIMETERSASUNITS,  false, _("Millimeters"));
+  state.AppendCommand(ABSOLUTEPOSITIONING, false, _("Absolute Pos"));
+  if (params.Slicing.RelativeEcode)
+    state.AppendCommand(RELATIVE_ECODE, false, _("Relative E Code"));
+  else
+    state.AppendCommand(ABSOLUTE_ECODE, false, _("Absolute E Code"));
+
+  bool cont = true;
+  vector<PLine3> plines;
+  bool farthestStart = params.Slicing.FarthestLayerStart;
+  Vector3d start = state.LastPosition();
+
   // Make Layers
   lastlayer = NULL;
 
-
-  Slice();
+  profile.start();
+  vector<Shape*> shapes;
+  vector<Matrix4d> transforms;
+  GetSliceShapes(shapes, transforms);
+  const SliceStages stages(settings, shapes, transforms);
+  // run again from the first stage whose inputs changed
+  const SliceStages::Stage from = ReuseLayers(stages);
+  profile.step_done("Reuse");
+
+  if (from == SliceStages::SLICE && params.Slicing.PipelineLayers) {
+    cont = MakeLayersPipelined(params, Slice(false), printOffsetZ, start, plines);
+    profile.step_done("Pipeline");
+  } else {
+  if (from <= SliceStages::SLICE) {
+    Slice();
+    profile.step_done("Slice");
+  }
 
   //CleanupLayers();
 
-  MakeShells();
+  if (from <= SliceStages::POLYGONS) {
+  MakeShells(params);
+  profile.step_done("Shells");
 
   if (settings.get_boolean("Slicing","DoInfill") &&
       !settings.get_boolean("Slicing","NoTopAndBottom") &&
@@ -822,19 +1285,27 @@ void Model::ConvertToGCode()
     MakeUncoveredPolygons( settings.get_boolean("Slicing","MakeDecor"),
 			   !settings.get_boolean("Slicing","NoBridges") &&
 			   !settings.get_boolean("Slicing","Support") );
+  profile.step_done("Uncovered");
 
   if (settings.get_boolean("Slicing","Support"))
     // easier before having multiplied uncovered bottoms
     MakeSupportPolygons(settings.get_double("Slicing","SupportWiden"));
+  profile.step_done("Support");
 
   MakeFullSkins(); // must before multiplied uncovered bottoms
+  profile.step_done("Skins");
 
   MultiplyUncoveredPolygons();
+  profile.step_done("Multiply");
+  }
 
-  if (settings.get_boolean("Slicing","Skirt"))
+  if (from <= SliceStages::SKIRT && settings.get_boolean("Slicing","Skirt"))
     MakeSkirt();
 
-  CalcInfill();
+  if (from <= SliceStages::INFILL) {
+    CalcInfill(params);
+    profile.step_done("Infill");
+  }
 
   if (settings.get_boolean("Raft","Enable"))
     {
@@ -842,22 +1313,56 @@ void Model::ConvertToGCode()
       MakeRaft (state, printOffsetZ); // printOffsetZ will have height of raft added
     }
 
-  state.ResetLastWhere(Vector3d(0,0,0));
   uint count =  layers.size();
 
   m_progress->start (_("Making Lines"), count+1);
-
-  state.AppendCommand(MILLIMETERSASUNITS,  false, _("Millimeters"));
-  state.AppendCommand(ABSOLUTEPOSITIONING, false, _("Absolute Pos"));
-  if (settings.get_boolean("Slicing","RelativeEcode"))
-    state.AppendCommand(RELATIVE_ECODE, false, _("Relative E Code"));
-  else
-    state.AppendCommand(ABSOLUTE_ECODE, false, _("Absolute E Code"));
-
-  bool cont = true;
-  vector<PLine3> plines;
-  bool farthestStart = settings.get_boolean("Slicing","FarthestLayerStart");
-  Vector3d start = state.LastPosition();
+  profile.set_layers(count);
+
+  if (params.Slicing.PlanLayersParallel) {
+    // Estimate every layer's start in a quick pass, assuming a layer's
+    // lines end at its point farthest from where they started, then plan
+    // the layers independently and join them in order.
+    vector<Vector3d> starts(count);
+    Vector2d entry(start.x(), start.y());
+    for (uint p=0; p<count; p++) {
+      if (farthestStart)
+	entry = layers[p]->getFarthestPolygonPoint(entry);
+      starts[p] = Vector3d(entry.x(), entry.y(), start.z());
+      entry = layers[p]->getFarthestPolygonPoint(entry);
+    }
+    vector< vector<PLine3> > layerlines(count);
+    const int ncount = (int)count;
+    int done = 0;
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic)
+#endif
+    for (int p=0; p<ncount; p++) {
+#ifdef _OPENMP
+      #pragma omp flush (cont)
+#endif
+      if (!cont) continue;
+      LayerTimer timer(profile, p);
+      Vector3d layerstart = starts[p];
+      layers[p]->MakePrintlines(layerstart,
+				layerlines[p],
+				printOffsetZ,
+				params);
+#ifdef _OPENMP
+#pragma omp critical(updateProgress)
+#endif
+      {
+	cont = (m_progress->update(++done));
+#ifdef _OPENMP
+	#pragma omp flush (cont)
+#endif
+      }
+    }
+    // join
+    for (uint p=0; p<count && cont; p++) {
+      plines.insert(plines.end(), layerlines[p].begin(), layerlines[p].end());
+      vector<PLine3>().swap(layerlines[p]);
+    }
+  } else {
   for (uint p=0; p<count; p++) {
     cont = (m_progress->update(p)) ;
     if (!cont) break;
@@ -872,10 +1377,11 @@ void Model::ConvertToGCode()
       const Vector2d fartheststart = layers[p]->getFarthestPolygonPoint(start);
       start.set(fartheststart.x(), fartheststart.y());
     }
+    LayerTimer timer(profile, p);
     layers[p]->MakePrintlines(start,
 			      plines,
 			      printOffsetZ,
-			      settings);
+			      params);
     // } catch (Glib::Error &e) {
     //   error("GCode Error:", (e.what()).c_str());
     // }
@@ -883,18 +1389,24 @@ void Model::ConvertToGCode()
     //   cerr << p << ": " <<layers[p]->LayerNo << " prev: "
     // 	   << layers[p]->getPrevious()->LayerNo << endl;
   }
+  }
+  profile.step_done("Printlines");
+  }
   // do antiooze retract for all lines:
-  Printlines::makeAntioozeRetract(plines, settings, m_progress);
+  Printlines::makeAntioozeRetract(plines, params, m_progress);
+  profile.step_done("Antiooze");
   vector<Command> commands;
   //Printlines::getCommands(plines, settings, commands, m_progress);
-  Printlines::getCommands(plines, settings, state, m_progress);
+  Printlines::getCommands(plines, params, state, m_progress);
+  profile.step_done("GetCommands");
 
   //state.AppendCommands(commands, settings.Slicing.RelativeEcode);
 
-  string GcodeTxt;
-  if (cont)
-    gcode.MakeText (GcodeTxt, settings, m_progress);
-  else {
+  if (cont) {
+    gcode.MakeText (settings, m_progress);
+    profile.step_done("MakeText");
+    layers_stages = stages;
+  } else {
     ClearLayers();
     ClearGCode();
     ClearPreview();
@@ -940,7 +1452,7 @@ void Model::ConvertToGCode()
     Glib::TimeVal now;
     now.assign_current_time();
     const int time_used = (int) round((now - start_time).as_double()); // seconds
-    cerr << "GCode generated in " << time_used << " seconds. " << GcodeTxt.size() << " bytes" << endl;
+    cerr << "GCode generated in " << time_used << " seconds. " << (cont ? gcode.GetPrintJob()->GetLength() : 0) << " bytes (" << profile.summary() << ")" << endl;
   }
 
   is_calculating=false;
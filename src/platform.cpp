@@ -50,6 +50,47 @@ void Platform::setBinaryPath (const char *apparg)
   binary_path = g_strndup (apparg, p - apparg);
 }
 
+bool Platform::haveGLBuffers()
+{
+#ifdef HAVE_GL_BUFFERS
+  static int have = -1;
+  if (have < 0) {
+    int major = 0, minor = 0;
+    const char *version = (const char *)glGetString(GL_VERSION);
+    if (!version || sscanf(version, "%d.%d", &major, &minor) != 2)
+      return false; // no context yet
+    have = (major > 1 || (major == 1 && minor >= 5)) ? 1 : 0;
+  }
+  return have == 1;
+#else
+  return false;
+#endif
+}
+
+// renderers may be cleared in other threads
+G_LOCK_DEFINE_STATIC (unused_buffers);
+static std::vector<GLuint> unused_buffers;
+
+void Platform::releaseGLBuffer(GLuint buffer)
+{
+  if (buffer == 0) return;
+  G_LOCK (unused_buffers);
+  unused_buffers.push_back(buffer);
+  G_UNLOCK (unused_buffers);
+}
+
+void Platform::deleteUnusedGLBuffers()
+{
+  std::vector<GLuint> buffers;
+  G_LOCK (unused_buffers);
+  buffers.swap(unused_buffers);
+  G_UNLOCK (unused_buffers);
+#ifdef HAVE_GL_BUFFERS
+  if (!buffers.empty() && haveGLBuffers())
+    glDeleteBuffers(buffers.size(), &buffers[0]);
+#endif
+}
+
 bool Platform::has_extension(const std::string &fname, const char *extn)
 {
   if (fname.find_last_of(".") == std::string::npos)
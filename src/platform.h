@@ -34,6 +34,10 @@
 	#include <OpenGL/glu.h>
 //	#include <GLUT/glut.h>
 #else
+	// declare the GL 1.5 buffer object functions too
+	#ifndef GL_GLEXT_PROTOTYPES
+	#define GL_GLEXT_PROTOTYPES
+	#endif
 	#include <GL/gl.h>		// Header File For The OpenGL32 Library
 	#include <GL/glu.h>		// Header File For The GLu32 Library
 //#ifndef WIN32
@@ -41,12 +45,24 @@
 //#endif
 #endif
 
+// Windows' GL library only has GL 1.1
+#if defined(GL_VERSION_1_5) && !defined(WIN32)
+#define HAVE_GL_BUFFERS
+#endif
+
 class Platform {
   public:
 	static unsigned long getTickCount();
 	static void setBinaryPath(const char *apparg);
 	static std::vector<std::string> getConfigPaths();
 	static bool has_extension(const std::string &fname, const char *extn);
+	// the current GL context has buffer objects (GL 1.5)
+	static bool haveGLBuffers();
+	// A buffer object no longer used, also where the GL context is
+	// not current.  It is deleted by the next deleteUnusedGLBuffers(),
+	// which needs the context.
+	static void releaseGLBuffer(GLuint buffer);
+	static void deleteUnusedGLBuffers();
 };
 
 std::string str(double r, int prec = -1);
@@ -0,0 +1,300 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "previewlayers.h"
+#include "shape.h"
+#include "layer.h"
+
+// deletes a preview layer, keeping its previous one until then
+struct PreviousKeeper
+{
+  std::shared_ptr<Layer> previous;
+  void operator()(Layer *layer) const { delete layer; }
+};
+
+// the previous layer of a preview layer: drawing reads only its
+// polygons, and a copy of them does not keep the layers below it
+static Layer *outlineOf(const Layer &layer)
+{
+  Layer *outline = new Layer(NULL, layer.LayerNo, layer.thickness, 1);
+  outline->setZ(layer.getZ());
+  vector<Poly> polys = layer.GetPolygons();
+  outline->SetPolygons(polys);
+  return outline;
+}
+
+#ifdef _OPENMP
+static const uint num_workers = 2;
+#else
+// without OpenMP the shapes' caches are not guarded
+static const uint num_workers = 1;
+#endif
+
+
+PreviewInput::PreviewInput(const Settings &settings)
+  : revision(0), params(settings)
+{
+  skins = settings.get_integer("Slicing","Skins");
+  supportangle = settings.get_double("Slicing","SupportAngle")*M_PI/180.;
+  if (!settings.get_boolean("Slicing","Support")) supportangle = -1;
+  skirt = settings.get_boolean("Slicing","Skirt");
+  skirtheight = settings.get_double("Slicing","SkirtHeight");
+  skirtdistance = settings.get_double("Slicing","SkirtDistance");
+  singleskirt = settings.get_boolean("Slicing","SingleSkirt") &&
+    !settings.get_boolean("Slicing","Support");
+}
+
+void PreviewInput::addShapes(const vector<Shape*> &shapes_,
+			     const vector<Matrix4d> &transforms_, bool copy)
+{
+  for (uint i = 0; i < shapes_.size(); i++) {
+    if (copy) {
+      copies.push_back(std::shared_ptr<const Shape>(shapes_[i]->clone()));
+      shapes.push_back(copies.back().get());
+    } else
+      shapes.push_back(shapes_[i]);
+    transforms.push_back(transforms_[i]);
+  }
+}
+
+Layer * PreviewInput::makeLayer(double z, uint layerno, double thickness,
+				bool calcinfill, const std::atomic<bool> *cancel) const
+{
+  double max_grad = 0;
+  Layer * layer = new Layer(NULL, layerno, thickness, skins);
+  layer->setZ(z);
+  for (size_t f = 0; f < shapes.size(); f++) {
+    if (cancel && *cancel) break;
+    layer->addShape(transforms[f], *shapes[f], z, max_grad, supportangle);
+  }
+
+  if (!cancel || !*cancel)
+    layer->MakeShells(params);
+
+  if (skirt && (!cancel || !*cancel)) {
+    if (layer->getZ() - layer->thickness <= skirtheight)
+      layer->MakeSkirt(skirtdistance, singleskirt);
+  }
+
+  if (calcinfill && (!cancel || !*cancel))
+    layer->CalcInfill(params);
+
+  if (cancel && *cancel) {
+    delete layer;
+    return NULL;
+  }
+  return layer;
+}
+
+
+PreviewLayers::PreviewLayers()
+  : quit(false)
+{
+  mutex_init(&mutex);
+  cond_init(&cond);
+}
+
+PreviewLayers::~PreviewLayers()
+{
+  mutex_lock(&mutex);
+  quit = true;
+  queue.clear();
+  for (list<Job>::iterator j = running.begin(); j != running.end(); j++)
+    *j->cancel = true;
+  cond_broadcast(&cond);
+  mutex_unlock(&mutex);
+  for (uint i = 0; i < workers.size(); i++)
+    thread_join(workers[i]);
+  mutex_destroy(&mutex);
+  cond_destroy(&cond);
+}
+
+// z and thickness match to 0.1 micron
+PreviewLayers::layerkey PreviewLayers::layerKey(double z, double thickness,
+						bool calcinfill)
+{
+  return layerkey(std::make_pair(lround(z*1e4), lround(thickness*1e4)), calcinfill);
+}
+
+void PreviewLayers::setInput(std::shared_ptr<const PreviewInput> newinput)
+{
+  mutex_lock(&mutex);
+  input = newinput;
+  queue.clear();
+  for (list<Job>::iterator j = running.begin(); j != running.end(); j++)
+    *j->cancel = true;
+  cache.clear();
+  mutex_unlock(&mutex);
+}
+
+unsigned long PreviewLayers::getRevision() const
+{
+  mutex_lock(&mutex);
+  const unsigned long revision = input ? input->revision : 0;
+  mutex_unlock(&mutex);
+  return revision;
+}
+
+std::shared_ptr<Layer> PreviewLayers::request(double z, uint layerno,
+					      double thickness, bool calcinfill)
+{
+  std::shared_ptr<Layer> layer;
+  mutex_lock(&mutex);
+  if (!input) {
+    mutex_unlock(&mutex);
+    return layer;
+  }
+  while (workers.size() < num_workers) {
+    thread_t thread;
+    if (thread_create(&thread, workerMain, this) != 0) break;
+    workers.push_back(thread);
+  }
+
+  // only this layer and its neighbours are still wanted
+  wanted = layerKey(z, thickness, calcinfill);
+  const layerkey below = layerKey(z - thickness, thickness, calcinfill),
+    above = layerKey(z + thickness, thickness, calcinfill);
+  queue.clear();
+  for (list<Job>::iterator j = running.begin(); j != running.end(); j++)
+    if (j->key != wanted && j->key != below && j->key != above)
+      *j->cancel = true;
+
+  Entry *entry = findCached(wanted);
+  if (entry)
+    layer = entry->layer;
+  else
+    enqueue(z, layerno, thickness, calcinfill);
+  if (layerno > 0 && z >= thickness)
+    enqueue(z - thickness, layerno - 1, thickness, calcinfill);
+  enqueue(z + thickness, layerno + 1, thickness, calcinfill);
+  cond_broadcast(&cond);
+  mutex_unlock(&mutex);
+  return layer;
+}
+
+bool PreviewLayers::isQueued(const layerkey &key) const
+{
+  for (uint i = 0; i < queue.size(); i++)
+    if (queue[i].key == key) return true;
+  for (list<Job>::const_iterator j = running.begin(); j != running.end(); j++)
+    if (j->key == key && !*j->cancel) return true;
+  return false;
+}
+
+// moves the entry to the front
+PreviewLayers::Entry * PreviewLayers::findCached(const layerkey &key)
+{
+  for (list<Entry>::iterator e = cache.begin(); e != cache.end(); e++)
+    if (e->key == key) {
+      cache.splice(cache.begin(), cache, e);
+      return &cache.front();
+    }
+  return NULL;
+}
+
+void PreviewLayers::enqueue(double z, uint layerno, double thickness,
+			    bool calcinfill)
+{
+  Job job;
+  job.key = layerKey(z, thickness, calcinfill);
+  if (isQueued(job.key)) return;
+  for (list<Entry>::const_iterator e = cache.begin(); e != cache.end(); e++)
+    if (e->key == job.key) return;
+  job.z = z;
+  job.thickness = thickness;
+  job.layerno = layerno;
+  job.calcinfill = calcinfill;
+  job.cancel.reset(new std::atomic<bool>(false));
+  queue.push_back(job);
+}
+
+void *PreviewLayers::workerMain(void *arg)
+{
+  static_cast<PreviewLayers*>(arg)->work();
+  return NULL;
+}
+
+void PreviewLayers::work()
+{
+  mutex_lock(&mutex);
+  while (!quit) {
+    if (queue.empty()) {
+      cond_wait(&cond, &mutex);
+      continue;
+    }
+    running.push_back(queue.front());
+    queue.pop_front();
+    const Job &job = running.back();
+    const std::shared_ptr<const PreviewInput> jobinput = input;
+    // any finished layer below will do, only its polygons are read
+    std::shared_ptr<Layer> cachedbelow;
+    Entry *cached = findCached(layerKey(job.z - job.thickness, job.thickness, false));
+    if (!cached)
+      cached = findCached(layerKey(job.z - job.thickness, job.thickness, true));
+    if (cached)
+      cachedbelow = cached->layer;
+    mutex_unlock(&mutex);
+
+    std::shared_ptr<Layer> below;
+    if (cachedbelow) {
+      below.reset(outlineOf(*cachedbelow));
+      cachedbelow.reset();
+    }
+    Layer *made = jobinput->makeLayer(job.z, job.layerno, job.thickness,
+				      job.calcinfill, job.cancel.get());
+    if (made && !below && job.layerno > 0 && job.z >= job.thickness) {
+      Layer *full = jobinput->makeLayer(job.z - job.thickness, job.layerno - 1,
+					job.thickness, false, job.cancel.get());
+      if (full) {
+	below.reset(outlineOf(*full));
+	delete full;
+      }
+    }
+    std::shared_ptr<Layer> layer;
+    if (made) {
+      made->setPrevious(below.get());
+      PreviousKeeper keeper;
+      keeper.previous = below;
+      layer.reset(made, keeper);
+    }
+
+    mutex_lock(&mutex);
+    bool ready = false;
+    if (layer && !*job.cancel && jobinput == input) {
+      Entry entry;
+      entry.key = job.key;
+      entry.layer = layer;
+      cache.push_front(entry);
+      while (cache.size() > cache_size)
+	cache.pop_back();
+      ready = (job.key == wanted);
+    }
+    for (list<Job>::iterator j = running.begin(); j != running.end(); j++)
+      if (&*j == &job) {
+	running.erase(j);
+	break;
+      }
+    if (ready) {
+      mutex_unlock(&mutex);
+      signal_ready.emit();
+      mutex_lock(&mutex);
+    }
+  }
+  mutex_unlock(&mutex);
+}
@@ -0,0 +1,118 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#pragma once
+
+#include <atomic>
+#include <deque>
+#include <list>
+#include <memory>
+
+#include <glibmm/dispatcher.h>
+
+#include "stdafx.h"
+#include "settings.h"
+#include "printer/thread.h"
+
+// What a single preview layer is made from.  For other threads it holds
+// copies of the shapes, so the GUI can change the model meanwhile.
+struct PreviewInput
+{
+  PreviewInput(const Settings &settings);
+
+  // copy=false for use in this thread only
+  void addShapes(const vector<Shape*> &shapes,
+		 const vector<Matrix4d> &transforms, bool copy);
+
+  // NULL if cancelled
+  Layer *makeLayer(double z, uint layerno, double thickness, bool calcinfill,
+		   const std::atomic<bool> *cancel = NULL) const;
+
+  unsigned long revision; // of the model the input was taken from
+
+private:
+  vector<const Shape*> shapes;
+  vector<Matrix4d> transforms;
+  vector< std::shared_ptr<const Shape> > copies; // own the shapes if copied
+
+  SliceParams params;
+  uint skins;
+  double supportangle; // radians, -1 for no support
+  bool skirt, singleskirt;
+  double skirtheight, skirtdistance;
+};
+
+// Makes preview layers in worker threads, so the view can show the last
+// finished layer while the one asked for is made.  Finished layers are
+// kept in a small cache of the most recently used ones, and the layers
+// next to the one asked for are made in advance.  Work that is no longer
+// asked for is dropped from the queue or cancelled while running.
+class PreviewLayers
+{
+public:
+  PreviewLayers();
+  ~PreviewLayers();
+
+  // start over for another model revision
+  void setInput(std::shared_ptr<const PreviewInput> input);
+  unsigned long getRevision() const;
+
+  // the layer at z if it is finished, else NULL and it will be made
+  std::shared_ptr<Layer> request(double z, uint layerno, double thickness,
+				 bool calcinfill);
+
+  // emitted in the GUI thread when the last requested layer is finished
+  Glib::Dispatcher signal_ready;
+
+  static const uint cache_size = 16;
+
+private:
+  typedef std::pair< std::pair<long, long>, bool > layerkey;
+  static layerkey layerKey(double z, double thickness, bool calcinfill);
+
+  struct Job {
+    layerkey key;
+    double z, thickness;
+    uint layerno;
+    bool calcinfill;
+    std::shared_ptr< std::atomic<bool> > cancel;
+  };
+  struct Entry {
+    layerkey key;
+    std::shared_ptr<Layer> layer; // keeps the outline of the one below
+  };
+
+  // all below are guarded by mutex
+  mutable mutex_t mutex;
+  cond_t cond;
+  std::shared_ptr<const PreviewInput> input;
+  std::deque<Job> queue;
+  std::list<Job> running;
+  std::list<Entry> cache; // most recently used first
+  layerkey wanted;        // last requested
+  bool quit;
+
+  vector<thread_t> workers; // started on the first request
+
+  bool isQueued(const layerkey &key) const;
+  Entry *findCached(const layerkey &key);
+  void enqueue(double z, uint layerno, double thickness, bool calcinfill);
+
+  static void *workerMain(void *arg);
+  void work();
+};
@@ -0,0 +1,168 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include <string.h>
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "print_job.h"
+
+PrintJob::PrintJob( void ) :
+  data( "" ),
+  length( 0 ) {
+#ifdef WIN32
+  file_handle = INVALID_HANDLE_VALUE;
+  mapping_handle = NULL;
+#else
+  mapping = NULL;
+#endif
+}
+
+PrintJob::~PrintJob() {
+#ifdef WIN32
+  if ( mapping_handle != NULL ) {
+    UnmapViewOfFile( data );
+    CloseHandle( mapping_handle );
+  }
+  if ( file_handle != INVALID_HANDLE_VALUE )
+    CloseHandle( file_handle );
+#else
+  if ( mapping != NULL )
+    munmap( mapping, length );
+#endif
+}
+
+shared_ptr<PrintJob> PrintJob::FromString( string &text ) {
+  shared_ptr<PrintJob> job( new PrintJob() );
+
+  job->text.swap( text );
+  job->data = job->text.c_str();
+  job->length = job->text.length();
+  job->IndexLines();
+
+  return job;
+}
+
+shared_ptr<PrintJob> PrintJob::FromFile( const string &path ) {
+  shared_ptr<PrintJob> job( new PrintJob() );
+
+#ifdef WIN32
+  job->file_handle = CreateFile( path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+  if ( job->file_handle == INVALID_HANDLE_VALUE )
+    return shared_ptr<PrintJob>();
+
+  LARGE_INTEGER size;
+  if ( ! GetFileSizeEx( job->file_handle, &size ) )
+    return shared_ptr<PrintJob>();
+
+  if ( size.QuadPart > 0 ) {
+    job->mapping_handle = CreateFileMapping( job->file_handle, NULL, PAGE_READONLY, 0, 0, NULL );
+    if ( job->mapping_handle == NULL )
+      return shared_ptr<PrintJob>();
+
+    const char *view = ( const char * ) MapViewOfFile( job->mapping_handle, FILE_MAP_READ, 0, 0, 0 );
+    if ( view == NULL ) {
+      CloseHandle( job->mapping_handle );
+      job->mapping_handle = NULL;
+      return shared_ptr<PrintJob>();
+    }
+    job->data = view;
+    job->length = size.QuadPart;
+  }
+#else
+  int fd = open( path.c_str(), O_RDONLY );
+  if ( fd < 0 )
+    return shared_ptr<PrintJob>();
+
+  struct stat st;
+  if ( fstat( fd, &st ) != 0 ) {
+    close( fd );
+    return shared_ptr<PrintJob>();
+  }
+
+  if ( st.st_size > 0 ) {
+    void *mapping = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    if ( mapping == MAP_FAILED ) {
+      close( fd );
+      return shared_ptr<PrintJob>();
+    }
+#ifdef MADV_SEQUENTIAL
+    madvise( mapping, st.st_size, MADV_SEQUENTIAL );
+#endif
+    job->mapping = mapping;
+    job->data = ( const char * ) mapping;
+    job->length = st.st_size;
+  }
+  close( fd ); // The mapping stays valid
+#endif
+
+  job->path = path;
+  job->IndexLines();
+
+  return job;
+}
+
+void PrintJob::IndexLines( void ) {
+  line_starts.clear();
+  if ( length == 0 )
+    return;
+
+  // About 30 bytes per line of gcode
+  line_starts.reserve( length / 30 + 1 );
+
+  const char *end = data + length;
+  const char *loc = data;
+  while ( loc < end ) {
+    line_starts.push_back( loc - data );
+    const char *newline = ( const char * ) memchr( loc, '\n', end - loc );
+    if ( newline == NULL )
+      break;
+    loc = newline + 1;
+  }
+}
+
+size_t PrintJob::GetLineOffset( unsigned long line ) const {
+  if ( line == 0 )
+    return 0;
+  if ( line > line_starts.size() )
+    return length;
+  return line_starts[ line - 1 ];
+}
+
+size_t PrintJob::GetLineLength( unsigned long line ) const {
+  if ( line == 0 || line > line_starts.size() )
+    return 0;
+
+  size_t start = line_starts[ line - 1 ];
+  size_t stop = line < line_starts.size() ? line_starts[ line ] - 1 : length;
+  if ( stop > start && stop == length && data[ stop - 1 ] == '\n' )
+    stop--;
+  if ( stop > start && data[ stop - 1 ] == '\r' )
+    stop--;
+
+  return stop - start;
+}
+
+string PrintJob::GetLine( unsigned long line ) const {
+  return string( data + GetLineOffset( line ), GetLineLength( line ) );
+}
@@ -0,0 +1,74 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+using namespace std;
+
+// The text of a print job with the start of every line, so any line can
+// be found without scanning.  The text is either a mapped file or a
+// string taken over from the caller, and it is never copied or changed
+// afterwards, so printer and GUI can share the job between threads.
+class PrintJob {
+  const char *data;
+  size_t length;
+  string text; // owns data if not mapped
+  string path; // the mapped file, empty if not mapped
+
+#ifdef WIN32
+  HANDLE file_handle;
+  HANDLE mapping_handle;
+#else
+  void *mapping;
+#endif
+
+  vector<size_t> line_starts; // line_starts[ n - 1 ] is the offset of line n
+
+  PrintJob( void );
+  void IndexLines( void );
+
+public:
+  ~PrintJob();
+
+  static shared_ptr<PrintJob> FromString( string &text ); // Takes the contents of text, text is empty afterwards
+  static shared_ptr<PrintJob> FromFile( const string &path ); // Maps the file.  Returns NULL on error.
+
+  const char *GetData( void ) const { return data; }
+  const string &GetPath( void ) const { return path; }
+  size_t GetLength( void ) const { return length; }
+
+  unsigned long GetLineCount( void ) const { return line_starts.size(); }
+  // A last line without a newline is counted, too
+
+  size_t GetLineOffset( unsigned long line ) const;
+  // Offset of the first character of line (counting from 1), GetLength() past the last line
+
+  size_t GetLineLength( unsigned long line ) const;
+  // Length of line without the newline
+
+  string GetLine( unsigned long line ) const;
+};
@@ -0,0 +1,128 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+// Checks the line index of string and file print jobs.  Usage:
+// print_job_test [LINES]
+
+#include "print_job.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+static int errors = 0;
+
+static void Check( bool ok, const string &what ) {
+  if ( ! ok ) {
+    cerr << "FAIL: " << what << endl;
+    errors++;
+  }
+}
+
+static double Now( void ) {
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void CheckLines( const PrintJob &job, const vector<string> &lines, const string &name ) {
+  Check( job.GetLineCount() == lines.size(), name + ": line count" );
+  for ( unsigned long i = 0; i < lines.size() && i < job.GetLineCount(); i++ )
+    if ( job.GetLine( i + 1 ) != lines[ i ] ) {
+      Check( false, name + ": line " + job.GetLine( i + 1 ) + " instead of " + lines[ i ] );
+      break;
+    }
+  Check( job.GetLineOffset( lines.size() + 1 ) == job.GetLength(), name + ": offset past the end" );
+}
+
+int main( int argc, char *argv[] ) {
+  unsigned long count = argc > 1 ? strtoul( argv[ 1 ], NULL, 10 ) : 1000000;
+
+  // Small cases
+  string text = "G1 X1\nG1 X2\r\n\nG1 X3";
+  shared_ptr<PrintJob> job = PrintJob::FromString( text );
+  Check( text.empty(), "string is taken over" );
+  vector<string> lines;
+  lines.push_back( "G1 X1" );
+  lines.push_back( "G1 X2" );
+  lines.push_back( "" );
+  lines.push_back( "G1 X3" );
+  CheckLines( *job, lines, "no newline at end" );
+
+  text = "G1 X1\nG1 X2\n";
+  job = PrintJob::FromString( text );
+  lines.resize( 2 );
+  lines[ 1 ] = "G1 X2";
+  CheckLines( *job, lines, "newline at end" );
+
+  text = "";
+  job = PrintJob::FromString( text );
+  CheckLines( *job, vector<string>(), "empty" );
+
+  Check( ! PrintJob::FromFile( "/nonexistent/print_job_test.gcode" ), "missing file" );
+
+  // A big file
+  char name[] = "/tmp/print_job_testXXXXXX";
+  int fd = mkstemp( name );
+  if ( fd < 0 ) {
+    cerr << "Cannot create temporary file" << endl;
+    return 1;
+  }
+  close( fd );
+
+  lines.clear();
+  ofstream out( name );
+  for ( unsigned long i = 0; i < count; i++ ) {
+    ostringstream line;
+    line << "G1 X" << i % 200 << "." << i % 10 << " Y" << i % 123 << " E" << i;
+    if ( i % 17 == 0 )
+      line << " ; comment";
+    lines.push_back( line.str() );
+    out << line.str() << "\n";
+  }
+  out.close();
+
+  double start = Now();
+  job = PrintJob::FromFile( name );
+  double indexed = Now();
+  Check( job != NULL, "mapping the file" );
+  if ( job ) {
+    CheckLines( *job, lines, "file" );
+
+    // Random access
+    srand( 1 );
+    double seek_start = Now();
+    unsigned long bytes = 0;
+    for ( unsigned long i = 0; i < 100000; i++ )
+      bytes += job->GetLineLength( rand() % count + 1 );
+    double seek_end = Now();
+
+    cout << count << " lines, " << job->GetLength() / 1e6 << " MB mapped and indexed in "
+	 << indexed - start << " s, 100000 random lines in " << seek_end - seek_start
+	 << " s (" << bytes << " bytes)" << endl;
+  }
+  unlink( name );
+
+  cout << ( errors == 0 ? "PASS" : "FAIL" ) << endl;
+  return errors == 0 ? 0 : 1;
+}
@@ -98,13 +98,26 @@ bool Printer::Reset( void ) {
 }
 
 bool Printer::StartPrinting( unsigned long start_line, unsigned long stop_line ) {
-  string commands = m_model->GetGCodeBuffer()->get_text();
-
-  return Printer::StartPrinting( commands, start_line, stop_line );
+  return Printer::StartPrinting( m_model->gcode.GetPrintJob(), start_line, stop_line );
 }
 
 bool Printer::StartPrinting( string commands, unsigned long start_line, unsigned long stop_line ) {
-  bool ret = ThreadedPrinterSerial::StartPrinting( commands, start_line, stop_line );
+  return Printer::StartPrinting( PrintJob::FromString( commands ), start_line, stop_line );
+}
+
+bool Printer::StartPrinting( shared_ptr<const PrintJob> job, unsigned long start_line, unsigned long stop_line ) {
+  if ( m_model ) {
+    bool stream = false;
+    int buffer_size = 127;
+    try { // not in older config files
+      stream = m_model->settings.get_boolean("Hardware","StreamCommands");
+      buffer_size = m_model->settings.get_integer("Hardware","FirmwareBufferSize");
+    } catch (const Glib::KeyFileError &err) {
+    }
+    SetStreaming( stream, buffer_size > 0 ? buffer_size : 127 );
+  }
+
+  bool ret = ThreadedPrinterSerial::StartPrinting( job, start_line, stop_line );
 
   if ( ret ) {
     prev_line = start_line;
@@ -62,6 +62,7 @@ public:
 
   bool StartPrinting( unsigned long start_line = 1, unsigned long stop_line = ULONG_MAX );
   bool StartPrinting( string commands, unsigned long start_line = 1, unsigned long stop_line = ULONG_MAX );
+  bool StartPrinting( shared_ptr<const PrintJob> job, unsigned long start_line = 1, unsigned long stop_line = ULONG_MAX );
   bool StopPrinting( bool wait = true );
   bool ContinuePrinting( bool wait = true );
   void Inhibit( bool value = true );
@@ -741,6 +741,28 @@ char *PrinterSerial::RecvLine( void ) {
   return recvd;
 }
 
+// True if data from the printer is waiting, so RecvLine will not block for long
+bool PrinterSerial::RecvLineReady( void ) {
+#ifdef WIN32
+  if ( strchr( raw_recv, '\n' ) != NULL )
+    return true;
+
+  COMSTAT stat;
+  DWORD errors;
+  return ClearCommError( device_handle, &errors, &stat ) && stat.cbInQue > 0;
+#else
+  // The port is line buffered, so it only becomes readable with a complete line
+  struct timeval timeout;
+  fd_set set;
+
+  timeout.tv_sec = 0;
+  timeout.tv_usec = 0;
+  FD_ZERO( &set );
+  FD_SET( device_fd, &set );
+  return select( device_fd + 1, &set, NULL, NULL, &timeout ) > 0;
+#endif
+}
+
 void PrinterSerial::RecvTimeout( void ) {
 }
 
@@ -58,6 +58,7 @@ protected:
   char *FormatLine( void ); // Formats line of gcode in command_scratch and returns a pointer to the starting character
   bool SendText( char *text ); // Sends indicated text exactly.  Does not wait for reply.  Performs logging.
   char *RecvLine( void ); // Waits for a complete line from the port and receives that line into recv_buffer (but not at the start of recv_buffer to make logging easier).  Returns pointer to start of recv'd data.  Performs logging.  
+  bool RecvLineReady( void ); // True if data from the printer is waiting, so RecvLine will not block for long
   
   virtual void RecvTimeout( void );
   virtual void LogLine( const char *line );
@@ -26,6 +26,7 @@
 #include <iostream>
 #include <sstream>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "threaded_printer_serial.h"
@@ -42,7 +43,6 @@ ThreadedPrinterSerial::ThreadedPrinterSerial() :
   log_buffer( log_buffer_size, false, log_buffer_sleep, _("\n*** Log overflow ***\n\n"), true, false ),
   error_buffer( log_buffer_size, true, log_buffer_sleep, _("\n*** Error Log overflow ***\n\n"), true, false ) {
   request_print = is_printing = printing_complete = false;
-  printer_commands = NULL;
   pc_lines_printed = 0;
   pc_bytes_printed = 0;
   pc_stop_line = 0;
@@ -55,6 +55,13 @@ ThreadedPrinterSerial::ThreadedPrinterSerial() :
   helper_active = false;
   helper_cancel = false;
   return_data = NULL;
+
+  stream_enable = stream_active = false;
+  stream_buffer_size = stream_window = 127;
+  stream_history.resize( stream_history_size );
+  full_stream_scratch = new char[ max_command_size + max_command_prefix + 10 ];
+  stream_scratch = full_stream_scratch + max_command_prefix;
+  StreamReset();
 }
 
 ThreadedPrinterSerial::~ThreadedPrinterSerial() {
@@ -71,20 +78,17 @@ ThreadedPrinterSerial::~ThreadedPrinterSerial() {
   mutex_destroy( &pc_cond_mutex );
   cond_destroy( &pc_cond );
 
-  if ( printer_commands != NULL )
-    delete [] printer_commands;
+  delete [] full_stream_scratch;
 }
 
 bool ThreadedPrinterSerial::Connect( string device, int baudrate ) {
   // Open Serial Port
   if ( ! PrinterSerial::RawConnect( device, baudrate ) )
     return false;
+  StreamReset();
 
-  // Clear printer_commands
-  if ( printer_commands != NULL ) {
-    delete [] printer_commands;
-    printer_commands = NULL;
-  }
+  // Clear print_job
+  print_job.reset();
 
   // Clear/Flush buffers
   command_buffer.Flush();
@@ -148,6 +152,7 @@ bool ThreadedPrinterSerial::Reset( void ) {
   response_buffer.Flush();
 
   bool ret = PrinterSerial::RawReset();
+  StreamReset();
 
   helper_cancel = false;
 
@@ -168,47 +173,35 @@ bool ThreadedPrinterSerial::Reset( void ) {
 }
 
 bool ThreadedPrinterSerial::StartPrinting( string commands, unsigned long start_line, unsigned long stop_line ) {
-  char *commands_copy;
+  return ThreadedPrinterSerial::StartPrinting( PrintJob::FromString( commands ), start_line, stop_line );
+}
+
+bool ThreadedPrinterSerial::StartPrinting( shared_ptr<const PrintJob> job, unsigned long start_line, unsigned long stop_line ) {
   int rc;
-  size_t pos;
-  unsigned long count;
   unsigned long lines_printed;
   unsigned long bytes_printed;
 
-  for ( pos = -1, count = 1; count < start_line; count++ ) {
-    if ( ( pos = commands.find( '\n', pos + 1 ) ) == string::npos ) {
-      char err_buf[ 1024 ];
-      snprintf( err_buf, 1024, _("Error: Cannot start print at line %lu since Gcode only contains %lu lines\n"), start_line, count );
-      if ( err_buf[ 1022 ] != '\0' )
-	err_buf[ 1022 ] = '\n';
-      err_buf[ 1023 ] = '\0';
-      LogError( err_buf );
-      return false;
-    }
+  unsigned long count = job ? job->GetLineCount() : 0;
+  if ( ! job || start_line > count ) {
+    char err_buf[ 1024 ];
+    snprintf( err_buf, 1024, _("Error: Cannot start print at line %lu since Gcode only contains %lu lines\n"), start_line, count );
+    if ( err_buf[ 1022 ] != '\0' )
+      err_buf[ 1022 ] = '\n';
+    err_buf[ 1023 ] = '\0';
+    LogError( err_buf );
+    return false;
   }
 
-  bytes_printed = pos + 1;
+  bytes_printed = job->GetLineOffset( start_line );
   lines_printed = start_line > 0 ? start_line - 1 : 0;
 
-  while ( count < stop_line ) {
-    if ( ( pos = commands.find( '\n', pos + 1 ) ) == string::npos ) {
-      if ( commands[ commands.length() - 1 ] != '\n' )
-	count++;
-      break;
-    }
-    count++;
-  }
-  stop_line = count;
-
-  // Allocate memory for commands
-  size_t len;
-  len = commands.length();
-  commands_copy = new char[ len + 10 ];
-  memcpy( commands_copy, commands.c_str(), len + 1 );
+  if ( stop_line > count )
+    stop_line = count;
+  if ( stop_line < start_line )
+    stop_line = start_line;
 
   // Make sure we are connected to a printer
   if ( ! IsConnected() ) {
-    delete [] commands_copy;
     ostringstream os;
     os << _("Error starting print") << ": " << _("Printer connection not established") << endl;
     LogError( os.str().c_str() );
@@ -217,7 +210,6 @@ bool ThreadedPrinterSerial::StartPrinting( string commands, unsigned long start_
 
   // Lock pc_mutex
   if ( ( rc = mutex_lock( &pc_mutex ) ) != 0 ) {
-    delete [] commands_copy;
     ostringstream os;
     os << _("Error starting print") << ": pc_mutex: " << strerror( rc ) << endl;
     LogError( os.str().c_str() );
@@ -226,7 +218,6 @@ bool ThreadedPrinterSerial::StartPrinting( string commands, unsigned long start_
 
   // Lock the cond mutex
   if ( ( rc = mutex_lock( &pc_cond_mutex ) ) != 0 ) {
-    delete [] commands_copy;
     mutex_unlock( &pc_mutex );
     ostringstream os;
     os << _("Error starting print") << ": pc_cond_mutex: " << strerror( rc ) << endl;
@@ -235,7 +226,6 @@ bool ThreadedPrinterSerial::StartPrinting( string commands, unsigned long start_
   }
 
   if ( inhibit_count > 0 ) {
-    delete [] commands_copy;
     mutex_unlock( &pc_cond_mutex );
     mutex_unlock( &pc_mutex );
     return false;
@@ -246,7 +236,6 @@ bool ThreadedPrinterSerial::StartPrinting( string commands, unsigned long start_
     request_print = false;
 
     if ( ( rc = cond_wait( &pc_cond, &pc_cond_mutex ) ) !=0 ) {
-      delete [] commands_copy;
       mutex_unlock( &pc_cond_mutex );
       mutex_unlock( &pc_mutex );
       ostringstream os;
@@ -257,10 +246,7 @@ bool ThreadedPrinterSerial::StartPrinting( string commands, unsigned long start_
   }
 
   // Ready to start printing, set the variables
-  if ( printer_commands != NULL )
-    delete [] printer_commands;
-
-  printer_commands = commands_copy;
+  print_job = job;
   pc_lines_printed = lines_printed;
   pc_bytes_printed = bytes_printed;
   pc_stop_line = stop_line;
@@ -269,7 +255,6 @@ bool ThreadedPrinterSerial::StartPrinting( string commands, unsigned long start_
   request_print = true;
 
   if ( ( rc = cond_wait( &pc_cond, &pc_cond_mutex ) ) !=0 ) {
-    delete [] commands_copy;
     mutex_unlock( &pc_cond_mutex );
     mutex_unlock( &pc_mutex );
     ostringstream os;
@@ -332,7 +317,7 @@ bool ThreadedPrinterSerial::StopPrinting( bool wait ) {
 bool ThreadedPrinterSerial::ContinuePrinting( bool wait ) {
   int rc;
 
-  if ( printer_commands == NULL ) {
+  if ( ! print_job ) {
     ostringstream os;
     os << _("Error continuing print") << ": ";
     os << _("No stopped print to continue") << endl;
@@ -429,6 +414,13 @@ unsigned long ThreadedPrinterSerial::GetTotalPrintingLines( void ) {
   return lines;
 }
 
+void ThreadedPrinterSerial::SetStreaming( bool enable, unsigned long buffer_size ) {
+  mutex_lock( &pc_cond_mutex );
+  stream_enable = enable;
+  stream_buffer_size = buffer_size;
+  mutex_unlock( &pc_cond_mutex );
+}
+
 bool ThreadedPrinterSerial::SendAsync( char const * command) {
   return command_buffer.Write( command, true );
 }
@@ -501,10 +493,13 @@ void *ThreadedPrinterSerial::HelperMain( void ) {
     CheckPrintingState();
 
     if ( command_buffer.Read( command_scratch, max_command_size, false, &return_data ) > 0 ) {
+      // The next "ok" must be the answer to this command
+      StreamDrain();
       SendCommand( true );
-    } else if ( IsPrinting() ) {
+    } else if ( IsPrinting() && ! stream_active ) {
+      StreamDrain();
       SendNextPrinterCommand();
-    } else {
+    } else if ( ! StreamStep( IsPrinting() ) ) {
       nsleep( &helper_thread_sleep );
     }
   }
@@ -527,24 +522,31 @@ void ThreadedPrinterSerial::CheckPrintingState( void ) {
   if ( request_print != is_printing ) {
     is_printing = request_print;
     printing_complete = false;
+    if ( is_printing ) {
+      stream_active = stream_enable;
+      stream_window = stream_buffer_size;
+    }
     cond_broadcast( &pc_cond );
   }
 
   mutex_unlock( &pc_cond_mutex );
 }
 
-void ThreadedPrinterSerial::SendNextPrinterCommand( void ) {
+// Copy the next command to command_scratch and update the printing progress
+void ThreadedPrinterSerial::ReadNextPrinterCommand( void ) {
   unsigned long datalen;
   bool truncated = false;
 
   mutex_lock( &pc_cond_mutex );
 
   // Find the bounds of the next command
-  const char *start = printer_commands + pc_bytes_printed;
+  const char *data = print_job->GetData();
+  const char *end = data + print_job->GetLength();
+  const char *start = data + pc_bytes_printed;
 
-  const char *stop;
-  for ( stop = start; *stop != '\n' && *stop != '\0'; stop++ )
-    ;
+  const char *stop = ( const char * ) memchr( start, '\n', end - start );
+  if ( stop == NULL )
+    stop = end;
 
   datalen = stop - start;
   if ( datalen > max_command_size - 2 ) {
@@ -560,10 +562,10 @@ void ThreadedPrinterSerial::SendNextPrinterCommand( void ) {
 
   // Update status
   pc_lines_printed++;
-  pc_bytes_printed = stop - printer_commands + ( ( *stop == '\n' ) ? 1 : 0 );
+  pc_bytes_printed = stop - data + ( ( stop < end ) ? 1 : 0 );
 
   // Update printing complete
-  if ( *stop == '\0' || pc_lines_printed >= pc_stop_line )
+  if ( stop == end || pc_lines_printed >= pc_stop_line )
     printing_complete = true;
 
   mutex_unlock( &pc_cond_mutex );
@@ -577,6 +579,10 @@ void ThreadedPrinterSerial::SendNextPrinterCommand( void ) {
     LogLine( warn );
     LogError( warn );
   }
+}
+
+void ThreadedPrinterSerial::SendNextPrinterCommand( void ) {
+  ReadNextPrinterCommand();
 
   // Send the command and wait for response
   SendCommand( false );
@@ -585,6 +591,7 @@ void ThreadedPrinterSerial::SendNextPrinterCommand( void ) {
 void ThreadedPrinterSerial::SendCommand( bool buffer_response ) {
   // Don't send blank lines
   char *recvd = PrinterSerial::SendCommand();
+  stream_sent = prev_cmd_line_number;
 
   if ( recvd == NULL ) {
     if ( return_data != NULL )
@@ -594,14 +601,7 @@ void ThreadedPrinterSerial::SendCommand( bool buffer_response ) {
   }
 
   if ( strncasecmp( recvd, "!!", 2 ) == 0 ) {
-    // !! Fatal Error
-    response_buffer.Write( recvd, true );
-    if ( return_data != NULL )
-      return_data->AddLine( _("**Fatal Error\n") );
-    return_data = NULL;
-    helper_active = false;
-    Disconnect(); // This is safe.  With helper active false, no mutexes are needed and no threads are killed.
-    thread_exit();
+    FatalError( recvd );
   }
 
   if ( return_data != NULL ) {
@@ -619,6 +619,150 @@ void ThreadedPrinterSerial::SendCommand( bool buffer_response ) {
   }
 }
 
+// !! Fatal Error
+void ThreadedPrinterSerial::FatalError( char *recvd ) {
+  response_buffer.Write( recvd, true );
+  if ( return_data != NULL )
+    return_data->AddLine( _("**Fatal Error\n") );
+  return_data = NULL;
+  helper_active = false;
+  Disconnect(); // This is safe.  With helper active false, no mutexes are needed and no threads are killed.
+  thread_exit();
+}
+
+////////////////////////////////////////////////////////////////////////////
+//  Streaming
+////////////////////////////////////////////////////////////////////////////
+
+void ThreadedPrinterSerial::StreamReset( void ) {
+  for ( unsigned long i = 0; i < stream_history.size(); i++ )
+    stream_history[ i ] = pair<unsigned long, string>( 0, "" );
+  stream_sent = prev_cmd_line_number;
+  stream_in_flight.clear();
+  stream_in_flight_bytes = 0;
+  stream_stale = 0;
+}
+
+// Send one line or process one response.  Returns false if there is nothing to do.
+bool ThreadedPrinterSerial::StreamStep( bool take_new_line ) {
+  // Answers that have arrived already
+  if ( ! stream_in_flight.empty() && RecvLineReady() ) {
+    StreamResponse();
+    return true;
+  }
+
+  if ( stream_sent == prev_cmd_line_number ) {
+    // Everything sent, including resends
+    if ( ! take_new_line ) {
+      if ( stream_in_flight.empty() )
+	return false;
+      StreamResponse();
+      return true;
+    }
+
+    ReadNextPrinterCommand();
+    char *formated = FormatLine();
+    if ( formated == NULL ) // Blank line or comment, nothing to send
+      return true;
+    stream_history[ prev_cmd_line_number % stream_history_size ] =
+      pair<unsigned long, string>( prev_cmd_line_number, formated );
+  }
+
+  unsigned long line = stream_sent + 1;
+  const pair<unsigned long, string> &entry = stream_history[ line % stream_history_size ];
+  if ( entry.first != line ) {
+    char err[ 100 ];
+    snprintf( err, 99, _("*** Error: Line %lu to resend is not in the history\n"), line );
+    if ( err[ 98 ] != '\0' )
+      err[ 98 ] = '\n';
+    err[ 99 ] = '\0';
+    LogLine( err );
+    LogError( err );
+    stream_sent = prev_cmd_line_number;
+    return true;
+  }
+
+  // Wait until the printer has room for the line.  A line longer than
+  // the whole buffer is sent when the buffer is empty.  Lines in flight
+  // must stay in the history for resends.
+  unsigned long len = entry.second.length();
+  if ( ! stream_in_flight.empty() &&
+       ( stream_in_flight_bytes + len > stream_window ||
+	 stream_in_flight.size() >= stream_history_size / 2 ) ) {
+    StreamResponse();
+    return true;
+  }
+
+  memcpy( stream_scratch, entry.second.c_str(), len + 1 );
+  stream_sent = line;
+  if ( SendText( stream_scratch ) ) {
+    stream_in_flight.push_back( len );
+    stream_in_flight_bytes += len;
+  }
+  return true;
+}
+
+// Wait for and process one response from the printer
+void ThreadedPrinterSerial::StreamResponse( void ) {
+  char *recvd = RecvLine();
+
+  if ( recvd == NULL )
+    return;
+
+  if ( strncasecmp( recvd, "!!", 2 ) == 0 ) {
+    FatalError( recvd );
+  }
+
+  if ( strncasecmp( recvd, "ok", 2 ) == 0 ) {
+    // The oldest line is processed
+    if ( ! stream_in_flight.empty() ) {
+      stream_in_flight_bytes -= stream_in_flight.front();
+      stream_in_flight.pop_front();
+    }
+    if ( stream_stale > 0 )
+      stream_stale--;
+    return;
+  }
+
+  char *loc;
+  if ( strncasecmp( recvd, "rs", 2 ) == 0 )
+    loc = recvd + 2;
+  else if ( strncasecmp( recvd, "resend:", 7 ) == 0 )
+    loc = recvd + 7;
+  else
+    return; // Already logged
+
+  // The lines sent after the one with the error are rejected by the
+  // printer with the same request
+  if ( stream_stale > 0 )
+    return;
+
+  while ( *loc == ' ' || *loc == ':' || *loc == 'N' )
+    loc++;
+  unsigned long line = strtoul( loc, NULL, 10 );
+
+  if ( line == 0 || line > stream_sent ) {
+    char err[ 100 ];
+    snprintf( err, 99, _("*** Error: Printer requested resend of unsent line %lu\n"), line );
+    if ( err[ 98 ] != '\0' )
+      err[ 98 ] = '\n';
+    err[ 99 ] = '\0';
+    LogLine( err );
+    LogError( err );
+    return;
+  }
+
+  // Rewind, the lines are sent again from the history
+  stream_stale = stream_in_flight.size();
+  stream_sent = line - 1;
+}
+
+// Send everything outstanding and wait for all "ok"s
+void ThreadedPrinterSerial::StreamDrain( void ) {
+  while ( StreamStep( false ) )
+    ;
+}
+
 void ThreadedPrinterSerial::RecvTimeout( void ) {
   CheckPrintingState();
 }
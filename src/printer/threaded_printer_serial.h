@@ -20,10 +20,13 @@
 #pragma once
 
 #include <limits.h>
+#include <deque>
+#include <string>
 
 #include "thread.h"
 #include "thread_buffer.h"
 #include "printer_serial.h"
+#include "print_job.h"
 
 using namespace std;
 
@@ -39,7 +42,7 @@ class ThreadedPrinterSerial : protected PrinterSerial
   static const ntime_t helper_thread_sleep;
 
   // Rules:
-  // request_print, is_printing, and printer_commands are initialized to NULL
+  // request_print, is_printing, and print_job are initialized to NULL
   // To stop printing, thread must lock the mutex, set request_print to false
   //   and wait for the helper to signal on pc_cond.  Finally, release the
   //   mutex.
@@ -56,7 +59,7 @@ class ThreadedPrinterSerial : protected PrinterSerial
   //     set is_printing to match request_print, signal on pc_cond, and relase
   //     the mutex.
   //   <<handle queued commands>
-  //   if is_printing, send the next command from printer_commands.  Do NOT
+  //   if is_printing, send the next command from print_job.  Do NOT
   //     need to lock the mutex.
 
   mutex_t pc_mutex;
@@ -65,7 +68,7 @@ class ThreadedPrinterSerial : protected PrinterSerial
   bool printing_complete; // set by helper, no mutex required
   cond_t pc_cond; // signaled by helper, pc_mutex and pc_cond_mutex required
   mutex_t pc_cond_mutex;
-  const char *printer_commands; // set by main thread(s), pc_mutex required
+  shared_ptr<const PrintJob> print_job; // set by main thread(s), pc_mutex required
   unsigned long pc_lines_printed; // when is_printing is false, set by main thread(s), pc_mutex required.  When is_printing is true, set by helper, pc_mutex requried
   unsigned long pc_bytes_printed; // when is_printing is false, set by main thread(s), pc_mutex required.  When is_printing is true, set by helper, pc_mutex required
   unsigned long pc_stop_line; // set by main thread(s), pc_mutex required
@@ -82,8 +85,33 @@ class ThreadedPrinterSerial : protected PrinterSerial
 
   ThreadBufferReturnData::ReturnData *return_data;
 
+  // Streaming mode: instead of waiting for "ok" after every line, keep
+  // sending while the lines not yet acknowledged fit into the firmware's
+  // receive buffer.  Every line sent is answered by exactly one "ok",
+  // also the ones the firmware rejects with a resend request.
+  static const unsigned long stream_history_size = 128;
+  bool stream_enable; // set by main thread(s), pc_cond_mutex required
+  unsigned long stream_buffer_size; // firmware receive buffer in bytes, set by main thread(s), pc_cond_mutex required
+  // The rest is set by the helper
+  bool stream_active; // stream_enable when the print started
+  unsigned long stream_window; // stream_buffer_size when the print started
+  vector< pair<unsigned long, string> > stream_history; // ring of formated lines by line number
+  unsigned long stream_sent; // line number of the last line sent
+  deque<unsigned long> stream_in_flight; // lengths of the lines not acknowledged yet
+  unsigned long stream_in_flight_bytes;
+  unsigned long stream_stale; // lines sent before a resend request, their resend requests are ignored
+  char *full_stream_scratch;
+  char *stream_scratch;
+
+  void StreamReset( void );
+  bool StreamStep( bool take_new_line ); // Send one line or process one response.  Returns false if there is nothing to do.
+  void StreamResponse( void ); // Wait for and process one response from the printer
+  void StreamDrain( void ); // Send everything outstanding and wait for all "ok"s
+  void FatalError( char *recvd );
+
   void CheckPrintingState( void ); // Check if main thread is requesting printing and set helper thread switches accordingly
 
+  void ReadNextPrinterCommand( void ); // Copy the next command to command_scratch and update the printing progress
   void SendNextPrinterCommand( void );
   void SendCommand( bool buffer_response );
 
@@ -109,6 +137,8 @@ class ThreadedPrinterSerial : protected PrinterSerial
   // Send and SendAndWaitResponse can safely be sent
   // while printing.
   virtual bool StartPrinting( string commands, unsigned long start_line = 1, unsigned long stop_line = ULONG_MAX );
+  virtual bool StartPrinting( shared_ptr<const PrintJob> job, unsigned long start_line = 1, unsigned long stop_line = ULONG_MAX );
+  // The job is shared, not copied.  Starting at any line takes no time.
   virtual bool IsPrinting( void );
   virtual bool StopPrinting( bool wait = true );
   virtual bool ContinuePrinting( bool wait = true );
@@ -123,6 +153,11 @@ class ThreadedPrinterSerial : protected PrinterSerial
   unsigned long GetTotalPrintingLines( void );
   // Return the ending line of the current print
 
+  void SetStreaming( bool enable, unsigned long buffer_size = 127 );
+  // Stream printed lines: several lines may be sent before the printer
+  // acknowledges them, as long as they fit into buffer_size bytes.
+  // Takes effect with the next print.
+
   using PrinterSerial::Send;
   bool SendAsync( char const * command );
   bool Send( string command );
@@ -0,0 +1,266 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU Lesser General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Lesser General Public License for more details.
+
+    You should have received a copy of the GNU Lesser General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+// Prints to a fake firmware on a pseudo terminal, with and without
+// streaming.  The firmware checks line numbers and checksums, asks for
+// resends of some lines, and measures how many bytes the host has in
+// flight.  Posix only.
+
+#include "threaded_printer_serial.h"
+
+#include <deque>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/select.h>
+#include <sys/time.h>
+
+using namespace std;
+
+struct Firmware {
+  int fd;
+  unsigned long buffer_size;
+  unsigned long last_line;
+  vector<string> received; // accepted commands in order
+  unsigned long max_pending; // most bytes received and not yet acknowledged
+  unsigned long resends;
+  bool quit;
+  bool inject_errors;
+  vector<bool> corrupted;
+  deque< pair<double, string> > replies; // text with the time it is sent
+};
+
+static double Now( void ) {
+  struct timeval tv;
+  gettimeofday( &tv, NULL );
+  return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+// Answers arrive 1 ms later, like over USB
+static void Reply( Firmware *fw, const char *text ) {
+  fw->replies.push_back( pair<double, string>( Now() + 0.001, text ) );
+}
+
+static void Write( int fd, const char *text ) {
+  size_t len = strlen( text );
+  while ( len > 0 ) {
+    ssize_t num = write( fd, text, len );
+    if ( num <= 0 )
+      return;
+    text += num;
+    len -= num;
+  }
+}
+
+static void RequestResend( Firmware *fw, const char *error ) {
+  char msg[ 200 ];
+  snprintf( msg, 200, "Error:%s, Last Line: %lu\nResend: %lu\nok\n",
+	    error, fw->last_line, fw->last_line + 1 );
+  Reply( fw, msg );
+  fw->resends++;
+}
+
+// Handle one line like Marlin: every line gets one "ok"
+static void HandleLine( Firmware *fw, const string &line ) {
+  unsigned char cksum = 0;
+  size_t star = line.find( '*' );
+  if ( line[ 0 ] != 'N' || star == string::npos ) {
+    RequestResend( fw, "No Line Number with checksum" );
+    return;
+  }
+  for ( size_t i = 0; i < star; i++ )
+    cksum ^= line[ i ];
+  unsigned long number = strtoul( line.c_str() + 1, NULL, 10 );
+
+  if ( number != fw->last_line + 1 ) {
+    RequestResend( fw, "Line Number is not Last Line Number+1" );
+    return;
+  }
+  // Pretend every 37th line is garbled the first time
+  if ( number >= fw->corrupted.size() )
+    fw->corrupted.resize( number + 1, false );
+  if ( strtoul( line.c_str() + star + 1, NULL, 10 ) != cksum ||
+       ( fw->inject_errors && number % 37 == 0 && ! fw->corrupted[ number ] ) ) {
+    fw->corrupted[ number ] = true;
+    RequestResend( fw, "checksum mismatch" );
+    return;
+  }
+
+  fw->last_line = number;
+  size_t start = line.find( ' ' ) + 1;
+  fw->received.push_back( line.substr( start, star - start ) );
+  if ( number % 50 == 0 )
+    Reply( fw, "T:200.0 /200.0 B:60.0 /60.0\n" ); // unrelated output
+  Reply( fw, "ok\n" );
+}
+
+static void *FirmwareMain( void *arg ) {
+  Firmware *fw = ( Firmware * ) arg;
+  string input;
+  char block[ 256 ];
+
+  while ( ! fw->quit ) {
+    // Receive everything the host has sent
+    while ( ! fw->replies.empty() && fw->replies.front().first <= Now() ) {
+      Write( fw->fd, fw->replies.front().second.c_str() );
+      fw->replies.pop_front();
+    }
+
+    struct timeval timeout = { 0, 100 };
+    fd_set set;
+    FD_ZERO( &set );
+    FD_SET( fw->fd, &set );
+    if ( select( fw->fd + 1, &set, NULL, NULL, &timeout ) > 0 ) {
+      ssize_t num = read( fw->fd, block, sizeof( block ) );
+      if ( num > 0 )
+	input.append( block, num );
+    }
+    if ( input.length() > fw->max_pending )
+      fw->max_pending = input.length();
+
+    // Process one line
+    size_t end = input.find( '\n' );
+    if ( end != string::npos ) {
+      ntime_t nts = { 0, 50 * 1000 };
+      nsleep( &nts );
+      string line = input.substr( 0, end );
+      input.erase( 0, end + 1 );
+      HandleLine( fw, line );
+    }
+  }
+  return NULL;
+}
+
+static void *LogReader( void *arg ) {
+  ThreadedPrinterSerial *tps = ( ThreadedPrinterSerial * ) arg;
+  while ( 1 ) {
+    string str = tps->ReadErrorLog( true );
+    if ( str.length() > 0 )
+      cerr << str;
+  }
+  return NULL;
+}
+
+// Print gcode, returns the number of errors
+static int RunPrint( const string &gcode, const vector<string> &expected,
+		     bool stream, unsigned long buffer_size ) {
+  int master = posix_openpt( O_RDWR | O_NOCTTY );
+  if ( master < 0 || grantpt( master ) != 0 || unlockpt( master ) != 0 ) {
+    cerr << "Cannot open pseudo terminal" << endl;
+    return 1;
+  }
+
+  Firmware fw;
+  fw.fd = master;
+  fw.buffer_size = buffer_size;
+  fw.last_line = 0;
+  fw.max_pending = 0;
+  fw.resends = 0;
+  fw.quit = false;
+  // Sending one line per "ok" takes the "ok" after "Resend:" for the
+  // resent line, so it only gets a clean line
+  fw.inject_errors = stream;
+
+  ThreadedPrinterSerial tps;
+  thread_t log_reader;
+  thread_create( &log_reader, LogReader, &tps );
+  tps.SetStreaming( stream, buffer_size );
+  if ( ! tps.Connect( ptsname( master ), 115200 ) ) {
+    cerr << "Cannot connect to " << ptsname( master ) << endl;
+    return 1;
+  }
+  Write( master, "start\n" );
+  thread_t firmware;
+  thread_create( &firmware, FirmwareMain, &fw );
+
+  struct timeval start, stop;
+  gettimeofday( &start, NULL );
+  tps.StartPrinting( gcode );
+  while ( tps.IsPrinting() ) {
+    ntime_t nts = { 0, 10 * 1000 * 1000 };
+    nsleep( &nts );
+  }
+  // Answered after all printed lines are acknowledged
+  tps.SendAndWaitResponse( "M400" );
+  gettimeofday( &stop, NULL );
+  double seconds = ( stop.tv_sec - start.tv_sec ) + ( stop.tv_usec - start.tv_usec ) / 1e6;
+
+  tps.Disconnect();
+  fw.quit = true;
+  thread_join( firmware );
+  close( master );
+
+  int errors = 0;
+  // M115 first, M400 last
+  if ( fw.received.size() != expected.size() + 2 ) {
+    cerr << "Received " << fw.received.size() << " commands, expected "
+	 << expected.size() + 2 << endl;
+    errors++;
+  }
+  for ( size_t i = 0; i < expected.size() && i + 1 < fw.received.size(); i++ )
+    if ( fw.received[ i + 1 ] != expected[ i ] ) {
+      cerr << "Command " << i << " is '" << fw.received[ i + 1 ]
+	   << "', expected '" << expected[ i ] << "'" << endl;
+      errors++;
+      break;
+    }
+  if ( stream && fw.max_pending > buffer_size ) {
+    cerr << "Host had " << fw.max_pending << " bytes in flight, buffer is "
+	 << buffer_size << endl;
+    errors++;
+  }
+
+  cout << ( stream ? "streaming:   " : "ok per line: " )
+       << expected.size() << " lines in " << seconds << " s, "
+       << fw.resends << " resend requests, at most "
+       << fw.max_pending << " bytes in flight" << endl;
+  return errors;
+}
+
+int main( int argc, char *argv[] ) {
+  unsigned long lines = argc > 1 ? strtoul( argv[ 1 ], NULL, 10 ) : 2000;
+  unsigned long buffer_size = argc > 2 ? strtoul( argv[ 2 ], NULL, 10 ) : 127;
+
+  // Short moves like arcs, with comments and blank lines
+  ostringstream gcode;
+  vector<string> expected;
+  for ( unsigned long i = 0; i < lines; i++ ) {
+    ostringstream cmd;
+    cmd << "G1 X" << i % 100 << "." << i % 7 << " Y" << i % 33 << " E" << i / 10.;
+    expected.push_back( cmd.str() );
+    gcode << cmd.str();
+    if ( i % 10 == 0 )
+      gcode << " ; comment";
+    gcode << "\n";
+    if ( i % 25 == 0 )
+      gcode << "\n; comment line\n";
+  }
+
+  int errors = RunPrint( gcode.str(), expected, false, buffer_size );
+  errors += RunPrint( gcode.str(), expected, true, buffer_size );
+
+  cout << ( errors == 0 ? "PASS" : "FAIL" ) << endl;
+  return errors == 0 ? 0 : 1;
+}
@@ -0,0 +1,232 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "stdafx.h"
+#include "profile.h"
+#include "slicer/clipping.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace std;
+
+// upper bounds of the layer time histogram, in seconds
+static const double LAYER_BINS[] = { 1e-4, 3e-4, 1e-3, 3e-3, 1e-2, 3e-2,
+				     1e-1, 3e-1, 1, 3 };
+static const int NUM_LAYER_BINS = sizeof(LAYER_BINS)/sizeof(LAYER_BINS[0]);
+
+SliceProfile::SliceProfile()
+{
+#ifdef _OPENMP
+  threads = omp_get_max_threads();
+#else
+  threads = 1;
+#endif
+  start();
+}
+
+double SliceProfile::now()
+{
+  return g_get_monotonic_time() / 1e6;
+}
+
+double SliceProfile::cpu_now()
+{
+#ifdef WIN32
+  FILETIME creation, exit, kernel, user;
+  if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user))
+    return 0;
+  ULARGE_INTEGER k, u;
+  k.LowPart = kernel.dwLowDateTime; k.HighPart = kernel.dwHighDateTime;
+  u.LowPart = user.dwLowDateTime;   u.HighPart = user.dwHighDateTime;
+  return (k.QuadPart + u.QuadPart) / 1e7;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return 0;
+  return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+    + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+#endif
+}
+
+// kilobytes, -1 if unknown
+static long peak_rss()
+{
+#ifdef WIN32
+  return -1;
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0)
+    return -1;
+#ifdef __APPLE__
+  return usage.ru_maxrss / 1024; // bytes there
+#else
+  return usage.ru_maxrss;
+#endif
+#endif
+}
+
+void SliceProfile::start()
+{
+  steps.clear();
+  layer_times.clear();
+  run_wall = step_wall = now();
+  run_cpu  = step_cpu  = cpu_now();
+  step_calls = Clipping::getCallCount();
+  step_offsets = Clipping::getOffsetCount();
+}
+
+void SliceProfile::step_done(const string &name)
+{
+  Step step;
+  step.name = name;
+  const double wall = now(), cpu = cpu_now();
+  const unsigned long calls = Clipping::getCallCount(),
+    offsets = Clipping::getOffsetCount();
+  step.wall = wall - step_wall;
+  step.cpu  = cpu  - step_cpu;
+  step.clipper_calls = calls - step_calls;
+  step.clipper_offsets = offsets - step_offsets;
+  step.layer_times.swap(layer_times);
+  steps.push_back(step);
+
+  step_wall  = wall;
+  step_cpu   = cpu;
+  step_calls = calls;
+  step_offsets = offsets;
+}
+
+string SliceProfile::summary() const
+{
+  ostringstream out;
+  out.precision(3);
+  for (uint s = 0; s < steps.size(); s++)
+    out << (s > 0 ? ", " : "") << steps[s].name << " " << steps[s].wall << " s";
+  return out.str();
+}
+
+void SliceProfile::set_layers(unsigned int count)
+{
+  layer_times.assign(count, 0);
+}
+
+void SliceProfile::layer_done(unsigned int layer, double seconds)
+{
+  if (layer < layer_times.size())
+    layer_times[layer] += seconds;
+}
+
+// utilization is named for what it covers, it is not per parallel region
+static void write_times(ostream &out, const char *indent,
+			double wall, double cpu, int threads,
+			const char *utilization)
+{
+  out << indent << "\"wall\": " << wall << ",\n"
+      << indent << "\"cpu\": " << cpu << ",\n"
+      << indent << "\"" << utilization << "\": "
+      << (wall > 0 ? cpu / wall / threads : 0);
+}
+
+static string json_string(const string &str)
+{
+  string quoted = "\"";
+  for (uint i = 0; i < str.length(); i++) {
+    if (str[i] == '"' || str[i] == '\\')
+      quoted += '\\';
+    quoted += str[i];
+  }
+  return quoted + "\"";
+}
+
+string SliceProfile::json() const
+{
+  ostringstream out;
+  out.precision(6);
+  double wall = 0, cpu = 0;
+  unsigned long calls = 0, offsets = 0;
+  for (uint s = 0; s < steps.size(); s++) {
+    wall    += steps[s].wall;
+    cpu     += steps[s].cpu;
+    calls   += steps[s].clipper_calls;
+    offsets += steps[s].clipper_offsets;
+  }
+  const long rss = peak_rss();
+  out << "{\n"
+      << "  \"threads\": " << threads << ",\n";
+  write_times(out, "  ", wall, cpu, threads, "run_utilization");
+  out << ",\n"
+      << "  \"clipper_calls\": " << calls << ",\n"
+      << "  \"clipper_offsets\": " << offsets << ",\n"
+      << "  \"peak_rss_kb\": ";
+  if (rss < 0) out << "null"; else out << rss;
+  out << ",\n"
+      << "  \"layer_bins\": [";
+  for (int b = 0; b < NUM_LAYER_BINS; b++)
+    out << (b > 0 ? ", " : "") << LAYER_BINS[b];
+  out << "],\n"
+      << "  \"steps\": [";
+  for (uint s = 0; s < steps.size(); s++) {
+    const Step &step = steps[s];
+    out << (s > 0 ? "," : "") << "\n    {\n"
+	<< "      \"name\": " << json_string(step.name) << ",\n";
+    write_times(out, "      ", step.wall, step.cpu, threads, "step_utilization");
+    out << ",\n"
+	<< "      \"clipper_calls\": " << step.clipper_calls << ",\n"
+	<< "      \"clipper_offsets\": " << step.clipper_offsets;
+    if (!step.layer_times.empty()) {
+      vector<double> sorted = step.layer_times;
+      std::sort(sorted.begin(), sorted.end());
+      double sum = 0;
+      for (uint l = 0; l < sorted.size(); l++)
+	sum += sorted[l];
+      // layers per bin, the last for all longer ones
+      vector<uint> counts(NUM_LAYER_BINS + 1, 0);
+      for (uint l = 0; l < sorted.size(); l++)
+	counts[std::lower_bound(LAYER_BINS, LAYER_BINS + NUM_LAYER_BINS, sorted[l])
+	       - LAYER_BINS]++;
+      out << ",\n"
+	  << "      \"layers\": {\n"
+	  << "        \"count\": " << sorted.size() << ",\n"
+	  << "        \"sum\": " << sum << ",\n"
+	  << "        \"min\": " << sorted.front() << ",\n"
+	  << "        \"median\": " << sorted[sorted.size()/2] << ",\n"
+	  << "        \"max\": " << sorted.back() << ",\n"
+	  << "        \"histogram\": [";
+      for (uint b = 0; b < counts.size(); b++)
+	out << (b > 0 ? ", " : "") << counts[b];
+      out << "]\n"
+	  << "      }";
+    }
+    out << "\n    }";
+  }
+  out << "\n  ]\n"
+      << "}\n";
+  return out.str();
+}
@@ -0,0 +1,75 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Times the steps of a slicing run: wall and CPU time, the time spent
+// on every layer, clipper executions and how busy the threads were.
+// CPU time is that of the whole process, so CPU time over wall time and
+// thread count tells how well a step's parallel loops were used, for
+// each step as a whole, not for each parallel region in it.
+class SliceProfile
+{
+public:
+  SliceProfile();
+
+  void start(); // forget the last run, the first step begins
+  void step_done(const std::string &name); // the running step ends
+
+  // The running step works on count layers; layer_done() adds the time
+  // of a layer and may be called by different threads for different
+  // layers at once.
+  void set_layers(unsigned int count);
+  void layer_done(unsigned int layer, double seconds);
+
+  std::string json() const;
+  std::string summary() const; // the wall time of each step, one line
+
+  static double now();     // seconds, monotonic
+  static double cpu_now(); // seconds of process CPU time
+
+private:
+  struct Step {
+    std::string name;
+    double wall, cpu;
+    unsigned long clipper_calls, clipper_offsets;
+    std::vector<double> layer_times;
+  };
+  std::vector<Step> steps;
+
+  double run_wall, run_cpu;  // at start()
+  double step_wall, step_cpu; // when the running step began
+  unsigned long step_calls, step_offsets;
+  std::vector<double> layer_times; // of the running step
+  int threads;
+};
+
+// adds the time from construction to destruction to a layer
+class LayerTimer
+{
+  SliceProfile &profile;
+  unsigned int layer;
+  double start;
+public:
+  LayerTimer(SliceProfile &profile, unsigned int layer)
+    : profile(profile), layer(layer), start(SliceProfile::now()) {};
+  ~LayerTimer() { profile.layer_done(layer, SliceProfile::now() - start); };
+};
@@ -111,6 +111,7 @@ Render::~Render()
 void Render::set_model(Model *model)
 {
   model->signal_zoom().connect (sigc::mem_fun(*this, &Render::zoom_to_model));
+  model->signal_preview_ready().connect (sigc::mem_fun(*this, &Render::queue_draw));
   zoom_to_model();
 }
 
@@ -203,6 +204,17 @@ void Render::on_realize()
 }
 
 
+void Render::on_unrealize()
+{
+  // buffers of renderers cleared since the last frame
+  Glib::RefPtr<Gdk::GL::Drawable> gldrawable = get_gl_drawable();
+  if (gldrawable && gldrawable->gl_begin(get_gl_context())) {
+    Platform::deleteUnusedGLBuffers();
+    gldrawable->gl_end();
+  }
+  Gtk::GL::DrawingArea::on_unrealize();
+}
+
 bool Render::on_configure_event(GdkEventConfigure* event)
 {
   Glib::RefPtr<Gdk::GL::Drawable> gldrawable = get_gl_drawable();
@@ -261,6 +273,8 @@ bool Render::on_expose_event(GdkEventExpose* event)
   if (!gldrawable || !gldrawable->gl_begin(get_gl_context()))
     return false;
 
+  Platform::deleteUnusedGLBuffers();
+
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
   glLoadIdentity();
   glTranslatef (0.0, 0.0, -2.0 * m_zoom);
@@ -63,6 +63,7 @@ class Render : public Gtk::GL::DrawingArea
   static void draw_string(const Vector3d &pos, const string s);
 
   virtual void on_realize();
+  virtual void on_unrealize();
   virtual bool on_configure_event(GdkEventConfigure* event);
   virtual bool on_expose_event(GdkEventExpose* event);
   virtual bool on_motion_notify_event(GdkEventMotion* event);
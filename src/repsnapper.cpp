@@ -45,6 +45,7 @@ public:
 	string printerdevice_path;
   string svg_output_path;
   bool svg_single_output;
+	string profile_path;
 	std::vector<std::string> files;
 private:
 	void init ()
@@ -72,6 +73,8 @@ private:
 			     "  --svg [file]           slice to SVG file\n"
 			     "  --ssvg [file]          slice to single layer SVG files [file]NNNN.svg\n"
 			     "  -s, --settings [file]  read render settings [file]\n"
+			     "  --profile [file]       with -t and -o, write the slicing\n"
+			     "                         step timings as JSON to [file]\n"
 			     "  -h, --help             show this help\n"
 			     "\n"
 			     "Report bugs to #repsnapper, irc.freenode.net\n\n"));
@@ -117,6 +120,8 @@ public:
 				svg_output_path = argv[++i];
 				svg_single_output = true;
 			}
+			else if (param && !strcmp (arg, "--profile"))
+				profile_path = argv[++i];
 			else if (!strcmp (arg, "--version") || !strcmp (arg, "-v"))
 				version();
 			else
@@ -284,6 +289,13 @@ int main(int argc, char **argv)
       if (opts.gcode_output_path.size() > 0) {
 	model->ConvertToGCode();
         model->WriteGCode(Gio::File::create_for_path(opts.gcode_output_path));
+	if (opts.profile_path.size() > 0) {
+	  try {
+	    Glib::file_set_contents(opts.profile_path, model->profile.json());
+	  } catch (Glib::FileError &e) {
+	    cerr << e.what() << endl;
+	  }
+	}
       }
       else if (opts.svg_output_path.size() > 0) {
 	model->SliceToSVG(Gio::File::create_for_path(opts.svg_output_path),
@@ -800,6 +800,125 @@ Vector3d Settings::get_extruder_offset(uint num) const
 }
 
 
+//////////////////////////////// SliceParams ////////////////////////////////
+
+void SliceParams::ExtruderParams::read(const Settings &settings, const string &group)
+{
+  OffsetX                    = settings.get_double(group,"OffsetX");
+  OffsetY                    = settings.get_double(group,"OffsetY");
+  MaxLineSpeed               = settings.get_double(group,"MaxLineSpeed");
+  MaxShellSpeed              = settings.get_double(group,"MaxShellSpeed");
+  ZliftAlways                = settings.get_boolean(group,"ZliftAlways");
+  EnableAntiooze             = settings.get_boolean(group,"EnableAntiooze");
+  AntioozeDistance           = settings.get_double(group,"AntioozeDistance");
+  AntioozeAmount             = settings.get_double(group,"AntioozeAmount");
+  AntioozeSpeed              = settings.get_double(group,"AntioozeSpeed");
+  AntioozeZlift              = settings.get_double(group,"AntioozeZlift");
+  MinimumLineWidth           = settings.get_double(group,"MinimumLineWidth");
+  MaximumLineWidth           = settings.get_double(group,"MaximumLineWidth");
+  ExtrudedMaterialWidthRatio = settings.get_double(group,"ExtrudedMaterialWidthRatio");
+  ExtrusionFactor            = settings.get_double(group,"ExtrusionFactor");
+  CalibrateInput             = settings.get_boolean(group,"CalibrateInput");
+  FilamentDiameter           = settings.get_double(group,"FilamentDiameter");
+}
+
+// same as the Settings methods
+double SliceParams::ExtruderParams::GetExtrudedMaterialWidth(double layerheight) const
+{
+  return min(max(MinimumLineWidth, ExtrudedMaterialWidthRatio * layerheight),
+	     MaximumLineWidth);
+}
+
+double SliceParams::ExtruderParams::GetExtrusionPerMM(double layerheight) const
+{
+  double f = ExtrusionFactor;
+  if (CalibrateInput) {
+    const double matWidth = GetExtrudedMaterialWidth(layerheight);
+    f *= (matWidth * matWidth) / (FilamentDiameter * FilamentDiameter);
+  }
+  return f;
+}
+
+SliceParams::SliceParams(const Settings &settings)
+{
+  Slicing.DoInfill              = settings.get_boolean("Slicing","DoInfill");
+  Slicing.InfillPercent         = settings.get_double ("Slicing","InfillPercent");
+  Slicing.AltInfillPercent      = settings.get_double ("Slicing","AltInfillPercent");
+  Slicing.AltInfillLayers       = settings.get_integer("Slicing","AltInfillLayers");
+  Slicing.FirstLayersNum        = settings.get_integer("Slicing","FirstLayersNum");
+  Slicing.FirstLayersInfillDist = settings.get_double ("Slicing","FirstLayersInfillDist");
+  Slicing.FirstLayersSpeed      = settings.get_double ("Slicing","FirstLayersSpeed");
+  Slicing.NormalFillExtrusion   = settings.get_double ("Slicing","NormalFillExtrusion");
+  Slicing.FullFillExtrusion     = settings.get_double ("Slicing","FullFillExtrusion");
+  Slicing.SupportExtrusion      = settings.get_double ("Slicing","SupportExtrusion");
+  Slicing.BridgeExtrusion       = settings.get_double ("Slicing","BridgeExtrusion");
+  Slicing.InfillRotation        = settings.get_double ("Slicing","InfillRotation");
+  Slicing.InfillRotationPrLayer = settings.get_double ("Slicing","InfillRotationPrLayer");
+  Slicing.NormalFilltype        = settings.get_integer("Slicing","NormalFilltype");
+  Slicing.FullFilltype          = settings.get_integer("Slicing","FullFilltype");
+  Slicing.DecorFilltype         = settings.get_integer("Slicing","DecorFilltype");
+  Slicing.SupportFilltype       = settings.get_integer("Slicing","SupportFilltype");
+  Slicing.FillSkirt             = settings.get_boolean("Slicing","FillSkirt");
+  Slicing.DecorInfillDistance   = settings.get_double ("Slicing","DecorInfillDistance");
+  Slicing.DecorInfillRotation   = settings.get_double ("Slicing","DecorInfillRotation");
+  Slicing.SupportInfillDistance = settings.get_double ("Slicing","SupportInfillDistance");
+  Slicing.ShellOffset           = settings.get_double ("Slicing","ShellOffset");
+  Slicing.InfillOverlap         = settings.get_double ("Slicing","InfillOverlap");
+  Slicing.ShellCount            = settings.get_integer("Slicing","ShellCount");
+  Slicing.CornerRadius          = settings.get_double ("Slicing","CornerRadius");
+  Slicing.MoveNearest           = settings.get_boolean("Slicing","MoveNearest");
+  Slicing.MinShelltime          = settings.get_double ("Slicing","MinShelltime");
+  Slicing.MinLayertime          = settings.get_double ("Slicing","MinLayertime");
+  Slicing.FanControl            = settings.get_boolean("Slicing","FanControl");
+  Slicing.MinFanSpeed           = settings.get_integer("Slicing","MinFanSpeed");
+  Slicing.MaxFanSpeed           = settings.get_integer("Slicing","MaxFanSpeed");
+  Slicing.MaxOverhangSpeed      = settings.get_double ("Slicing","MaxOverhangSpeed");
+  Slicing.MinArcLength          = settings.get_double ("Slicing","MinArcLength");
+  Slicing.ArcsMaxAngle          = settings.get_double ("Slicing","ArcsMaxAngle");
+  Slicing.UseArcs               = settings.get_boolean("Slicing","UseArcs");
+  Slicing.RoundCorners          = settings.get_boolean("Slicing","RoundCorners");
+  Slicing.UseTCommand           = settings.get_boolean("Slicing","UseTCommand");
+  Slicing.RelativeEcode         = settings.get_boolean("Slicing","RelativeEcode");
+  Slicing.FarthestLayerStart    = settings.get_boolean("Slicing","FarthestLayerStart");
+  Slicing.PlanLayersParallel    = false;
+  try { // not in older config files
+    Slicing.PlanLayersParallel  = settings.get_boolean("Slicing","PlanLayersParallel");
+  } catch (const Glib::KeyFileError &err) {
+  }
+  Slicing.PipelineLayers        = false;
+  try { // not in older config files
+    Slicing.PipelineLayers      = settings.get_boolean("Slicing","PipelineLayers");
+  } catch (const Glib::KeyFileError &err) {
+  }
+
+  Hardware.MinMoveSpeedXY = settings.get_double("Hardware","MinMoveSpeedXY");
+  Hardware.MaxMoveSpeedXY = settings.get_double("Hardware","MaxMoveSpeedXY");
+  Hardware.MinMoveSpeedZ  = settings.get_double("Hardware","MinMoveSpeedZ");
+  Hardware.MaxMoveSpeedZ  = settings.get_double("Hardware","MaxMoveSpeedZ");
+
+  Extruder.read(settings, "Extruder");
+  const uint num = settings.getNumExtruders();
+  Extruders.resize(num);
+  for (uint i = 0; i < num; i++)
+    Extruders[i].read(settings, settings.numberedExtruder("Extruder",i));
+  selectedExtruder = settings.selectedExtruder;
+  supportExtruder  = settings.GetSupportExtruder();
+}
+
+const SliceParams::ExtruderParams &SliceParams::getExtruder(int num) const
+{
+  if (num < 0 || num >= (int)Extruders.size()) return Extruder;
+  return Extruders[num];
+}
+
+double SliceParams::GetInfillDistance(double layerthickness, float percent) const
+{
+  double fullInfillDistance = GetExtrudedMaterialWidth(layerthickness);
+  if (percent == 0) return 10000000;
+  return fullInfillDistance * (100./percent);
+}
+
+
 void Settings::copyGroup(const string &from, const string &to)
 {
   vector<string> keys = get_keys(from);
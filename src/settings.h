@@ -155,3 +155,77 @@ class Settings : public Glib::KeyFile {
   sigc::signal< void > m_signal_core_settings_changed;
 };
 
+
+
+// Typed copy of the settings used while slicing and making lines,
+// taken once per run. The hot loops read plain members instead of
+// looking up and parsing KeyFile strings, and the GUI can keep editing
+// the Settings meanwhile.
+struct SliceParams
+{
+  struct ExtruderParams {
+    double OffsetX, OffsetY;
+    double MaxLineSpeed, MaxShellSpeed;
+    bool   ZliftAlways;
+    bool   EnableAntiooze;
+    double AntioozeDistance, AntioozeAmount, AntioozeSpeed, AntioozeZlift;
+    double MinimumLineWidth, MaximumLineWidth, ExtrudedMaterialWidthRatio;
+    double ExtrusionFactor;
+    bool   CalibrateInput;
+    double FilamentDiameter;
+
+    void read(const Settings &settings, const string &group);
+    double GetExtrudedMaterialWidth(double layerheight) const;
+    double GetExtrusionPerMM(double layerheight) const;
+  };
+
+  struct {
+    bool   DoInfill;
+    double InfillPercent, AltInfillPercent;
+    int    AltInfillLayers;
+    int    FirstLayersNum;
+    double FirstLayersInfillDist, FirstLayersSpeed;
+    double NormalFillExtrusion, FullFillExtrusion;
+    double SupportExtrusion, BridgeExtrusion;
+    double InfillRotation, InfillRotationPrLayer;
+    int    NormalFilltype, FullFilltype, DecorFilltype, SupportFilltype;
+    bool   FillSkirt;
+    double DecorInfillDistance, DecorInfillRotation;
+    double SupportInfillDistance;
+    double ShellOffset, InfillOverlap;
+    int    ShellCount;
+    double CornerRadius;
+    bool   MoveNearest;
+    double MinShelltime, MinLayertime;
+    bool   FanControl;
+    int    MinFanSpeed, MaxFanSpeed;
+    double MaxOverhangSpeed;
+    double MinArcLength, ArcsMaxAngle;
+    bool   UseArcs, RoundCorners;
+    bool   UseTCommand, RelativeEcode;
+    bool   FarthestLayerStart;
+    bool   PlanLayersParallel;
+    bool   PipelineLayers;
+  } Slicing;
+
+  struct {
+    double MinMoveSpeedXY, MaxMoveSpeedXY;
+    double MinMoveSpeedZ,  MaxMoveSpeedZ;
+  } Hardware;
+
+  ExtruderParams Extruder;          // the selected "Extruder" group
+  vector<ExtruderParams> Extruders; // the numbered groups
+  uint selectedExtruder;
+  uint supportExtruder;
+
+  SliceParams(const Settings &settings);
+
+  // numbered extruder, the selected one for num < 0
+  const ExtruderParams &getExtruder(int num) const;
+
+  double GetExtrudedMaterialWidth(double layerheight) const
+  { return Extruder.GetExtrudedMaterialWidth(layerheight); };
+  double GetExtrusionPerMM(double layerheight) const
+  { return Extruder.GetExtrusionPerMM(layerheight); };
+  double GetInfillDistance(double layerthickness, float percent) const;
+};
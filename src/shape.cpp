@@ -25,13 +25,17 @@
 #include "clipping.h"
 #include "render.h"
 
+#include <atomic>
+
 #ifdef _OPENMP
 #include <omp.h>
 #endif
 
+static std::atomic<unsigned long> shape_revisions(0);
+
 // Constructor
 Shape::Shape()
-  : slow_drawing(false), gl_List(-1)
+  : slow_drawing(false), legacy_slicing(false), revision(++shape_revisions)
 {
   Min.set(0,0,0);
   Max.set(200,200,200);
@@ -39,15 +43,14 @@ Shape::Shape()
 }
 
 void Shape::clear() {
-  triangles.clear();
-  if (gl_List>=0)
-    glDeleteLists(gl_List,1);
-  gl_List = -1;
+  mesh.clear();
+  meshChanged();
 };
 
 void Shape::setTriangles(const vector<Triangle> &triangles_)
 {
-  triangles = triangles_;
+  mesh.build(triangles_);
+  meshChanged();
 
   CalcBBox();
   double vol = volume();
@@ -58,13 +61,13 @@ void Shape::setTriangles(const vector<Triangle> &triangles_)
 
   //PlaceOnPlatform();
   cerr << _("Shape has volume ") << volume() << _(" mm^3 and ")
-       << triangles.size() << _(" triangles") << endl;
+       << mesh.numTriangles() << _(" triangles") << endl;
 }
 
 
 int Shape::saveBinarySTL(Glib::ustring filename) const
 {
-  if (!File::saveBinarySTL(filename, triangles, transform3D.transform))
+  if (!File::saveBinarySTL(filename, mesh.getTriangles(), transform3D.transform))
     return -1;
   return 0;
 
@@ -73,13 +76,13 @@ int Shape::saveBinarySTL(Glib::ustring filename) const
 bool Shape::hasAdjacentTriangleTo(const Triangle &triangle, double sqdistance) const
 {
   bool haveadj = false;
-  int count = (int)triangles.size();
+  int count = (int)mesh.numTriangles();
 #ifdef _OPENMP
 #pragma omp parallel for schedule(dynamic)
 #endif
   for (int i = 0; i < count; i++)
     if (!haveadj)
-      if (triangle.isConnectedTo(triangles[i],sqdistance)) {
+      if (triangle.isConnectedTo(mesh.triangle(i),sqdistance)) {
 	haveadj = true;
     }
   return haveadj;
@@ -104,6 +107,7 @@ void addtoshape(uint i, const vector< vector<uint> > &adj,
 
 void Shape::splitshapes(vector<Shape*> &shapes, ViewProgress *progress)
 {
+  const vector<Triangle> triangles = mesh.getTriangles();
   int n_tr = (int)triangles.size();
   if (progress) progress->start(_("Split Shapes"), n_tr);
   int progress_steps = max(1,(int)(n_tr/100));
@@ -161,9 +165,10 @@ void Shape::splitshapes(vector<Shape*> &shapes, ViewProgress *progress)
       addtoshape(i, adj, current, done);
       Shape *shape = new Shape();
       shapes.push_back(shape);
-      shapes.back()->triangles.resize(current.size());
+      vector<Triangle> tr(current.size());
       for (uint i = 0; i < current.size(); i++)
-	shapes.back()->triangles[i] = triangles[current[i]];
+	tr[i] = triangles[current[i]];
+      shapes.back()->mesh.build(tr);
       shapes.back()->CalcBBox();
     }
     if (!cont) i=n_tr;
@@ -205,20 +210,19 @@ void Shape::makeHollow(double wallthickness)
   invertNormals();
   const Vector3d wall(wallthickness,wallthickness,wallthickness);
   Matrix4d invT = transform3D.getInverse();
-  vector<Triangle> cubet = cube(invT*Min-wall, invT*Max+wall);
-  triangles.insert(triangles.end(),cubet.begin(),cubet.end());
-  CalcBBox();
+  addTriangles(cube(invT*Min-wall, invT*Max+wall));
 }
 
 void Shape::invertNormals()
 {
-  for (uint i = 0; i < triangles.size(); i++)
-    triangles[i].invertNormal();
+  mesh.invert();
+  meshChanged();
 }
 
 // doesn't work
 void Shape::repairNormals(double sqdistance)
 {
+  vector<Triangle> triangles = mesh.getTriangles();
   for (uint i = 0; i < triangles.size(); i++) {
     vector<uint> adjacent;
     uint numadj=0, numwrong=0;
@@ -236,21 +240,23 @@ void Shape::repairNormals(double sqdistance)
     //cerr << i<< ": " << numadj << " - " << numwrong  << endl;
     //if (numwrong > numadj/2) triangles[i].invertNormal();
   }
+  mesh.build(triangles);
+  meshChanged();
 }
 
 void Shape::mirror()
 {
   const Vector3d mCenter = transform3D.getInverse() * Center;
-  for (uint i = 0; i < triangles.size(); i++)
-    triangles[i].mirrorX(mCenter);
+  mesh.mirrorX(mCenter);
+  meshChanged();
   CalcBBox();
 }
 
 double Shape::volume() const
 {
   double vol=0;
-  for (uint i = 0; i < triangles.size(); i++)
-    vol+=triangles[i].projectedvolume(transform3D.transform);
+  for (uint i = 0; i < mesh.numTriangles(); i++)
+    vol+=mesh.triangle(i).projectedvolume(transform3D.transform);
   return vol;
 }
 
@@ -258,23 +264,26 @@ string Shape::getSTLsolid() const
 {
   stringstream sstr;
   sstr << "solid " << filename <<endl;
-  for (uint i = 0; i < triangles.size(); i++)
-    sstr << triangles[i].getSTLfacet(transform3D.transform);
+  for (uint i = 0; i < mesh.numTriangles(); i++)
+    sstr << mesh.triangle(i).getSTLfacet(transform3D.transform);
   sstr << "endsolid " << filename <<endl;
   return sstr.str();
 }
 
 void Shape::addTriangles(const vector<Triangle> &tr)
 {
+  vector<Triangle> triangles = mesh.getTriangles();
   triangles.insert(triangles.end(), tr.begin(), tr.end());
+  mesh.build(triangles);
+  meshChanged();
   CalcBBox();
 }
 
 vector<Triangle> Shape::getTriangles(const Matrix4d &T) const
 {
-  vector<Triangle> tr(triangles.size());
-  for (uint i = 0; i < triangles.size(); i++) {
-    tr[i] = triangles[i].transformed(T*transform3D.transform);
+  vector<Triangle> tr(mesh.numTriangles());
+  for (uint i = 0; i < tr.size(); i++) {
+    tr[i] = mesh.triangle(i).transformed(T*transform3D.transform);
   }
   return tr;
 }
@@ -282,16 +291,41 @@ vector<Triangle> Shape::getTriangles(const Matrix4d &T) const
 
 vector<Triangle> Shape::trianglesSteeperThan(double angle) const
 {
-  vector<Triangle> tr;
-  for (uint i = 0; i < triangles.size(); i++) {
-    // negative angles are triangles facing downwards
-    const double tangle = -triangles[i].slopeAngle(transform3D.transform);
-    if (tangle >= angle)
-      tr.push_back(triangles[i]);
-  }
+  std::shared_ptr<const Overhangs> ov = getOverhangs(Matrix4d::IDENTITY, angle);
+  vector<Triangle> tr(ov->triangles.size());
+  for (uint i = 0; i < tr.size(); i++)
+    tr[i] = mesh.triangle(ov->triangles[i]);
   return tr;
 }
 
+// shared by drawing and slicing, rebuilt when the rotation, the scale
+// of one axis or the support angle changes
+std::shared_ptr<const Overhangs> Shape::getOverhangs(const Matrix4d &T,
+						     double angle) const
+{
+  const Matrix4d linear = Overhangs::linearPart(T * transform3D.transform);
+  std::shared_ptr<const Overhangs> ov;
+#ifdef _OPENMP
+#pragma omp critical(shapeMesh)
+#endif
+  {
+    if (!overhangs || overhangs->angle != angle || overhangs->linear != linear) {
+      Overhangs *newov = new Overhangs();
+      newov->build(mesh, linear, angle);
+      overhangs.reset(newov);
+    }
+    ov = overhangs;
+  }
+  return ov;
+}
+
+// in shape coordinates like draw()
+void Shape::drawOverhangs(const Matrix4d &T, double angle)
+{
+  std::shared_ptr<const Overhangs> ov = getOverhangs(T, angle);
+  renderer.drawSubset(mesh, ov->triangles, ov->serial);
+}
+
 
 void Shape::FitToVolume(const Vector3d &vol)
 {
@@ -336,13 +370,16 @@ void Shape::CalcBBox()
 {
   Min.set(INFTY,INFTY,INFTY);
   Max.set(-INFTY,-INFTY,-INFTY);
-  for(size_t i = 0; i < triangles.size(); i++) {
-    triangles[i].AccumulateMinMax (Min, Max, transform3D.transform);
+  // every vertex is a corner of some triangle
+  const vector<Vector3d> &vertices = mesh.getVertices();
+  for(size_t i = 0; i < vertices.size(); i++) {
+    const Vector3d v = transform3D.transform * vertices[i];
+    for (uint j = 0; j < 3; j++) {
+      Min[j] = min(v[j], Min[j]);
+      Max[j] = max(v[j], Max[j]);
+    }
   }
   Center = (Max + Min) / 2;
-  if (gl_List>=0)
-    glDeleteLists(gl_List,1);
-  gl_List = -1;
 }
 
 Vector3d Shape::scaledCenter() const
@@ -361,29 +398,30 @@ vector<Vector3d> Shape::getMostUsedNormals() const
   vector<struct SNorm> normals;
   // vector<Vector3d> normals;
   // vector<double> area;
-  uint ntr = triangles.size();
+  uint ntr = mesh.numTriangles();
   vector<bool> done(ntr);
   normals.reserve(ntr);
   for(size_t i=0;i<ntr;i++)
     {
+      const Triangle triangle = mesh.triangle(i);
+      const Vector3d normal = triangle.transformed(transform3D.transform).Normal;
       bool havenormal = false;
       int numnorm = normals.size();
 #ifdef _OPENMP
 #pragma omp parallel for schedule(dynamic)
 #endif
       for (int n = 0; n < numnorm; n++) {
-	if ( (normals[n].normal -
-	      triangles[i].transformed(transform3D.transform).Normal)
+	if ( (normals[n].normal - normal)
 	     .squared_length() < 0.000001) {
 	  havenormal = true;
-	  normals[n].area += triangles[i].area();
+	  normals[n].area += triangle.area();
 	  done[i] = true;
 	}
       }
       if (!havenormal){
 	SNorm n;
-	n.normal = triangles[i].transformed(transform3D.transform).Normal;
-	n.area = triangles[i].area();
+	n.normal = normal;
+	n.area = triangle.area();
 	normals.push_back(n);
 	done[i] = true;
       }
@@ -436,16 +474,17 @@ int Shape::divideAtZ(double z, Shape *upper, Shape *lower, const Matrix4d &T) co
   for (uint i=0; i<surfs.size(); i++)
     surf.insert(surf.end(), surfs[i].begin(), surfs[i].end());
 
-  lower->triangles.insert(lower->triangles.end(),surf.begin(),surf.end());
+  vector<Triangle> uppertr, lowertr;
+  lowertr.insert(lowertr.end(),surf.begin(),surf.end());
   for (guint i=0; i<surf.size(); i++) surf[i].invertNormal();
-  upper->triangles.insert(upper->triangles.end(),surf.begin(),surf.end());
+  uppertr.insert(uppertr.end(),surf.begin(),surf.end());
   vector<Triangle> toboth;
-  for (guint i=0; i< triangles.size(); i++) {
-    Triangle tt = triangles[i].transformed(T*transform3D.transform);
+  for (guint i=0; i< mesh.numTriangles(); i++) {
+    Triangle tt = mesh.triangle(i).transformed(T*transform3D.transform);
     if (tt.A.z() < z && tt.B.z() < z && tt.C.z() < z )
-      lower->triangles.push_back(tt);
+      lowertr.push_back(tt);
     else if (tt.A.z() > z && tt.B.z() > z && tt.C.z() > z )
-      upper->triangles.push_back(tt);
+      uppertr.push_back(tt);
     else
       toboth.push_back(tt);
   }
@@ -453,12 +492,12 @@ int Shape::divideAtZ(double z, Shape *upper, Shape *lower, const Matrix4d &T) co
   for (guint i=0; i< toboth.size(); i++) {
     toboth[i].SplitAtPlane(z, uppersplit, lowersplit);
   }
-  upper->triangles.insert(upper->triangles.end(),
-			 uppersplit.begin(),uppersplit.end());
-  lower->triangles.insert(lower->triangles.end(),
-			 lowersplit.begin(),lowersplit.end());
-  upper->CalcBBox();
-  lower->CalcBBox();
+  uppertr.insert(uppertr.end(),
+		 uppersplit.begin(),uppersplit.end());
+  lowertr.insert(lowertr.end(),
+		 lowersplit.begin(),lowersplit.end());
+  upper->addTriangles(uppertr);
+  lower->addTriangles(lowertr);
   lower->Rotate(Vector3d(0,1,0),M_PI);
   upper->move(Vector3d(10+Max.x()-Min.x(),0,0));
   lower->move(Vector3d(2*(10+Max.x()-Min.x()),0,0));
@@ -497,6 +536,7 @@ void Shape::Twist(double angle)
   double h = Max.z()-Min.z();
   double hangle=0;
   Vector3d axis(0,0,1);
+  vector<Triangle> triangles = mesh.getTriangles();
   int count = (int)triangles.size();
 #ifdef _OPENMP
 #pragma omp parallel for schedule(dynamic)
@@ -509,6 +549,8 @@ void Shape::Twist(double angle)
       }
     triangles[i].calcNormal();
   }
+  mesh.build(triangles);
+  meshChanged();
   CalcBBox();
 }
 
@@ -609,8 +651,15 @@ bool Shape::getPolygonsAtZ(const Matrix4d &T, double z,
 			   double max_supportangle,
 			   double thickness) const
 {
-  vector<Vector2d> vertices;
   vector<Triangle> support_triangles;
+  // closed meshes are cut by edge topology, anything else
+  // by matching and repairing cut point coordinates
+  if (!legacy_slicing && mesh.isClosed()) {
+    if (!getMeshPolygonsAtZ(T, z, polys, max_gradient,
+			    support_triangles, max_supportangle, thickness))
+      return false;
+  } else {
+  vector<Vector2d> vertices;
   vector<Segment> lines = getCutlines(T, z, vertices, max_gradient,
 				      support_triangles, max_supportangle, thickness);
   //cerr << vertices.size() << " " << lines.size() << endl;
@@ -632,6 +681,7 @@ bool Shape::getPolygonsAtZ(const Matrix4d &T, double z,
     poly.calcHole();
     polys.push_back(poly);
   }
+  }
 
   for (uint i = 0; i < support_triangles.size(); i++) {
     Poly p(z);
@@ -689,6 +739,116 @@ bool Shape::getPolygonsAtZ(const Matrix4d &T, double z,
 }
 
 
+void Shape::meshChanged()
+{
+  revision = ++shape_revisions;
+  renderer.clear();
+#ifdef _OPENMP
+#pragma omp critical(shapeMesh)
+#endif
+  {
+    transformed_mesh.reset();
+    sweep.reset();
+    overhangs.reset();
+  }
+}
+
+void Shape::beginSweep(const Matrix4d &T)
+{
+  if (legacy_slicing || !mesh.isClosed()) return;
+  const Matrix4d transform = T * transform3D.transform;
+  sweep.reset(new MeshSweep(mesh, getTransformedMesh(transform)));
+}
+
+void Shape::endSweep()
+{
+  sweep.reset();
+}
+
+Shape *Shape::clone() const
+{
+  Shape *shape = new Shape(*this);
+  shape->endSweep();
+  return shape;
+}
+
+// rebuilt whenever sliced with another transform
+std::shared_ptr<const TransformedMesh> Shape::getTransformedMesh(const Matrix4d &T) const
+{
+  std::shared_ptr<const TransformedMesh> tm;
+#ifdef _OPENMP
+#pragma omp critical(shapeMesh)
+#endif
+  {
+    if (!transformed_mesh || transformed_mesh->transform != T) {
+      TransformedMesh *newtm = new TransformedMesh();
+      newtm->build(mesh, T);
+      transformed_mesh.reset(newtm);
+    }
+    tm = transformed_mesh;
+  }
+  return tm;
+}
+
+bool Shape::getMeshPolygonsAtZ(const Matrix4d &T, double z,
+			       vector<Poly> &polys, double &max_gradient,
+			       vector<Triangle> &support_triangles,
+			       double supportangle, double thickness) const
+{
+  // we know our own tranform:
+  const Matrix4d transform = T * transform3D.transform;
+  std::shared_ptr<const TransformedMesh> tm = getTransformedMesh(transform);
+  const VertexArray &tvertices = tm->vertices;
+
+  vector< vector<Vector2d> > loops;
+  vector<uint> cut_triangles;
+  if (sweep && sweep->getTransform() == transform && z >= sweep->getZ()) {
+    if (!sweep->cutAtZ(z, loops, cut_triangles)) return false;
+  } else {
+    vector<uint> candidates;
+    tm->zranges.query(z, z, candidates);
+    if (!mesh.cutAtZ(tvertices, candidates, z, loops, cut_triangles)) return false;
+  }
+
+  for (uint i = 0; i < loops.size(); i++) {
+    Poly poly(z);
+    poly.vertices = loops[i];
+    poly.calcHole();
+    polys.push_back(poly);
+  }
+
+  std::shared_ptr<const Overhangs> ov;
+  if (supportangle >= 0)
+    ov = getOverhangs(T, supportangle);
+  for (uint i = 0; i < cut_triangles.size(); i++) {
+    const uint t = cut_triangles[i];
+    const double gradient = abs(mesh.triangle(t).Normal.z());
+    if (gradient > max_gradient)
+      max_gradient = gradient;
+    if (ov && ov->steep[t])
+      support_triangles.push_back(tm->triangle(mesh, t));
+  }
+  // uncut triangles just below z
+  if (supportangle >= 0 && thickness > 0) {
+    vector<uint> candidates;
+    tm->zranges.query(z-thickness, z, candidates);
+    for (uint c = 0; c < candidates.size(); c++) {
+      const uint t = candidates[c];
+      if (!ov->steep[t]) continue;
+      bool inrange = true, below = false, above = false;
+      for (uint j = 0; j < 3; j++) {
+	const double vz = tvertices.z[mesh.triangleVertex(t,j)];
+	if (vz < z-thickness || vz > z) inrange = false;
+	if (z <= vz) above = true; else below = true;
+      }
+      if (!inrange || (above && below)) continue;
+      support_triangles.push_back(tm->triangle(mesh, t));
+    }
+  }
+  return true;
+}
+
+
 int find_vertex(const vector<Vector2d> &vertices,
 		const Vector2d &v, double delta = 0.0001)
 {
@@ -722,23 +882,32 @@ vector<Segment> Shape::getCutlines(const Matrix4d &T, double z,
   // we know our own tranform:
   Matrix4d transform = T * transform3D.transform ;
 
-  int count = (int)triangles.size();
+  // unless legacy, take the cached world space triangles near z
+  std::shared_ptr<const TransformedMesh> tm;
+  vector<uint> candidates;
+  if (!legacy_slicing) {
+    tm = getTransformedMesh(transform);
+    tm->zranges.query(thickness > 0 ? z-thickness : z, z, candidates);
+  }
+
+  std::shared_ptr<const Overhangs> ov;
+  if (supportangle >= 0)
+    ov = getOverhangs(T, supportangle);
+
+  int count = tm ? (int)candidates.size() : (int)mesh.numTriangles();
 // #ifdef _OPENMP
 // #pragma omp parallel for schedule(dynamic)
 // #endif
-  for (int i = 0; i < count; i++)
+  for (int c = 0; c < count; c++)
     {
+      const uint i = tm ? candidates[c] : c;
+      const Triangle ttr = tm ? tm->triangle(mesh, i) : mesh.triangle(i).transformed(transform);
       Segment line(-1,-1);
-      int num_cutpoints = triangles[i].CutWithPlane(z, transform, lineStart, lineEnd);
+      int num_cutpoints = ttr.CutWithPlane(z, Matrix4d::IDENTITY, lineStart, lineEnd);
       if (num_cutpoints == 0) {
-	if (supportangle >= 0 && thickness > 0) {
-	  if (triangles[i].isInZrange(z-thickness, z, transform)) {
-	    const double slope = -triangles[i].slopeAngle(transform);
-	    if (slope >= supportangle) {
-	      support_triangles.push_back(triangles[i].transformed(transform));
-	    }
-	  }
-	}
+	if (ov && thickness > 0 && ov->steep[i] &&
+	    ttr.isInZrange(z-thickness, z, Matrix4d::IDENTITY))
+	  support_triangles.push_back(ttr);
 	continue;
       }
       if (num_cutpoints > 0) {
@@ -749,13 +918,11 @@ vector<Segment> Shape::getCutlines(const Matrix4d &T, double z,
 	  line.start = vertices.size();
 	  vertices.push_back(lineStart);
 	}
-	if (abs(triangles[i].Normal.z()) > max_gradient)
-	  max_gradient = abs(triangles[i].Normal.z());
-	if (supportangle >= 0) {
-	  const double slope = -triangles[i].slopeAngle(transform);
-	  if (slope >= supportangle)
-	    support_triangles.push_back(triangles[i].transformed(transform));
-	}
+	const double gradient = abs(mesh.triangle(i).Normal.z());
+	if (gradient > max_gradient)
+	  max_gradient = gradient;
+	if (ov && ov->steep[i])
+	  support_triangles.push_back(ttr);
       }
       if (num_cutpoints > 1) {
 	int havev = find_vertex(vertices, lineEnd);
@@ -769,7 +936,7 @@ vector<Segment> Shape::getCutlines(const Matrix4d &T, double z,
       // Check segment normal against triangle normal. Flip segment, as needed.
       if (line.start != -1 && line.end != -1 && line.end != line.start)
 	{ // if we found a intersecting triangle
-	  Vector3d Norm = triangles[i].transformed(transform).Normal;
+	  Vector3d Norm = ttr.Normal;
 	  Vector2d triangleNormal = Vector2d(Norm.x(), Norm.y());
 	  Vector2d segment = (lineEnd - lineStart);
 	  Vector2d segmentNormal(-segment.y(),segment.x());
@@ -857,16 +1024,7 @@ void Shape::draw(const Settings &settings, bool highlight, uint max_triangles)
 		glMaterialfv(GL_FRONT, GL_DIFFUSE, mat_diffuse);
 
 		glColor4fv(mat_diffuse);
-		for(size_t i=0;i<triangles.size();i++)
-		{
-			glBegin(GL_LINE_LOOP);
-			glLineWidth(1);
-			glNormal3dv((GLdouble*)&(triangles[i].Normal));
-			glVertex3dv((GLdouble*)&(triangles[i].A));
-			glVertex3dv((GLdouble*)&(triangles[i].B));
-			glVertex3dv((GLdouble*)&(triangles[i].C));
-			glEnd();
-		}
+		renderer.drawWireframe(mesh);
 	}
 
 	glDisable(GL_LIGHTING);
@@ -875,16 +1033,8 @@ void Shape::draw(const Settings &settings, bool highlight, uint max_triangles)
 	if(settings.get_boolean("Display","DisplayNormals"))
 	{
 	        glColor4fv(settings.get_colour("Display","NormalsColour"));
-		glBegin(GL_LINES);
 		double nlength = settings.get_double("Display","NormalsLength");
-		for(size_t i=0;i<triangles.size();i++)
-		{
-			Vector3d center = (triangles[i].A+triangles[i].B+triangles[i].C)/3.0;
-			glVertex3dv((GLdouble*)&center);
-			Vector3d N = center + (triangles[i].Normal*nlength);
-			glVertex3dv((GLdouble*)&N);
-		}
-		glEnd();
+		renderer.drawNormals(mesh, nlength);
 	}
 
 	// Endpoints
@@ -892,14 +1042,7 @@ void Shape::draw(const Settings &settings, bool highlight, uint max_triangles)
 	{
       	        glColor4fv(settings.get_colour("Display","EndpointsColour"));
 		glPointSize(settings.get_double("Display","EndPointSize"));
-		glBegin(GL_POINTS);
-		for(size_t i=0;i<triangles.size();i++)
-		{
-		  glVertex3dv((GLdouble*)&(triangles[i].A));
-		  glVertex3dv((GLdouble*)&(triangles[i].B));
-		  glVertex3dv((GLdouble*)&(triangles[i].C));
-		}
-		glEnd();
+		renderer.drawEndpoints(mesh);
 	}
 	glDisable(GL_DEPTH_TEST);
 
@@ -969,51 +1112,32 @@ void Shape::drawBBox() const
 
 void Shape::draw_geometry(uint max_triangles)
 {
-
-  bool listDraw = (max_triangles == 0); // not in preview mode
-  bool haveList = gl_List >= 0;
-
-  if (!listDraw && haveList) {
-    if (gl_List>=0)
-      glDeleteLists(gl_List,1);
-    gl_List = -1;
-    haveList = false;
-  }
-  if (listDraw && !haveList) {
-    gl_List = glGenLists(1);
-    glNewList(gl_List, GL_COMPILE);
-  }
-  if (!listDraw || !haveList) {
-	uint step = 1;
-	if (max_triangles>0) step = floor(triangles.size()/max_triangles);
+  if (max_triangles > 0) { // preview mode, every step'th triangle
+	uint step = floor(mesh.numTriangles()/max_triangles);
 	step = max((uint)1,step);
 
 	glBegin(GL_TRIANGLES);
-	for(size_t i=0;i<triangles.size();i+=step)
+	for(size_t i=0;i<mesh.numTriangles();i+=step)
 	{
-		glNormal3dv(triangles[i].Normal);
-		glVertex3dv(triangles[i].A);
-		glVertex3dv(triangles[i].B);
-		glVertex3dv(triangles[i].C);
+		const Triangle triangle = mesh.triangle(i);
+		glNormal3dv(triangle.Normal);
+		glVertex3dv(triangle.A);
+		glVertex3dv(triangle.B);
+		glVertex3dv(triangle.C);
 	}
 	glEnd();
-  }
-  if (listDraw && !haveList) {
-    glEndList();
+	return;
   }
 
-  if (listDraw && gl_List >= 0) { // have stored list
-    Glib::TimeVal starttime, endtime;
-    if (!slow_drawing) {
-      starttime.assign_current_time();
-    }
-    glCallList(gl_List);
-    if (!slow_drawing) {
-      endtime.assign_current_time();
-      Glib::TimeVal usedtime = endtime-starttime;
-      if (usedtime.as_double() > 0.2) slow_drawing = true;
-    }
-    return;
+  Glib::TimeVal starttime, endtime;
+  if (!slow_drawing) {
+    starttime.assign_current_time();
+  }
+  renderer.drawTriangles(mesh);
+  if (!slow_drawing) {
+    endtime.assign_current_time();
+    Glib::TimeVal usedtime = endtime-starttime;
+    if (usedtime.as_double() > 0.2) slow_drawing = true;
   }
 }
 
@@ -1233,7 +1357,7 @@ bool CleanupConnectSegments(const vector<Vector2d> &vertices, vector<Segment> &l
 string Shape::info() const
 {
   ostringstream ostr;
-  ostr <<"Shape with "<<triangles.size() << " triangles "
+  ostr <<"Shape with "<<mesh.numTriangles() << " triangles "
        << "min/max/center: "<<Min<<Max <<Center ;
   return ostr.str();
 }
@@ -28,10 +28,13 @@
 #include <sstream>
 #include <limits>
 #include <algorithm>
+#include <memory>
 #include "stdafx.h"
 #include "transform3d.h"
 //#include "settings.h"
 #include "triangle.h"
+#include "mesh.h"
+#include "meshrenderer.h"
 #include "slicer/geometry.h"
 #include "poly.h"
 
@@ -120,6 +123,11 @@ public:
 
     /* Poly getOutline(const Matrix4d &T, double maxlen) const;*/
     vector<Triangle> trianglesSteeperThan(double angle) const;
+    // the triangles needing support under transform T (with our own)
+    std::shared_ptr<const Overhangs> getOverhangs(const Matrix4d &T,
+						  double angle) const;
+    // drawn under transform T, which shares the slicer's Overhangs
+    void drawOverhangs(const Matrix4d &T, double angle);
 
     string getSTLsolid() const;
     double volume() const;
@@ -136,25 +144,50 @@ public:
 
 
     bool slow_drawing;
+    bool legacy_slicing; // slice by matching cut point coordinates (no Mesh)
+    // Between these, getPolygonsAtZ with transform T and rising z sweeps
+    // through the shape. Not for concurrent slicing of the same shape.
+    void beginSweep(const Matrix4d &T);
+    void endSweep();
+    // a copy for slicing in another thread, not sharing the sweep
+    virtual Shape *clone() const;
     virtual string info() const;
 
+    // changes with the triangles, unique among all shapes
+    unsigned long getRevision() const { return revision; }
+
     vector<Triangle> getTriangles(const Matrix4d &T=Matrix4d::IDENTITY) const;
     void addTriangles(const vector<Triangle> &tr);
 
     void setTriangles(const vector<Triangle> &triangles_);
 
-    uint size() const {return triangles.size();}
+    uint size() const {return mesh.numTriangles();}
 
 protected:
 
-    int gl_List;
+    MeshRenderer renderer;
 
 private:
 
-    vector<Triangle> triangles;
+    Mesh mesh; // the triangles
+    unsigned long revision;
     //vector<Polygon2d>  polygons;  // surface polygons instead of triangles
     void calcPolygons();
 
+    // the mesh changed, drop everything made from it
+    void meshChanged();
+    // mesh and triangle z index for the last slicing transform
+    mutable std::shared_ptr<const TransformedMesh> transformed_mesh;
+    std::shared_ptr<const TransformedMesh> getTransformedMesh(const Matrix4d &T) const;
+    mutable std::shared_ptr<MeshSweep> sweep;
+    // for the last transform and support angle asked for
+    mutable std::shared_ptr<const Overhangs> overhangs;
+
+    bool getMeshPolygonsAtZ(const Matrix4d &T, double z,
+			    vector<Poly> &polys, double &max_gradient,
+			    vector<Triangle> &support_triangles,
+			    double supportangle, double thickness) const;
+
     // returns maximum gradient
     vector<Segment> getCutlines(const Matrix4d &T, double z,
 				vector<Vector2d> &vertices, double &max_grad,
@@ -20,6 +20,21 @@
 
 #include "clipping.h"
 
+#include <atomic>
+
+// every execution of a Clipper or ClipperOffset, and the offsets of them
+static std::atomic<unsigned long> num_calls(0), num_offsets(0);
+
+unsigned long Clipping::getCallCount()
+{
+  return num_calls;
+}
+
+unsigned long Clipping::getOffsetCount()
+{
+  return num_offsets;
+}
+
 //////////////////////////////////////////////////////////////////////////////////////////
 //
 // old API compatibility
@@ -251,6 +266,7 @@ vector<Poly> Clipping::intersect(CL::PolyFillType sft,
 				 CL::PolyFillType cft)
 {
   CL::Paths inter;
+  num_calls++;
   clpr.Execute(CL::ctIntersection, inter, sft, cft);
   return getPolys(inter, lastZ, lastExtrF);
 }
@@ -258,6 +274,7 @@ vector<ExPoly> Clipping::ext_intersect(CL::PolyFillType sft,
 				       CL::PolyFillType cft)
 {
   CL::PolyTree inter;
+  num_calls++;
   clpr.Execute(CL::ctIntersection, inter, sft, cft);
   return getExPolys(inter, lastZ, lastExtrF);
 }
@@ -267,6 +284,7 @@ vector<Poly> Clipping::unite(CL::PolyFillType sft,
 			     CL::PolyFillType cft)
 {
   CL::Paths united;
+  num_calls++;
   clpr.Execute(CL::ctUnion, united, sft, cft);
   return getPolys(united, lastZ, lastExtrF);
 }
@@ -274,6 +292,7 @@ vector<ExPoly> Clipping::ext_unite(CL::PolyFillType sft,
 				   CL::PolyFillType cft)
 {
   CL::PolyTree inter;
+  num_calls++;
   clpr.Execute(CL::ctUnion, inter, sft, cft);
   return getExPolys(inter, lastZ, lastExtrF);
 }
@@ -284,6 +303,7 @@ vector<Poly> Clipping::subtract(CL::PolyFillType sft,
 				CL::PolyFillType cft)
 {
   CL::Paths diff;
+  num_calls++;
   clpr.Execute(CL::ctDifference, diff, sft, cft);
   return getPolys(diff, lastZ, lastExtrF);
 }
@@ -307,6 +327,7 @@ vector<ExPoly> Clipping::ext_subtract(CL::PolyFillType sft,
   //   }
   // }
   // else
+  num_calls++;
   clpr.Execute(CL::ctDifference, diff, sft, cft);//CL::pftEvenOdd, CL::pftEvenOdd);
   return getExPolys(diff, lastZ, lastExtrF);
 }
@@ -315,6 +336,7 @@ vector<Poly> Clipping::subtractMerged(double dist,
 				      CL::PolyFillType cft)
 {
   CL::Paths diff;
+  num_calls++;
   clpr.Execute(CL::ctDifference, diff, sft, cft);
   return getPolys(getMerged(diff, dist), lastZ, lastExtrF);
 }
@@ -323,6 +345,7 @@ vector<Poly> Clipping::Xor(CL::PolyFillType sft,
 			   CL::PolyFillType cft)
 {
   CL::Paths xored;
+  num_calls++;
   clpr.Execute(CL::ctXor, xored, sft, cft);
   return getPolys(xored, lastZ, lastExtrF);
 }
@@ -410,7 +433,10 @@ vector<Poly> Clipping::getShrinkedCapped(const vector<Poly> &polys, double dista
     CL::ReversePaths(opolys);
   CL::ClipperOffset co(miter_limit, miter_limit);
   co.AddPaths(cpolys, cljtype, CL::etClosedPolygon);
+  num_calls++;
+  num_offsets++;
   co.Execute(opolys, cldist);
+  num_calls++; // a union
   CL::SimplifyPolygons(opolys);//, CL::pftNonZero);
   return opolys;
 }
@@ -439,6 +465,7 @@ CL::Paths Clipping::getMerged(const CL::Paths &cpolys, int overlap)
   // return getPolys(offset, polys.back().getZ(),polys.back().getExtrusionFactor());
   clpr.AddPaths(offset, CL::ptSubject, true);
   CL::Paths cpolys3;
+  num_calls++;
   clpr.Execute(CL::ctUnion, cpolys3, CL::pftEvenOdd, CL::pftEvenOdd);
   //cerr << cpolys3.size() << " - "<<offset.size() << endl;
   // shrink the result
@@ -542,6 +569,7 @@ CL::PolyTree Clipping::getClipperTree(const vector<Poly> &polys)
   CL::Clipper clpr;
   clpr.AddPaths(cpolys, CL::ptSubject, true);
   CL::PolyTree ctree;
+  num_calls++;
   clpr.Execute(CL::ctUnion, ctree, CL::pftEvenOdd, CL::pftEvenOdd);
   return ctree;
 }
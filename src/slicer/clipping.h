@@ -141,6 +141,9 @@ public:
 
   static void ReversePoints(vector<Poly> &polys);
 
+  static unsigned long getCallCount(); // clipper executions so far, all threads
+  static unsigned long getOffsetCount(); // of them offsets, all go through CLOffset
+
  protected:
   // old API compatibility
   // polytree to expolygons
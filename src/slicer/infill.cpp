@@ -22,10 +22,7 @@
 #include "layer.h"
 
 
-vector<struct Infill::pattern> Infill::savedPatterns;
-#ifdef _OPENMP
-omp_lock_t Infill::save_lock;
-#endif
+std::shared_ptr<const Infill::patterntable> Infill::savedPatterns;
 
 void hilbert(int level,int direction, double infillDistance, vector<Vector2d> &v);
 
@@ -59,18 +56,59 @@ void Infill::clear()
 }
 
 void Infill::clearPatterns() {
-  for (uint i=0; i<savedPatterns.size(); i++) {
-    savedPatterns[i].type = INVALIDINFILL;
-    savedPatterns[i].cpolys.clear();
-  }
-  savedPatterns.clear();
-  //cerr << "clearpatterns " << savedPatterns.size() << endl;
+  // threads still using a pattern keep it alive
+  std::atomic_store(&savedPatterns, std::shared_ptr<const patterntable>());
+}
+
+Infill::patternslot::patternslot()
+{
 #ifdef _OPENMP
-  omp_destroy_lock(&save_lock);
-  omp_init_lock(&save_lock);
+  omp_init_lock(&build_lock);
 #endif
 }
 
+Infill::patternslot::~patternslot()
+{
+#ifdef _OPENMP
+  omp_destroy_lock(&build_lock);
+#endif
+}
+
+bool Infill::pattern::covers(const Vector2d &pMin, const Vector2d &pMax) const
+{
+  return Min.x() <= pMin.x() && Min.y() <= pMin.y() &&
+    Max.x() >= pMax.x() && Max.y() >= pMax.y();
+}
+
+// distance and angle match to 0.1 micron and 0.1 mrad
+Infill::patternkey Infill::patternKey(InfillType type, double distance, double angle)
+{
+  return patternkey(type, std::make_pair(lround(distance*1e4), lround(angle*1e4)));
+}
+
+std::shared_ptr<Infill::patternslot> Infill::findPatternSlot(const patternkey &key,
+							     bool create)
+{
+  std::shared_ptr<const patterntable> table = std::atomic_load(&savedPatterns);
+  while (true) {
+    if (table) {
+      patterntable::const_iterator it = table->find(key);
+      if (it != table->end())
+	return it->second;
+    }
+    if (!create)
+      return std::shared_ptr<patternslot>();
+    // publish a copy with the new slot unless another thread has
+    // changed the table meanwhile, then look again in the new one
+    patterntable *newtable = table ? new patterntable(*table) : new patterntable();
+    std::shared_ptr<patternslot> slot(new patternslot());
+    (*newtable)[key] = slot;
+    std::shared_ptr<const patterntable> newptr(newtable);
+    if (std::atomic_compare_exchange_strong(&savedPatterns, &table, newptr))
+      return slot;
+  }
+}
+
 
 
 // fill polys with type etc.
@@ -85,14 +123,8 @@ void Infill::addPolys(double z, const vector<Poly> &polys, InfillType type,
 {
   this->infillDistance = infillDistance;
 
-#ifdef _OPENMP
-  omp_set_lock(&save_lock);
-#endif
   ClipperLib::Paths patterncpolys =
     makeInfillPattern(type, polys, infillDistance, offsetDistance, rotation);
-#ifdef _OPENMP
-  omp_unset_lock(&save_lock);
-#endif
   addPolys(z, polys, patterncpolys, offsetDistance);
 }
 
@@ -177,40 +209,54 @@ ClipperLib::Paths Infill::makeInfillPattern(InfillType type,
     else
       m_angle = 0.;
   }
-  //omp_set_lock(&save_lock);
-  //int tid = omp_get_thread_num( );
-  //cerr << "thread "<<tid << " looking for pattern " << endl;
-  if (type != PolyInfill) { // can't save PolyInfill
-    if (savedPatterns.size()>0){
-      vector<uint> too_small;
-      for (vector<struct pattern>::iterator sIt=savedPatterns.begin();
-      	   sIt != savedPatterns.end(); sIt++){
-	if (sIt->type == type &&
-	    abs((sIt->distance-infillDistance)/infillDistance) < 0.01 &&
-	    abs((sIt->angle-m_angle)/m_angle) < 0.01 )
-	  {
-	    //cerr << name << " found saved pattern no " << sIt-savedPatterns.begin() << " with " << sIt->cpolys.size() <<" polys"<< endl << "type "<< sIt->type << sIt->Min << sIt->Max << endl;
-	    // is it too small for this layer?
-	    if (sIt->Min.x() > Min.x() || sIt->Min.y() > Min.y() ||
-		sIt->Max.x() < Max.x() || sIt->Max.y() < Max.y())
-	      {
-		too_small.push_back(sIt-savedPatterns.begin());
-		//break; // there is no other match
-	      }
-	    else {
-	      cached = true;
-	      return sIt->cpolys;
-	    }
-	  }
-      }
-      sort(too_small.rbegin(), too_small.rend());
-      for (uint i = 0; i < too_small.size(); i++) {
-	savedPatterns.erase(savedPatterns.begin()+too_small[i]);
-      }
+  if (type == PolyInfill || type == ZigzagInfill || type == ThinInfill)
+    return generatePattern(type, tofillpolys, infillDistance, Min, Max); // can't save these
+
+  std::shared_ptr<patternslot> slot =
+    findPatternSlot(patternKey(type, infillDistance, m_angle), true);
+  std::shared_ptr<const pattern> saved = std::atomic_load(&slot->current);
+  if (saved && saved->covers(Min, Max)) {
+    cached = true;
+    return saved->cpolys;
+  }
+#ifdef _OPENMP
+  omp_set_lock(&slot->build_lock);
+#endif
+  // may have been made by another thread meanwhile
+  saved = std::atomic_load(&slot->current);
+  if (saved && saved->covers(Min, Max)) {
+    cached = true;
+    cpolys = saved->cpolys;
+  } else {
+    // too small or none found - make new, large enough for the old one's
+    // layers too, so layers of different size don't replace each other
+    Vector2d pMin = Min, pMax = Max;
+    if (saved) {
+      pMin.x() = min(pMin.x(), saved->Min.x()); pMin.y() = min(pMin.y(), saved->Min.y());
+      pMax.x() = max(pMax.x(), saved->Max.x()); pMax.y() = max(pMax.y(), saved->Max.y());
     }
+    cpolys = generatePattern(type, tofillpolys, infillDistance, pMin, pMax);
+    pattern *newPattern = new pattern();
+    newPattern->type=type;
+    newPattern->angle=m_angle;
+    newPattern->distance=infillDistance;
+    newPattern->cpolys=cpolys;
+    newPattern->Min=pMin;
+    newPattern->Max=pMax;
+    std::atomic_store(&slot->current, std::shared_ptr<const pattern>(newPattern));
   }
-  //omp_unset_lock(&save_lock);
-  // none found - make new:
+#ifdef _OPENMP
+  omp_unset_lock(&slot->build_lock);
+#endif
+  return cpolys;
+}
+
+ClipperLib::Paths Infill::generatePattern(InfillType type,
+					  const vector<Poly> &tofillpolys,
+					  double infillDistance,
+					  const Vector2d &Min, const Vector2d &Max)
+{
+  ClipperLib::Paths cpolys;
   bool zigzag = false;
   switch (type)
     {
@@ -413,24 +459,6 @@ ClipperLib::Paths Infill::makeInfillPattern(InfillType type,
     default:
       cerr << "infill type " << type << " unknown "<< endl;
     }
-  // save
-  //tid = omp_get_thread_num( );
-  //cerr << "thread "<<tid << " saving pattern " << endl;
-  //cerr << "cpolys " << cpolys.size() << endl;
-  if (type != PolyInfill &&
-      type != ZigzagInfill &&
-      type != ThinInfill ) // can't save these
-    {
-      struct pattern newPattern;
-      newPattern.type=type;
-      newPattern.angle=m_angle;
-      newPattern.distance=infillDistance;
-      newPattern.cpolys=cpolys;
-      newPattern.Min=Min;
-      newPattern.Max=Max;
-      savedPatterns.push_back(newPattern);
-      //cerr << "saved pattern " << endl;
-    }
   return cpolys;
 }
 
@@ -680,17 +708,15 @@ void Infill::getLines(vector<Vector3d> &lines) const
 
 vector<Poly> Infill::getCachedPattern(double z) {
   vector<Poly> cached;
-  if (m_type != PolyInfill) // can't save PolyInfill
-    if (savedPatterns.size()>0)
-      for (vector<struct pattern>::iterator sIt=savedPatterns.begin();
-      	   sIt != savedPatterns.end(); sIt++)
-	if (sIt->type == m_type &&
-	    abs(sIt->distance-infillDistance) < 0.01 &&
-	    abs(sIt->angle-m_angle) < 0.01 )
-	  {
-	    cached = Clipping::getPolys(sIt->cpolys,z,extrusionfactor);
-	    break;
-	  }
+  if (m_type != PolyInfill) { // can't save PolyInfill
+    std::shared_ptr<patternslot> slot =
+      findPatternSlot(patternKey(m_type, infillDistance, m_angle), false);
+    if (slot) {
+      std::shared_ptr<const pattern> saved = std::atomic_load(&slot->current);
+      if (saved)
+	cached = Clipping::getPolys(saved->cpolys,z,extrusionfactor);
+    }
+  }
   return cached;
 };
 
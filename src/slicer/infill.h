@@ -24,6 +24,9 @@
 #include <omp.h>
 #endif
 
+#include <map>
+#include <memory>
+
 #include "stdafx.h"
 #include "clipping.h"
 
@@ -48,18 +51,39 @@ class Infill
     double distance;
     Vector2d Min,Max;
     ClipperLib::Paths cpolys;
+    bool covers(const Vector2d &pMin, const Vector2d &pMax) const;
   } ;
 
-  static vector<struct pattern> savedPatterns;
+  // Saved patterns by type, distance and angle. Finding a pattern takes
+  // no lock: the table and the patterns are immutable once published and
+  // replaced atomically. Each slot is built by one thread at a time while
+  // other threads asking for the same key wait for it.
+  typedef std::pair<InfillType, std::pair<long, long> > patternkey;
+  struct patternslot
+  {
+    patternslot();
+    ~patternslot();
+    std::shared_ptr<const pattern> current; // use atomic_load/atomic_store
 #ifdef _OPENMP
-  static omp_lock_t save_lock;
+    omp_lock_t build_lock;
 #endif
+  };
+  typedef std::map<patternkey, std::shared_ptr<patternslot> > patterntable;
+  static std::shared_ptr<const patterntable> savedPatterns;
+
+  static patternkey patternKey(InfillType type, double distance, double angle);
+  static std::shared_ptr<patternslot> findPatternSlot(const patternkey &key,
+						      bool create);
 
   ClipperLib::Paths makeInfillPattern(InfillType type,
 					 const vector<Poly> &tofillpolys,
 					 double infillDistance,
 					 double offsetDistance,
 					 double rotation) ;
+  ClipperLib::Paths generatePattern(InfillType type,
+				    const vector<Poly> &tofillpolys,
+				    double infillDistance,
+				    const Vector2d &Min, const Vector2d &Max);
 
   Infill();
 
@@ -47,6 +47,13 @@ Layer::~Layer()
 
 
 void Layer::Clear()
+{
+  ClearShells();
+  clearpolys(polygons);
+  clearpolys(toSupportPolygons);
+}
+
+void Layer::ClearInfill()
 {
   delete normalInfill; normalInfill = NULL;
   delete fullInfill; fullInfill = NULL;
@@ -54,8 +61,18 @@ void Layer::Clear()
   delete supportInfill; supportInfill = NULL;
   delete decorInfill; decorInfill = NULL;
   delete thinInfill; thinInfill = NULL;
+  for (uint i = 0; i < skinFullInfills.size(); i++)
+    delete skinFullInfills[i];
   skinFullInfills.clear();
-  clearpolys(polygons);
+  for (uint i = 0; i < bridgeInfills.size(); i++)
+    delete bridgeInfills[i];
+  bridgeInfills.clear();
+}
+
+// all but the sliced polygons
+void Layer::ClearShells()
+{
+  ClearInfill();
   clearpolys(shellPolygons);
   clearpolys(fillPolygons);
   clearpolys(thinPolygons);
@@ -63,16 +80,39 @@ void Layer::Clear()
   clearpolys(bridgePolygons);
   clearpolys(bridgePillars);
   bridge_angles.clear();
-  bridgeInfills.clear();
   clearpolys(decorPolygons);
   clearpolys(supportPolygons);
-  clearpolys(toSupportPolygons);
   clearpolys(skinPolygons);
   clearpolys(skinFullFillPolygons);
   hullPolygon.clear();
   clearpolys(skirtPolygons);
 }
 
+void Layer::move(const Vector2d &delta)
+{
+  Poly::move(polygons, delta);
+  for (uint i = 0; i < shellPolygons.size(); i++)
+    Poly::move(shellPolygons[i], delta);
+  Poly::move(thinPolygons, delta);
+  Poly::move(fillPolygons, delta);
+  Poly::move(fullFillPolygons, delta);
+  for (uint i = 0; i < bridgePolygons.size(); i++) {
+    bridgePolygons[i].outer.move(delta);
+    Poly::move(bridgePolygons[i].holes, delta);
+  }
+  for (uint i = 0; i < bridgePillars.size(); i++)
+    Poly::move(bridgePillars[i], delta);
+  Poly::move(supportPolygons, delta);
+  Poly::move(toSupportPolygons, delta);
+  Poly::move(skinPolygons, delta);
+  Poly::move(skinFullFillPolygons, delta);
+  hullPolygon.move(delta);
+  Poly::move(skirtPolygons, delta);
+  Poly::move(decorPolygons, delta);
+  Min += delta;
+  Max += delta;
+}
+
 // void Layer::setBBox(Vector2d min, Vector2d max)
 // {
 //   Min.x() = MIN(Min.x(),min.x());
@@ -262,59 +302,60 @@ void Layer::CalcRaftInfill (const vector<Poly> &polys,
 			 infilldistance, infilldistance, rotation);
 }
 
-void Layer::CalcInfill (const Settings &settings)
+void Layer::CalcInfill (const SliceParams &params)
 {
   // inFill distances in real mm:
   // for full polys/layers:
   double fullInfillDistance=0;
   double infillDistance=0; // normal fill
   double altInfillDistance=0;
-  double altInfillPercent=settings.get_double("Slicing","InfillPercent");
+  double altInfillPercent=params.Slicing.InfillPercent;
   double normalInfilldist=0;
-  bool shellOnly = !settings.get_boolean("Slicing","DoInfill");
-  fullInfillDistance = settings.GetInfillDistance(thickness, 100);
+  bool shellOnly = !params.Slicing.DoInfill;
+  fullInfillDistance = params.GetInfillDistance(thickness, 100);
 
-  if (settings.get_double("Slicing","InfillPercent") == 0)
+  if (params.Slicing.InfillPercent == 0)
     shellOnly = true;
   else
-    infillDistance = settings.GetInfillDistance(thickness,altInfillPercent);
-  int altinfill = settings.get_integer("Slicing","AltInfillLayers");
+    infillDistance = params.GetInfillDistance(thickness,altInfillPercent);
+  int altinfill = params.Slicing.AltInfillLayers;
   normalInfilldist = infillDistance;
   if ( altinfill != 0  && LayerNo % altinfill == 0 && altInfillPercent != 0) {
-    altInfillDistance = settings.GetInfillDistance(thickness,
-						   settings.get_double("Slicing","AltInfillPercent"));
+    altInfillDistance = params.GetInfillDistance(thickness,
+						   params.Slicing.AltInfillPercent);
     normalInfilldist = altInfillDistance;
   }
   // first layers:
-  if (LayerNo < (int)settings.get_integer("Slicing","FirstLayersNum")) {
+  if (LayerNo < params.Slicing.FirstLayersNum) {
     double first_infdist =
-      fullInfillDistance * (1.+settings.get_double("Slicing","FirstLayersInfillDist"));
+      fullInfillDistance * (1.+params.Slicing.FirstLayersInfillDist);
     normalInfilldist   = max(normalInfilldist,   first_infdist);
     fullInfillDistance = max(fullInfillDistance, first_infdist);
   }
   // relative extrusion for skins:
-  double skinfillextrf = settings.get_double("Slicing","FullFillExtrusion")/skins/skins;
-  normalInfill = new Infill(this,settings.get_double("Slicing","NormalFillExtrusion"));
+  double skinfillextrf = params.Slicing.FullFillExtrusion/skins/skins;
+  ClearInfill();
+  normalInfill = new Infill(this,params.Slicing.NormalFillExtrusion);
   normalInfill->setName("normal");
-  fullInfill = new Infill(this,settings.get_double("Slicing","FullFillExtrusion"));
+  fullInfill = new Infill(this,params.Slicing.FullFillExtrusion);
   fullInfill->setName("full");
-  skirtInfill = new Infill(this,settings.get_double("Slicing","FullFillExtrusion"));
+  skirtInfill = new Infill(this,params.Slicing.FullFillExtrusion);
   skirtInfill->setName("skirt");
   skinFullInfills.clear();
-  supportInfill = new Infill(this,settings.get_double("Slicing","SupportExtrusion"));
+  supportInfill = new Infill(this,params.Slicing.SupportExtrusion);
   supportInfill->setName("support");
   decorInfill = new Infill(this,1.);
   decorInfill->setName("decor");
   thinInfill = new Infill(this, 1.);
   thinInfill->setName("thin");
 
-  double rot = (settings.get_double("Slicing","InfillRotation")
-		+ (double)LayerNo * settings.get_double("Slicing","InfillRotationPrLayer"))/180.0*M_PI;
+  double rot = (params.Slicing.InfillRotation
+		+ (double)LayerNo * params.Slicing.InfillRotationPrLayer)/180.0*M_PI;
   if (!shellOnly)
-    normalInfill->addPolys(Z, fillPolygons, (InfillType)settings.get_integer("Slicing","NormalFilltype"),
+    normalInfill->addPolys(Z, fillPolygons, (InfillType)params.Slicing.NormalFilltype,
 			   normalInfilldist, fullInfillDistance, rot);
 
-  if (settings.get_boolean("Slicing","FillSkirt")) {
+  if (params.Slicing.FillSkirt) {
     vector<Poly> skirtFill;
     Clipping clipp;
     clipp.addPolys(skirtPolygons, subject);
@@ -322,22 +363,22 @@ void Layer::CalcInfill (const Settings &settings)
     clipp.addPolys(supportPolygons, clip);
     skirtFill = clipp.subtract();
     skirtFill = Clipping::getOffset(skirtFill, -fullInfillDistance);
-    skirtInfill->addPolys(Z, skirtFill, (InfillType)settings.get_integer("Slicing","FullFilltype"),
+    skirtInfill->addPolys(Z, skirtFill, (InfillType)params.Slicing.FullFilltype,
 			  fullInfillDistance, fullInfillDistance, rot);
   }
 
-  fullInfill->addPolys(Z, fullFillPolygons, (InfillType)settings.get_integer("Slicing","FullFilltype"),
+  fullInfill->addPolys(Z, fullFillPolygons, (InfillType)params.Slicing.FullFilltype,
 		       fullInfillDistance, fullInfillDistance, rot);
 
-  decorInfill->addPolys(Z, decorPolygons, (InfillType)settings.get_integer("Slicing","DecorFilltype"),
-			settings.get_double("Slicing","DecorInfillDistance"),
-			settings.get_double("Slicing","DecorInfillDistance"),
-			settings.get_double("Slicing","DecorInfillRotation")/180.0*M_PI);
+  decorInfill->addPolys(Z, decorPolygons, (InfillType)params.Slicing.DecorFilltype,
+			params.Slicing.DecorInfillDistance,
+			params.Slicing.DecorInfillDistance,
+			params.Slicing.DecorInfillRotation/180.0*M_PI);
 
   assert(bridge_angles.size() >= bridgePolygons.size());
   bridgeInfills.resize(bridgePolygons.size());
   for (uint b=0; b < bridgePolygons.size(); b++){
-    bridgeInfills[b] = new Infill(this, settings.get_double("Slicing","BridgeExtrusion"));
+    bridgeInfills[b] = new Infill(this, params.Slicing.BridgeExtrusion);
     bridgeInfills[b]->addPoly(Z, bridgePolygons[b], BridgeInfill,
 			      fullInfillDistance, fullInfillDistance,
 			      bridge_angles[b]+M_PI/2);
@@ -346,19 +387,19 @@ void Layer::CalcInfill (const Settings &settings)
   if (skins>1) {
     double skindistance = fullInfillDistance/skins;
     for (uint s = 0; s<skins; s++){
-      double drot = rot + settings.get_double("Slicing","InfillRotationPrLayer")/180.0*M_PI*s;
+      double drot = rot + params.Slicing.InfillRotationPrLayer/180.0*M_PI*s;
       double sz = Z-thickness + (s+1)*thickness/skins;
       Infill *inf = new Infill(this, skinfillextrf);
       inf->setName("skin");
-      inf->addPolys(sz, skinFullFillPolygons, (InfillType)settings.get_integer("Slicing","FullFilltype"),
+      inf->addPolys(sz, skinFullFillPolygons, (InfillType)params.Slicing.FullFilltype,
 		    skindistance, skindistance, drot);
       skinFullInfills.push_back(inf);
     }
   }
   supportInfill->addPolys(Z, supportPolygons,
-			  (InfillType)settings.get_integer("Slicing","SupportFilltype"),
-			  settings.get_double("Slicing","SupportInfillDistance"),
-			  settings.get_double("Slicing","SupportInfillDistance"), 0);
+			  (InfillType)params.Slicing.SupportFilltype,
+			  params.Slicing.SupportInfillDistance,
+			  params.Slicing.SupportInfillDistance, 0);
 
   thinInfill->addPolys(Z, thinPolygons, ThinInfill,
 		       fullInfillDistance, fullInfillDistance, 0);
@@ -602,16 +643,16 @@ void Layer::FindThinpolys(const vector<Poly> &polys, double extrwidth,
 #endif
 }
 
-void Layer::MakeShells(const Settings &settings)
+void Layer::MakeShells(const SliceParams &params)
 {
-  double extrudedWidth        = settings.GetExtrudedMaterialWidth(thickness);
+  double extrudedWidth        = params.GetExtrudedMaterialWidth(thickness);
   double roundline_extrfactor =
-    settings.RoundedLinewidthCorrection(extrudedWidth,thickness);
+    Settings::RoundedLinewidthCorrection(extrudedWidth,thickness);
   double distance       = 0.5 * extrudedWidth;
   double cleandist      = min(distance/CLEANFACTOR, thickness/CLEANFACTOR);
-  double shelloffset    = settings.get_double("Slicing","ShellOffset");
-  uint   shellcount     = settings.get_integer("Slicing","ShellCount");
-  double infilloverlap  = settings.get_double("Slicing","InfillOverlap");
+  double shelloffset    = params.Slicing.ShellOffset;
+  uint   shellcount     = params.Slicing.ShellCount;
+  double infilloverlap  = params.Slicing.InfillOverlap;
 
   // first shrink with global offset
   vector<Poly> shrinked = Clipping::getOffset(polygons, -2.0/M_PI*extrudedWidth-shelloffset);
@@ -658,7 +699,7 @@ void Layer::MakeShells(const Settings &settings)
       }
   }
   // the filling polygon
-  if (settings.get_boolean("Slicing","DoInfill")) {
+  if (params.Slicing.DoInfill) {
     fillPolygons = Clipping::getOffset(shrinked,-(1.-infilloverlap)*extrudedWidth);
     for (uint i = 0; i<fillPolygons.size(); i++)
       fillPolygons[i].cleanup(cleandist);
@@ -735,37 +776,37 @@ bool Layer::setMinMax(const Poly &poly)
 void Layer::MakeGCode (Vector3d &start,
 		       GCodeState &gc_state,
 		       double offsetZ,
-		       Settings &settings) const
+		       const SliceParams &params) const
 {
   vector<PLine3> plines;
-  MakePrintlines(start, plines, offsetZ, settings);
-  Printlines::makeAntioozeRetract(plines, settings);
-  Printlines::getCommands(plines, settings, gc_state);
+  MakePrintlines(start, plines, offsetZ, params);
+  Printlines::makeAntioozeRetract(plines, params);
+  Printlines::getCommands(plines, params, gc_state);
 }
 
 // Convert to Printlines
 void Layer::MakePrintlines(Vector3d &lastPos, //GCodeState &state,
 			   vector<PLine3> &lines3,
 			   double offsetZ,
-			   Settings &settings) const
+			   const SliceParams &params) const
 {
-  const double linewidth      = settings.GetExtrudedMaterialWidth(thickness);
-  const double cornerradius   = linewidth*settings.get_double("Slicing","CornerRadius");
+  const double linewidth      = params.GetExtrudedMaterialWidth(thickness);
+  const double cornerradius   = linewidth*params.Slicing.CornerRadius;
 
-  const bool clipnearest      = settings.get_boolean("Slicing","MoveNearest");
+  const bool clipnearest      = params.Slicing.MoveNearest;
 
-  const uint supportExtruder  = settings.GetSupportExtruder();
-  const double minshelltime   = settings.get_double("Slicing","MinShelltime");
+  const uint supportExtruder  = params.supportExtruder;
+  const double minshelltime   = params.Slicing.MinShelltime;
 
-  const double maxshellspeed  = settings.get_double("Extruder","MaxShellSpeed");
-  const bool ZliftAlways      = settings.get_boolean("Extruder","ZliftAlways");
+  const double maxshellspeed  = params.Extruder.MaxShellSpeed;
+  const bool ZliftAlways      = params.Extruder.ZliftAlways;
 
   Vector2d startPoint(lastPos.x(),lastPos.y());
 
-  const double extr_per_mm = settings.GetExtrusionPerMM(thickness);
+  const double extr_per_mm = params.GetExtrusionPerMM(thickness);
 
   //vector<PLine3> lines3;
-  Printlines printlines(this, &settings, offsetZ);
+  Printlines printlines(this, &params, offsetZ);
 
   vector<PLine2> lines;
 
@@ -825,12 +866,9 @@ void Layer::MakePrintlines(Vector3d &lastPos, //GCodeState &state,
 		      minshelltime);
 
   // 3. Support
-  if (supportInfill) {
-    uint extruderbefore = settings.selectedExtruder;
-    settings.SelectExtruder(supportExtruder);
-    printlines.addPolys(SUPPORT, supportInfill->infillpolys, false);
-    settings.SelectExtruder(extruderbefore);
-  }
+  if (supportInfill)
+    printlines.addPolys(SUPPORT, supportInfill->infillpolys, false,
+			0, 0, supportExtruder);
   // 4. all other polygons:
 
   //  Shells
@@ -869,20 +907,20 @@ void Layer::MakePrintlines(Vector3d &lastPos, //GCodeState &state,
   if (!ZliftAlways)
     printlines.clipMovements(clippolys, lines, clipnearest, linewidth);
   printlines.optimize(linewidth,
-		      settings.get_double("Slicing","MinLayertime"),
+		      params.Slicing.MinLayertime,
 		      cornerradius, lines);
-  if ((guint)LayerNo < (guint)settings.get_integer("Slicing","FirstLayersNum"))
-    printlines.setSpeedFactor(settings.get_double("Slicing","FirstLayersSpeed"), lines);
+  if ((guint)LayerNo < (guint)params.Slicing.FirstLayersNum)
+    printlines.setSpeedFactor(params.Slicing.FirstLayersSpeed, lines);
   double slowdownfactor = printlines.getSlowdownFactor() * polyspeedfactor;
 
-  if (settings.get_boolean("Slicing","FanControl")) {
-    int fanspeed = settings.get_integer("Slicing","MinFanSpeed");
+  if (params.Slicing.FanControl) {
+    int fanspeed = params.Slicing.MinFanSpeed;
     if (slowdownfactor < 1 && slowdownfactor > 0) {
       double fanfactor = 1-slowdownfactor;
       fanspeed +=
-	int(fanfactor * (settings.get_integer("Slicing","MaxFanSpeed")-settings.get_integer("Slicing","MinFanSpeed")));
-      fanspeed = CLAMP(fanspeed, settings.get_integer("Slicing","MinFanSpeed"),
-		       settings.get_integer("Slicing","MaxFanSpeed"));
+	int(fanfactor * (params.Slicing.MaxFanSpeed-params.Slicing.MinFanSpeed));
+      fanspeed = CLAMP(fanspeed, params.Slicing.MinFanSpeed,
+		       params.Slicing.MaxFanSpeed);
       //cerr << slowdownfactor << " - " << fanfactor << " - " << fanspeed << " - " << endl;
     }
     Command fancommand(FANON, fanspeed);
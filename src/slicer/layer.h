@@ -74,7 +74,7 @@ public:
   void mergeSupportPolygons();
   // vector<Poly> getFillPolygons(const vector<Poly> polys, long dist) const;
 
-  void CalcInfill (const Settings &settings);
+  void CalcInfill (const SliceParams &params);
   void CalcRaftInfill (const vector<Poly> &polys,
 		       double extrusionfactor, double infilldistance,
 		       double rotation);
@@ -85,7 +85,7 @@ public:
   static void FindThinpolys(const vector<Poly> &polys, double extrwidth,
 			    vector<Poly> &thickpolys, vector<Poly> &thinpolys);
 
-  void MakeShells(const Settings &settings);
+  void MakeShells(const SliceParams &params);
   // uint shellcount, double extrudedWidth, double shelloffset,
   // bool makeskirt, double skirtdistance, double infilloverlap);
   /* vector<Poly> ShrinkedPolys(const vector<Poly> poly, */
@@ -134,15 +134,16 @@ public:
   /* 			    double linewidth,double linewidthratio,double optratio) const; */
 
 
+  // does not change settings, can run for several layers at once
   void MakePrintlines (Vector3d &start,
 		       vector<PLine3> &plines,
 		       double offsetZ,
-		       Settings &settings) const;
+		       const SliceParams &params) const;
 
   void MakeGCode (Vector3d &start,
 		  GCodeState &gc_state,
 		  double offsetZ,
-		  Settings &settings) const;
+		  const SliceParams &params) const;
 
   string info() const ;
 
@@ -151,6 +152,10 @@ public:
   void DrawRulers(const Vector2d &point);
 
   void Clear();
+  void ClearInfill();
+  void ClearShells(); // and all else made from the sliced polygons
+
+  void move(const Vector2d &delta);
 
   void addPolygons(vector<Poly> &polys);
   void cleanupPolygons();
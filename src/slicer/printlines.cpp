@@ -528,10 +528,10 @@ string PLine2::info() const
 ///////////// Printlines //////////////////////
 
 
-Printlines::Printlines(const Layer * layer, const Settings * settings, double z_offset)
-  : Zoffset(z_offset), name(""), slowdownfactor(1.)
+Printlines::Printlines(const Layer * layer, const SliceParams * params, double z_offset)
+  : Zoffset(z_offset), name(""), legacy_search(false), slowdownfactor(1.)
 {
-  this->settings = settings;
+  this->params = params;
   this->layer = layer;
 
   // save overhang polys of layer for point-in-overhang detection
@@ -563,8 +563,8 @@ void Printlines::addLine(PLineArea area, uint extruder_no, vector<PLine2> &lines
 	lfrom.squared_distance(lastpos) > 0.01) { // add moveline
       // use last extruder for move
       PLine2 move(area, lines.back().extruder_no, lastpos, lfrom, movespeed, 0);
-      if (extruder_change || settings->get_boolean("Extruder","ZliftAlways")) {
-	move.lifted = settings->get_double("Extruder","AntioozeZlift");
+      if (extruder_change || params->Extruder.ZliftAlways) {
+	move.lifted = params->Extruder.AntioozeZlift;
       }
       lines.push_back(move);
     } else {
@@ -575,10 +575,93 @@ void Printlines::addLine(PLineArea area, uint extruder_no, vector<PLine2> &lines
 }
 
 
+// // // // // // // // // // // // PolyStartTree // // // // // // // // // //
+
+PolyStartTree::PolyStartTree(const vector<Point> &points_, uint numpolys)
+  : points(points_), parent(points_.size()), alive(points_.size()),
+    removed(points_.size(), false), poly_nodes(numpolys)
+{
+  build(0, points.size(), 0, (uint)-1);
+  for (uint i = 0; i < points.size(); i++)
+    poly_nodes[points[i].poly].push_back(i);
+}
+
+struct PolyStartAxisLess {
+  uint axis;
+  PolyStartAxisLess(uint axis_) : axis(axis_) {};
+  bool operator()(const PolyStartTree::Point &a, const PolyStartTree::Point &b) const
+  { return a.p[axis] < b.p[axis]; }
+};
+
+void PolyStartTree::build(uint lo, uint hi, uint depth, uint par)
+{
+  if (lo >= hi) return;
+  const uint mid = (lo + hi) / 2;
+  std::nth_element(points.begin() + lo, points.begin() + mid, points.begin() + hi,
+		   PolyStartAxisLess(depth % 2));
+  parent[mid] = par;
+  alive[mid] = hi - lo;
+  build(lo, mid, depth + 1, mid);
+  build(mid + 1, hi, depth + 1, mid);
+}
+
+void PolyStartTree::removePoly(uint poly)
+{
+  const vector<uint> &nodes = poly_nodes[poly];
+  for (uint i = 0; i < nodes.size(); i++) {
+    if (removed[nodes[i]]) continue;
+    removed[nodes[i]] = true;
+    for (uint n = nodes[i]; n != (uint)-1; n = parent[n])
+      alive[n]--;
+  }
+}
+
+void PolyStartTree::search(uint lo, uint hi, uint depth, const Vector2d &from,
+			   int &best, double &bestdist) const
+{
+  if (lo >= hi) return;
+  const uint mid = (lo + hi) / 2;
+  if (alive[mid] == 0) return;
+  if (!removed[mid]) {
+    const double d = (points[mid].p - from).squared_length();
+    if (best < 0 || d < bestdist ||
+	(d == bestdist &&
+	 (points[mid].poly < points[best].poly ||
+	  (points[mid].poly == points[best].poly &&
+	   points[mid].vertex < points[best].vertex)))) {
+      best = mid;
+      bestdist = d;
+    }
+  }
+  const uint axis = depth % 2;
+  const double diff = from[axis] - points[mid].p[axis];
+  if (diff < 0) {
+    search(lo, mid, depth + 1, from, best, bestdist);
+    if (best < 0 || diff*diff <= bestdist)
+      search(mid + 1, hi, depth + 1, from, best, bestdist);
+  } else {
+    search(mid + 1, hi, depth + 1, from, best, bestdist);
+    if (best < 0 || diff*diff <= bestdist)
+      search(lo, mid, depth + 1, from, best, bestdist);
+  }
+}
+
+bool PolyStartTree::nearest(const Vector2d &from, Point &result, double &distsq) const
+{
+  int best = -1;
+  distsq = INFTY;
+  search(0, points.size(), 0, from, best, distsq);
+  if (best < 0) return false;
+  result = points[best];
+  return true;
+}
+
+
 // // // // // // // // // // // // PrintPoly // // // // // // // // // // // //
 
 PrintPoly::PrintPoly(const Poly &poly,
 		     const Printlines * printlines_,
+		     uint extruder_no_, const Vector2d &extruder_offset,
 		     double speed_, double overhangspeed,
 		     double min_time_,
 		     bool displace_start_,
@@ -586,13 +669,12 @@ PrintPoly::PrintPoly(const Poly &poly,
   : printlines(printlines_), area(area_),
     speed(speed_), min_time(min_time_),
     displace_start(displace_start_),
-    overhangingpoints(0), priority(1.), length(0), speedfactor(1.)
+    overhangingpoints(0), priority(1.), length(0), speedfactor(1.),
+    extruder_no(extruder_no_)
 {
-  extruder_no = printlines->settings->selectedExtruder;
   // Take a copy of the reference poly
   m_poly = new Poly(poly);
-  m_poly->move(Vector2d(-printlines->settings->get_double("Extruder","OffsetX"),
-			-printlines->settings->get_double("Extruder","OffsetY")));
+  m_poly->move(-extruder_offset);
 
   if (area==SHELL || area==SKIN) {
     priority *= 5; // may be 5 times as far away to get preferred as next poly
@@ -684,15 +766,21 @@ string PrintPoly::info() const
 void Printlines::addPolys(PLineArea area,
 			  const vector<Poly> &polys,
 			  bool displace_start,
-			  double maxspeed, double min_time)
+			  double maxspeed, double min_time,
+			  int extruder)
 {
   if (polys.size() == 0) return;
+  // read the extruder's own group, settings are not switched
+  const SliceParams::ExtruderParams &ext = params->getExtruder(extruder);
+  const uint extruder_no = extruder < 0 ? params->selectedExtruder : extruder;
+  const Vector2d offset(ext.OffsetX, ext.OffsetY);
   if (maxspeed == 0)
-    maxspeed = settings->get_double("Extruder","MaxLineSpeed") * 60; // default
-  double maxoverhangspeed = settings->get_double("Slicing","MaxOverhangSpeed");
+    maxspeed = ext.MaxLineSpeed * 60; // default
+  double maxoverhangspeed = params->Slicing.MaxOverhangSpeed;
   for(size_t q = 0; q < polys.size(); q++) {
     if (polys[q].size() > 0) {
       PrintPoly *ppoly = new PrintPoly(polys[q], this, /* Takes a copy of the poly */
+				       extruder_no, offset,
 				       maxspeed, maxoverhangspeed * 60,
 				       min_time, displace_start, area);
       printpolys.push_back(ppoly);
@@ -738,13 +826,56 @@ double Printlines::makeLines(Vector2d &startPoint,
   for(size_t q=0; q < count; q++) done[q]=false;
   uint ndone=0;
   //double nlength;
-  double movespeed = settings->get_double("Hardware","MaxMoveSpeedXY") * 60;
+  double movespeed = params->Hardware.MaxMoveSpeedXY * 60;
   double totallength = 0;
   double totalspeedfactor = 0;
+
+  // one tree for each priority, the weighted nearest is the best of
+  // their nearest points
+  vector<double> priorities;
+  vector<PolyStartTree *> trees;
+  if (!legacy_search && count > 16) {
+    vector< vector<PolyStartTree::Point> > points;
+    for(size_t q = 0; q < count; q++) {
+      const Poly *poly = printpolys[q]->m_poly;
+      if (poly->size() == 0) {done[q] = true; ndone++; continue;}
+      const double prio = printpolys[q]->priority;
+      uint t = std::find(priorities.begin(), priorities.end(), prio) - priorities.begin();
+      if (t == priorities.size()) {
+	priorities.push_back(prio);
+	points.push_back(vector<PolyStartTree::Point>());
+      }
+      // same candidates as Poly::nearestDistanceSqTo
+      for (uint i = 0; i < poly->size(); i++) {
+	if (!poly->isClosed() && i != 0 && i != poly->size()-1) continue;
+	PolyStartTree::Point point;
+	point.p = poly->vertices[i];
+	point.poly = q;
+	point.vertex = i;
+	points[t].push_back(point);
+      }
+    }
+    for (uint t = 0; t < points.size(); t++)
+      trees.push_back(new PolyStartTree(points[t], count));
+  }
+
   while (ndone < count)
     {
       double nstdist = INFTY;
       double pdist;
+      if (trees.size() > 0 && std::isfinite(startPoint.x()) && std::isfinite(startPoint.y())) {
+	npindex = -1;
+	for (uint t = 0; t < trees.size(); t++) {
+	  PolyStartTree::Point point;
+	  if (!trees[t]->nearest(startPoint, point, pdist)) continue;
+	  pdist /= priorities[t];
+	  if (pdist < nstdist || (pdist == nstdist && (int)point.poly < npindex)) {
+	    npindex = point.poly;
+	    nstdist = pdist;
+	    nvindex = point.vertex;
+	  }
+	}
+      } else
       for(size_t q = 0; q < count; q++) { // find nearest polygon
 	if (!done[q])
 	  {
@@ -771,10 +902,14 @@ double Printlines::makeLines(Vector2d &startPoint,
 	totalspeedfactor += printpolys[npindex]->length * printpolys[npindex]->speedfactor;
 	done[npindex]=true;
 	ndone++;
+	for (uint t = 0; t < trees.size(); t++)
+	  trees[t]->removePoly(npindex);
       }
       if (lines.size()>0)
 	startPoint = lines.back().to;
     }
+  for (uint t = 0; t < trees.size(); t++)
+    delete trees[t];
   if (totallength !=0)
     totalspeedfactor /= totallength;
   else
@@ -860,9 +995,9 @@ void Printlines::optimize(double linewidth,
   // cout << GCode(start,E,1,1000);
   //cerr << "optimize" << endl;
   makeArcs(linewidth, lines);
-  double minarclength = settings->get_double("Slicing","MinArcLength");
-  if (!settings->get_boolean("Slicing","UseArcs")) minarclength = cornerradius;
-  if (settings->get_boolean("Slicing","RoundCorners"))
+  double minarclength = params->Slicing.MinArcLength;
+  if (!params->Slicing.UseArcs) minarclength = cornerradius;
+  if (params->Slicing.RoundCorners)
     roundCorners(cornerradius, minarclength, lines);
   slowdownTo(slowdowntime, lines);
   //double totext = total_Extrusion(lines);
@@ -942,9 +1077,9 @@ bool continues_arc(const Vector2d &center,
 uint Printlines::makeArcs(double linewidth,
 			  vector<PLine2> &lines) const
 {
-  if (!settings->get_boolean("Slicing","UseArcs")) return 0;
+  if (!params->Slicing.UseArcs) return 0;
   if (lines.size() < 3) return 0;
-  const double maxAngle = settings->get_double("Slicing","ArcsMaxAngle") * M_PI/180;
+  const double maxAngle = params->Slicing.ArcsMaxAngle * M_PI/180;
   const double linewidth_sq = linewidth*linewidth;
   if (maxAngle <= 0) return 0;
   double arcRadiusSq = 0;
@@ -999,9 +1134,9 @@ Vector2d Printlines::arcCenter(const PLine2 &l1, const PLine2 &l2,
 uint Printlines::makeArcs(double linewidth,
 			  vector<PLine2> &lines) const
 {
-  if (!settings->get_boolean("Slicing","UseArcs")) return 0;
+  if (!params->Slicing.UseArcs) return 0;
   if (lines.size() < 2) return 0;
-  double maxAngle = settings->get_double("Slicing","ArcsMaxAngle") * M_PI/180;
+  double maxAngle = params->Slicing.ArcsMaxAngle * M_PI/180;
   if (maxAngle < 0) return 0;
   double arcRadiusSq = 0;
   Vector2d arccenter(1000000,1000000);
@@ -1160,7 +1295,7 @@ uint Printlines::makeCornerArc(double maxdistance, double minarclength,
   const double arc_len = abs(radius * angle);
   // too small for arc, replace by 2 straight lines
   const bool not_arc =
-    !settings->get_boolean("Slicing","UseArcs")
+    !params->Slicing.UseArcs
     || (arc_len < (split?minarclength:(minarclength*2)));
   // too small to make 2 lines, just make 1 line
   const bool toosmallfortwo  =
@@ -1681,7 +1816,7 @@ double Printlines::totalSecondsExtruding(const vector<PLine2> &lines)
 
 
 void Printlines::getCommands(const vector<PLine3> &plines,
-			     const Settings & settings,
+			     const SliceParams & params,
 			     GCodeState &gc_state,
 			     ViewProgress * progress)
 {
@@ -1695,14 +1830,14 @@ void Printlines::getCommands(const vector<PLine3> &plines,
   bool cont = true;
   vector<Command> commands;
   const double
-    minspeed   = settings.get_double("Hardware","MinMoveSpeedXY") * 60,
-    movespeed  = settings.get_double("Hardware","MaxMoveSpeedXY") * 60,
+    minspeed   = params.Hardware.MinMoveSpeedXY * 60,
+    movespeed  = params.Hardware.MaxMoveSpeedXY * 60,
     //maxspeed   = min(movespeed, (double)settings.Extruder.MaxLineSpeed * 60),
-    minZspeed  = settings.get_double("Hardware","MinMoveSpeedZ") * 60,
-    maxZspeed  = settings.get_double("Hardware","MaxMoveSpeedZ") * 60,
+    minZspeed  = params.Hardware.MinMoveSpeedZ * 60,
+    maxZspeed  = params.Hardware.MaxMoveSpeedZ * 60,
     //maxEspeed  = settings.Extruder.EMaxSpeed * 60,
-    maxAOspeed = settings.get_double("Extruder","AntioozeSpeed") * 60;
-  const bool useTCommand = settings.get_boolean("Slicing","UseTCommand");
+    maxAOspeed = params.Extruder.AntioozeSpeed * 60;
+  const bool useTCommand = params.Slicing.UseTCommand;
   for (uint i = 0; i < plines.size(); i++) {
     if (progress && i%progress_steps==0){
       cont = (progress->update(i)) ;
@@ -1717,7 +1852,7 @@ void Printlines::getCommands(const vector<PLine3> &plines,
 			  minspeed, movespeed, minZspeed, maxZspeed,
 			  maxAOspeed, useTCommand);
   }
-  gc_state.AppendCommands(commands, settings.get_boolean("Slicing","RelativeEcode"));
+  gc_state.AppendCommands(commands, params.Slicing.RelativeEcode);
 }
 
 
@@ -164,6 +164,7 @@ class PrintPoly
   friend class Printlines;
 
   PrintPoly(const Poly &poly, const Printlines * printlines,
+	    uint extruder_no, const Vector2d &extruder_offset,
 	    double speed, double overhangspeed, double min_time,
 	    bool displace_start, PLineArea area);
 
@@ -200,6 +201,35 @@ typedef struct {
 } AORange;
 
 
+// k-d tree over the possible start vertices of polygons, to find the
+// nearest one in O(log n). Polygons are removed once printed.
+class PolyStartTree
+{
+ public:
+  struct Point {
+    Vector2d p;
+    uint poly, vertex;
+  };
+  PolyStartTree(const vector<Point> &points, uint numpolys);
+
+  // nearest point of all remaining polygons, ties go to the lowest
+  // polygon and vertex index; false if none left
+  bool nearest(const Vector2d &from, Point &result, double &distsq) const;
+  void removePoly(uint poly);
+
+ private:
+  vector<Point> points;       // in tree order, node of range is its middle
+  vector<uint> parent;
+  vector<uint> alive;         // remaining points in subtree
+  vector<bool> removed;
+  vector< vector<uint> > poly_nodes;
+
+  void build(uint lo, uint hi, uint depth, uint par);
+  void search(uint lo, uint hi, uint depth, const Vector2d &from,
+	      int &best, double &bestdist) const;
+};
+
+
 // a bunch of printlines: lines with feedrate
 // optimize for corners etc.
 class Printlines
@@ -222,23 +252,27 @@ class Printlines
 
 
  public:
-  Printlines(const Layer * layer, const Settings *settings, double z_offset=0);
+  Printlines(const Layer * layer, const SliceParams *params, double z_offset=0);
   ~Printlines(){ clear(); };
 
   void clear();
 
-  const Settings *settings;
+  const SliceParams *params;
   const Layer * layer;
 
+  bool legacy_search; // find next polygon by checking all (no PolyStartTree)
+
   Cairo::RefPtr<Cairo::ImageSurface> overhangs_surface;
 
   void setName(string s){name=s;};
 
   Vector2d lastPoint() const;
 
+  // extruder -1 is the selected one
   void addPolys(PLineArea area,	const vector<Poly> &polys,
 		bool displace_start,
-		double maxspeed = 0, double min_time = 0);
+		double maxspeed = 0, double min_time = 0,
+		int extruder = -1);
 
   double makeLines(Vector2d &startPoint, vector<PLine2> &lines);
 
@@ -270,7 +304,7 @@ class Printlines
 			     AORange &range,
 			     const vector< PLine3 > &lines);
   static uint makeAntioozeRetract(vector< PLine3 > &lines,
-				  const Settings &settings,
+				  const SliceParams &params,
 				  ViewProgress * progress = NULL);
   static uint insertAntioozeHaltBefore(uint index, double amount, double speed,
 				       vector< PLine3 > &lines);
@@ -322,7 +356,7 @@ class Printlines
   double getSlowdownFactor() const {return slowdownfactor;};
 
   static void getCommands(const vector<PLine3> &plines,
-			  const Settings &settings,
+			  const SliceParams &params,
 			  GCodeState &state,
 			  ViewProgress * progress = NULL);
 
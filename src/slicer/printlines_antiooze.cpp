@@ -283,16 +283,16 @@ int Printlines::distribute_AntioozeAmount(double AOamount, double AOspeed,
 
 
 uint Printlines::makeAntioozeRetract(vector<PLine3> &lines,
-				     const Settings &settings,
+				     const SliceParams &params,
 				     ViewProgress * progress)
 {
-  if (!settings.get_boolean("Extruder","EnableAntiooze")) return 0;
+  if (!params.Extruder.EnableAntiooze) return 0;
 
 
   double
-    AOmindistance = settings.get_double("Extruder","AntioozeDistance"),
-    AOamount      = settings.get_double("Extruder","AntioozeAmount"),
-    AOspeed       = settings.get_double("Extruder","AntioozeSpeed") * 60;
+    AOmindistance = params.Extruder.AntioozeDistance,
+    AOamount      = params.Extruder.AntioozeAmount,
+    AOspeed       = params.Extruder.AntioozeSpeed * 60;
     //AOonhaltratio = settings.Slicing.AntioozeHaltRatio;
   if (lines.size() < 2 || AOmindistance <=0 || AOamount == 0) return 0;
   // const double onhalt_amount = AOamount * AOonhaltratio;
@@ -356,7 +356,7 @@ uint Printlines::makeAntioozeRetract(vector<PLine3> &lines,
     if (ranges[r].moveend > newlines.size()-2) ranges[r].moveend = newlines.size()-2;
 
     // lift move-only range
-    const double zlift = settings.get_double("Extruder","AntioozeZlift");
+    const double zlift = params.Extruder.AntioozeZlift;
     if (zlift > 0)
       for (uint i = ranges[r].movestart; i <= ranges[r].moveend; i++) {
 	newlines[i].lifted = zlift;
@@ -0,0 +1,176 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+
+#include "slicestages.h"
+#include "shape.h"
+
+#include <functional>
+#include <sstream>
+
+// shapes moved by less are not moved
+#define MIN_OFFSET 1e-9
+
+static const char * const ignored_groups[] =
+  { "Global", "Printer", "Misc", "Display", "UserButtons", "Ranges", NULL };
+
+// the Slicing settings not used for cutting the shapes
+static const char * const polygons_keys[] =
+  { "ShellCount", "ShellOffset", "InfillOverlap", "MakeDecor", "DecorLayers",
+    "SolidThickness", "NoTopAndBottom", "SupportWiden", "NoBridges",
+    "DoInfill", NULL };
+static const char * const skirt_keys[] =
+  { "Skirt", "SkirtHeight", "SkirtDistance", "SingleSkirt", NULL };
+static const char * const infill_keys[] =
+  { "InfillPercent", "AltInfillPercent", "AltInfillLayers",
+    "NormalFilltype", "NormalFillExtrusion", "FullFilltype",
+    "FullFillExtrusion", "SupportFilltype", "SupportExtrusion",
+    "SupportInfillDistance", "DecorFilltype", "DecorInfillRotation",
+    "DecorInfillDistance", "InfillRotation", "InfillRotationPrLayer",
+    "FirstLayersInfillDist", "FirstLayersNum", "BridgeExtrusion",
+    "FillSkirt", NULL };
+static const char * const printlines_keys[] =
+  { "RelativeEcode", "UseTCommand", "MoveNearest", "MinShelltime",
+    "MinLayertime", "FanControl", "MinFanSpeed", "MaxFanSpeed",
+    "MaxOverhangSpeed", "FirstLayersSpeed", "UseArcs", "ArcsMaxAngle",
+    "MinArcLength", "RoundCorners", "CornerRadius", "GCodePostprocess",
+    "GCodePostprocessor", "RandomizeLayerStart", "FarthestLayerStart",
+    "PlanLayersParallel", "PipelineLayers", NULL };
+// the extruder settings for the width of lines
+static const char * const extruder_polygons_keys[] =
+  { "ExtrudedMaterialWidthRatio", "MinimumLineWidth", "MaximumLineWidth",
+    NULL };
+
+static bool isIn(const string &name, const char * const *names)
+{
+  for (uint i = 0; names[i]; i++)
+    if (name == names[i]) return true;
+  return false;
+}
+
+SliceStages::Stage SliceStages::settingStage(const string &group,
+					     const string &key)
+{
+  if (isIn(group, ignored_groups))
+    return NUM_STAGES;
+  if (group == "Slicing") {
+    if (isIn(key, polygons_keys))   return POLYGONS;
+    if (isIn(key, skirt_keys))      return SKIRT;
+    if (isIn(key, infill_keys))     return INFILL;
+    if (isIn(key, printlines_keys)) return PRINTLINES;
+    return SLICE;
+  }
+  if (group == "Hardware") {
+    // the margin in XY moves the shapes, see firstChanged()
+    if (key.compare(0, 7, "Volume.") == 0 || key == "PrintMargin.Z")
+      return SLICE;
+    return PRINTLINES;
+  }
+  if (group.compare(0, 8, "Extruder") == 0) {
+    if (isIn(key, extruder_polygons_keys))
+      return POLYGONS;
+    return PRINTLINES;
+  }
+  // Raft (its size moves the shapes), GCode
+  return PRINTLINES;
+}
+
+
+SliceStages::SliceStages()
+  : valid(false)
+{
+  for (uint s = 0; s < NUM_STAGES; s++)
+    keys[s] = 0;
+}
+
+SliceStages::SliceStages(const Settings &settings,
+			 const vector<Shape*> &shapes,
+			 const vector<Matrix4d> &transforms)
+  : valid(true)
+{
+  ostringstream inputs[NUM_STAGES];
+  for (uint s = 0; s < NUM_STAGES; s++)
+    inputs[s].precision(17);
+
+  vector< Glib::ustring > groups = settings.get_groups();
+  for (uint g = 0; g < groups.size(); g++) {
+    vector< Glib::ustring > names = settings.get_keys(groups[g]);
+    for (uint k = 0; k < names.size(); k++) {
+      const Stage stage = settingStage(groups[g], names[k]);
+      if (stage == NUM_STAGES) continue;
+      inputs[stage] << groups[g] << "." << names[k] << "="
+		    << settings.get_value(groups[g], names[k]) << endl;
+    }
+  }
+
+  // the shapes' triangles by their revision, where they are without
+  // their offset in XY
+  for (uint i = 0; i < shapes.size(); i++) {
+    if (shapes[i]->dimensions() != 3) { // polygons not tracked
+      valid = false;
+      break;
+    }
+    Matrix4d T = transforms[i] * shapes[i]->transform3D.transform;
+    Vector3d trans;
+    T.get_translation(trans);
+    // the offset in mm, Transform3D keeps the scale in T(3,3)
+    const double w = T.at(3,3);
+    shape_offsets.push_back(Vector2d(trans.x(), trans.y()) / w);
+    T.set_translation(Vector3d(0, 0, trans.z()));
+    inputs[SLICE] << shapes[i] << " " << shapes[i]->getRevision() << " "
+		  << shapes[i]->legacy_slicing;
+    for (uint r = 0; r < 4; r++)
+      for (uint c = 0; c < 4; c++)
+	inputs[SLICE] << " " << T.at(r,c);
+    inputs[SLICE] << endl;
+  }
+
+  std::hash<string> hash;
+  for (uint s = 0; s < NUM_STAGES; s++)
+    keys[s] = hash(inputs[s].str());
+}
+
+SliceStages::Stage SliceStages::firstChanged(const SliceStages &last,
+					     Vector2d &offset) const
+{
+  offset = Vector2d::ZERO;
+  if (!valid || !last.valid)
+    return SLICE;
+  uint first = 0;
+  while (first < PRINTLINES && keys[first] == last.keys[first])
+    first++;
+  if (first == SLICE)
+    return SLICE;
+
+  // same shapes, moved all together or not at all
+  if (shape_offsets.size() != last.shape_offsets.size())
+    return SLICE;
+  if (shape_offsets.empty())
+    return (Stage)first;
+  const Vector2d moved = shape_offsets[0] - last.shape_offsets[0];
+  for (uint i = 1; i < shape_offsets.size(); i++) {
+    const Vector2d d = shape_offsets[i] - last.shape_offsets[i] - moved;
+    if (abs(d.x()) > MIN_OFFSET || abs(d.y()) > MIN_OFFSET)
+      return SLICE;
+  }
+  if (abs(moved.x()) > MIN_OFFSET || abs(moved.y()) > MIN_OFFSET) {
+    offset = moved;
+    if (first > SKIRT) first = SKIRT;
+  }
+  return (Stage)first;
+}
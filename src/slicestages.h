@@ -0,0 +1,56 @@
+/*
+    This file is a part of the RepSnapper project.
+    Copyright (C) 2026  agent@local
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+*/
+#pragma once
+
+#include "stdafx.h"
+#include "settings.h"
+
+// The inputs of each stage of making layers, as a hash per stage, so a
+// new run can keep the layers of the last one up to the first stage
+// whose inputs changed.  Each stage also uses the results of the ones
+// before it.
+class SliceStages
+{
+public:
+  enum Stage {
+    SLICE,      // shapes cut into layer polygons
+    POLYGONS,   // shells, uncovered areas, support and skins
+    SKIRT,
+    INFILL,
+    PRINTLINES, // and everything after, always run
+    NUM_STAGES
+  };
+
+  SliceStages(); // matches nothing
+  SliceStages(const Settings &settings,
+	      const vector<Shape*> &shapes, const vector<Matrix4d> &transforms);
+
+  // The first stage to run again after the run with the last stages.
+  // If all shapes were only moved by the same offset in XY, the layers
+  // can be moved by offset and run again from SKIRT on.
+  Stage firstChanged(const SliceStages &last, Vector2d &offset) const;
+
+  // the stage a setting is used from, NUM_STAGES if none
+  static Stage settingStage(const string &group, const string &key);
+
+private:
+  bool valid;
+  size_t keys[NUM_STAGES];
+  vector<Vector2d> shape_offsets; // XY offset of each shape, unscaled
+};
@@ -27,7 +27,8 @@ ViewProgress::ViewProgress(Gtk::Box *box, Gtk::ProgressBar *bar, Gtk::Label *lab
   m_box (box), m_bar(bar), m_label(label), to_terminal(true)
 {
   m_bar_max = 0.0;
-  box->hide();
+  if (box)
+    box->hide();
   // progress->m_signal_progress_start.connect  (sigc::mem_fun(*this, &ViewProgress::start));
   // progress->m_signal_progress_update.connect (sigc::mem_fun(*this, &ViewProgress::update));
   // progress->m_signal_progress_stop.connect   (sigc::mem_fun(*this, &ViewProgress::stop));
@@ -37,13 +38,14 @@ ViewProgress::ViewProgress(Gtk::Box *box, Gtk::ProgressBar *bar, Gtk::Label *lab
 void ViewProgress::start (const char *label, double max)
 {
   do_continue = true;
-  m_box->show();
   m_bar_max = max;
   this->label = label;
-  m_label->set_label (label);
   m_bar_cur = 0.0;
-  m_bar->set_fraction(0.0);
   start_time.assign_current_time();
+  if (!m_box) return;
+  m_box->show();
+  m_label->set_label (label);
+  m_bar->set_fraction(0.0);
   Gtk::Main::iteration(false);
 }
 bool ViewProgress::restart (const char *label, double max)
@@ -54,14 +56,15 @@ bool ViewProgress::restart (const char *label, double max)
     Glib::TimeVal now;
     now.assign_current_time();
     const int time_used = (int) round((now - start_time).as_double()); // seconds
-    cerr << m_label->get_label() << " -- " << _(" done in ") << time_used << _(" seconds") << "       " << endl;
+    cerr << shown_label() << " -- " << _(" done in ") << time_used << _(" seconds") << "       " << endl;
   }
   m_bar_max = max;
   this->label = label;
-  m_label->set_label (label);
   m_bar_cur = 0.0;
-  m_bar->set_fraction(0.0);
   start_time.assign_current_time();
+  if (!m_box) return true;
+  m_label->set_label (label);
+  m_bar->set_fraction(0.0);
   //g_main_context_iteration(NULL,false);
   Gtk::Main::iteration(false);
   return true;
@@ -73,16 +76,23 @@ void ViewProgress::stop (const char *label)
     Glib::TimeVal now;
     now.assign_current_time();
     const int time_used = (int) round((now - start_time).as_double()); // seconds
-    cerr << m_label->get_label() << " -- " << _(" done in ") << time_used << _(" seconds") << "       " << endl;
+    cerr << shown_label() << " -- " << _(" done in ") << time_used << _(" seconds") << "       " << endl;
   }
   this->label = label;
-  m_label->set_label (label);
   m_bar_cur = m_bar_max;
+  if (!m_box) return;
+  m_label->set_label (label);
   m_bar->set_fraction(1.0);
   m_box->hide();
   Gtk::Main::iteration(false);
 }
 
+// the label on the bar, with the time left
+string ViewProgress::shown_label() const
+{
+  return m_label ? string(m_label->get_label()) : label;
+}
+
 string timeleft_str(long seconds) {
   ostringstream ostr;
   int hrs = (int)(seconds/3600);
@@ -106,19 +116,25 @@ bool ViewProgress::update (const double value, bool take_priority)
     return do_continue;
 
   m_bar_cur = CLAMP(value, 0, 1.0);
-  m_bar->set_fraction(value / m_bar_max);
+  const double fraction = m_bar_max > 0 ? CLAMP(value / m_bar_max, 0, 1.0) : 0;
+  if (m_bar)
+    m_bar->set_fraction(fraction);
   ostringstream o;
   if(floor(value) != value && floor(m_bar_max) != m_bar_max)
     o.precision(1);
   else
     o.precision(0);
   o << fixed << value <<"/"<< m_bar_max;
-  m_bar->set_text(o.str());
+  if (m_bar)
+    m_bar->set_text(o.str());
   if (to_terminal) {
-    int perc = (int(m_bar->get_fraction()*100));
-    cerr << m_label->get_label() << " " << o.str() << " -- " << perc << "%              \r";
+    int perc = (int(fraction*100));
+    cerr << shown_label() << " " << o.str() << " -- " << perc << "%              \r";
   }
 
+  if (!m_box)
+    return do_continue;
+
   if (value > 0) {
     Glib::TimeVal now;
     now.assign_current_time();
@@ -137,8 +153,9 @@ bool ViewProgress::update (const double value, bool take_priority)
 
 void ViewProgress::set_label (const std::string label)
 {
-  std::string old = m_label->get_label();
   this->label = label;
+  if (!m_label) return;
+  std::string old = m_label->get_label();
   if (old != label)
     m_label->set_label (label);
   Gtk::Main::iteration(false);
@@ -62,6 +62,7 @@ class ViewProgress {
 
   Glib::TimeVal start_time;
   string label;
+  string shown_label() const;
 
  public:
   void start (const char *label, double max);
@@ -70,6 +71,7 @@ class ViewProgress {
   bool update (const double value, bool take_priority=true);
   //ViewProgress(Progress *model, Gtk::Box *box, Gtk::ProgressBar *bar, Gtk::Label *label);
   ViewProgress(){};
+  // without widgets (all NULL) only on the terminal, no display needed
   ViewProgress(Gtk::Box *box, Gtk::ProgressBar *bar, Gtk::Label *label);
   void set_label (std::string label);
   double maximum() { return m_bar_max; }
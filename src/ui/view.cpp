@@ -877,6 +877,8 @@ void View::show_notebooktab (string name, string notebookname) const
 void View::gcode_changed ()
 {
   set_SliderBBox(m_model->gcode.Min, m_model->gcode.Max);
+  // parts of big files can't be edited
+  m_gcodetextview->set_editable(!m_model->gcode.isBufferWindowed());
   // show gcode result
   show_notebooktab("gcode_result_win", "gcode_text_notebook");
   show_notebooktab("gcode_tab", "controlnotebook");
@@ -1519,12 +1521,25 @@ void View::setModel(Model *model)
 void View::on_gcodebuffer_cursor_set(const Gtk::TextIter &iter,
 				     const Glib::RefPtr <Gtk::TextMark> &refMark)
 {
-  if (m_model)
+  if (m_model) {
     m_model->gcode.updateWhereAtCursor(m_model->settings.get_extruder_letters());
+    // the buffer must not change in this handler
+    if (m_model->gcode.isBufferWindowed() && !gcode_window_idle.connected())
+      gcode_window_idle = Glib::signal_idle().connect
+	(sigc::mem_fun(*this, &View::move_gcode_window));
+  }
   if (m_renderer)
     m_renderer->queue_draw();
 }
 
+// load the part of a big gcode file the cursor moves to
+bool View::move_gcode_window()
+{
+  if (m_model->gcode.moveBufferWindow())
+    m_gcodetextview->scroll_to(m_gcodetextview->get_buffer()->get_insert(), 0.0, 0.5, 0.5);
+  return false;
+}
+
 void View::delete_selected_objects()
 {
   vector<Gtk::TreeModel::Path> path = m_treeview->get_selection()->get_selected_rows();
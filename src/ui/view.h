@@ -93,6 +93,8 @@ class View : public Gtk::Window
   void on_gcodebuffer_cursor_set (const Gtk::TextIter &iter,
 				  const Glib::RefPtr <Gtk::TextMark> &refMark);
   Gtk::TextView * m_gcodetextview;
+  sigc::connection gcode_window_idle;
+  bool move_gcode_window();
 
   Gtk::TextView *log_view, *err_view, *echo_view;
   void log_msg(Gtk::TextView *view, string s);